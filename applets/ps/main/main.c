@@ -3,6 +3,59 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "kernel/core/elf/m_elf_app_api.h"
+
+#define PS_MAX_TASKS 64
+
+static const char *state_name(uint32_t state)
+{
+    static const char *names[] = {
+        "ready", "running", "waiting", "suspended", "exited",
+    };
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+static const char *wait_name(uint32_t reason)
+{
+    static const char *names[] = {
+        "-", "ipc", "delay", "event", "flags", "job", "shm-rd", "shm-wr",
+    };
+    return reason < sizeof(names) / sizeof(names[0]) ? names[reason] : "?";
+}
+
+static void print_tasks(void)
+{
+    static magnolia_taskinfo_t tasks[PS_MAX_TASKS];
+    int count = m_tasklist(tasks, (uint32_t)sizeof(tasks[0]), PS_MAX_TASKS);
+    if (count < 0) {
+        fprintf(stderr, "ps: m_tasklist: %s\n", strerror(-count));
+        return;
+    }
+
+    printf("\nTID\tNAME            STATE     %%CPU   SWITCHES  TOPWAIT\n");
+    for (int i = 0; i < count; ++i) {
+        const magnolia_taskinfo_t *t = &tasks[i];
+        if (!t->accounting) {
+            printf("%u\t%-15.15s %-9s %5s %10s  %s\n",
+                   (unsigned)t->id,
+                   t->name,
+                   state_name(t->state),
+                   "-",
+                   "-",
+                   "-");
+            continue;
+        }
+        printf("%u\t%-15.15s %-9s %3u.%u %10u  %s\n",
+               (unsigned)t->id,
+               t->name,
+               state_name(t->state),
+               (unsigned)(t->cpu_permille / 10),
+               (unsigned)(t->cpu_permille % 10),
+               (unsigned)t->context_switches,
+               wait_name(t->top_wait_reason));
+    }
+}
+
 int main(int argc, char **argv)
 {
     (void)argc;
@@ -15,6 +68,6 @@ int main(int argc, char **argv)
 
     printf("PID\tPPID\tCWD\n");
     printf("%d\t%d\t%s\n", getpid(), getppid(), cwd);
+    print_tasks();
     return 0;
 }
-
@@ -1,5 +1,7 @@
 #include "kernel/arch/m_arch.h"
 
+#include "sdkconfig.h"
+
 #include <stddef.h>
 #include <stdint.h>
 
@@ -75,6 +77,20 @@ void *m_arch_malloc(size_t size)
     return heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
 }
 
+void *m_arch_malloc_large(size_t size)
+{
+    if (size == 0) {
+        return NULL;
+    }
+#if CONFIG_SPIRAM
+    void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr != NULL) {
+        return ptr;
+    }
+#endif
+    return heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+}
+
 void m_arch_free(void *ptr)
 {
     if (ptr == NULL) {
@@ -4,6 +4,7 @@
 
 #include "sdkconfig.h"
 
+#include "esp_cpu.h"
 #include "esp_private/esp_clk.h"
 #include "esp_random.h"
 #include "esp_rom_sys.h"
@@ -30,6 +31,11 @@ uint64_t m_arch_get_time_ns(void)
     return (uint64_t)esp_timer_get_time() * 1000ull;
 }
 
+uint32_t m_arch_get_cycle_count(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
 void m_arch_timer_init(void)
 {
     (void)esp_timer_init();
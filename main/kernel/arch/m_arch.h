@@ -29,6 +29,7 @@ void m_arch_shutdown(void);
 
 void m_arch_sleep_ns(uint64_t ns);
 uint64_t m_arch_get_time_ns(void);
+uint32_t m_arch_get_cycle_count(void);
 void m_arch_timer_init(void);
 
 void m_arch_yield(void);
@@ -47,6 +48,8 @@ int32_t m_arch_atomic_cmpxchg(volatile int32_t *ptr,
                               int32_t desired);
 
 void *m_arch_malloc(size_t size);
+/* Like m_arch_malloc, but prefers external RAM for big buffers. */
+void *m_arch_malloc_large(size_t size);
 void m_arch_free(void *ptr);
 size_t m_arch_get_free_memory(void);
 size_t m_arch_get_total_memory(void);
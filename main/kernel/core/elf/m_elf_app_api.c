@@ -3,10 +3,15 @@
 #include "sdkconfig.h"
 
 #include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "esp_heap_caps.h"
 
+#include "kernel/core/sched/m_sched_diag.h"
+#include "kernel/core/timer/m_timer.h"
+
 #if CONFIG_MAGNOLIA_ALLOC_ENABLED
 #include "kernel/core/memory/m_alloc.h"
 #endif
@@ -55,3 +60,57 @@ int m_meminfo(magnolia_meminfo_t *info)
     return 0;
 }
 
+
+int m_tasklist(magnolia_taskinfo_t *entries,
+               uint32_t entry_size,
+               uint32_t capacity)
+{
+    if (entries == NULL || entry_size == 0) {
+        return -EINVAL;
+    }
+    if (capacity == 0) {
+        return 0;
+    }
+    /* Both the snapshot and the caller's table are capacity entries long. */
+    if (capacity > SIZE_MAX / sizeof(m_sched_task_diag_entry_t)
+        || capacity > SIZE_MAX / entry_size) {
+        return -EINVAL;
+    }
+
+    m_sched_task_diag_entry_t *snapshot = malloc(sizeof(*snapshot) * capacity);
+    if (snapshot == NULL) {
+        return -ENOMEM;
+    }
+
+    size_t count = m_sched_task_snapshot(snapshot, capacity);
+    uint64_t budget_us = (uint64_t)m_timer_get_monotonic() * portNUM_PROCESSORS;
+
+    uint32_t copy = entry_size;
+    if (copy > (uint32_t)sizeof(magnolia_taskinfo_t)) {
+        copy = (uint32_t)sizeof(magnolia_taskinfo_t);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const m_sched_task_diag_entry_t *task = &snapshot[i];
+        magnolia_taskinfo_t out = {0};
+        out.size = (uint32_t)sizeof(out);
+        out.version = 1;
+        out.id = task->id;
+        strncpy(out.name, task->name, sizeof(out.name) - 1);
+        out.state = (uint32_t)task->state;
+        out.wait_reason = (uint32_t)task->wait_reason;
+        out.accounting = CONFIG_MAGNOLIA_SCHED_ACCOUNTING ? 1u : 0u;
+        out.cpu_time_us = task->cpu_time_us;
+        out.cpu_permille = budget_us
+                                   ? (uint32_t)((task->cpu_time_us * 1000ULL)
+                                                / budget_us)
+                                   : 0;
+        out.context_switches = task->context_switches;
+        out.top_wait_reason = (uint32_t)task->top_wait_reason;
+
+        memcpy((uint8_t *)entries + i * entry_size, &out, copy);
+    }
+
+    free(snapshot);
+    return (int)count;
+}
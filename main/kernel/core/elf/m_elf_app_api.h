@@ -40,6 +40,48 @@ typedef struct {
  */
 int m_meminfo(magnolia_meminfo_t *info);
 
+/**
+ * @brief Scheduler view of one Magnolia task, as shown by `ps`.
+ *
+ * ABI notes:
+ * - Caller passes sizeof(magnolia_taskinfo_t) it expects as `entry_size`.
+ * - Kernel fills up to min(entry_size, sizeof(magnolia_taskinfo_t)) bytes of
+ *   each entry and sets `size`/`version` in every one.
+ * - `version` is currently 1.
+ * - `state` and `top_wait_reason` carry m_sched_task_state_t and
+ *   m_sched_wait_reason_t values.
+ * - `cpu_permille` is the share of all CPUs the task used since boot. It and
+ *   the other accounting fields are zero and `accounting` is 0 when the
+ *   kernel was built without CONFIG_MAGNOLIA_SCHED_ACCOUNTING.
+ */
+typedef struct {
+    uint32_t size;
+    uint32_t version;
+
+    uint32_t id;
+    char name[16];
+    uint32_t state;
+    uint32_t wait_reason;
+
+    uint32_t accounting;
+    uint32_t cpu_permille;
+    uint64_t cpu_time_us;
+    uint32_t context_switches;
+    uint32_t top_wait_reason;
+} magnolia_taskinfo_t;
+
+/**
+ * @brief Fill up to @p capacity entries describing Magnolia tasks.
+ *
+ * Exported to ELF applets as `m_tasklist`. Returns -EINVAL if @p capacity
+ * entries of @p entry_size bytes cannot be addressed.
+ *
+ * @return Number of entries written, or a negative errno-style value.
+ */
+int m_tasklist(magnolia_taskinfo_t *entries,
+               uint32_t entry_size,
+               uint32_t capacity);
+
 #ifdef __cplusplus
 }
 #endif
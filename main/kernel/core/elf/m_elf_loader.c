@@ -49,12 +49,13 @@ static void m_elf_log_job_heap(const char *phase, job_ctx_t *ctx)
     magnolia_alloc_job_stats_t stats;
     m_alloc_get_job_stats(ctx, &stats);
     ESP_LOGI(TAG,
-             "job heap %s: used=%u peak=%u cap=%u regions=%u",
+             "job heap %s: used=%u peak=%u cap=%u regions=%u large=%u",
              phase,
              (unsigned)stats.used_bytes,
              (unsigned)stats.peak_bytes,
              (unsigned)stats.capacity_bytes,
-             (unsigned)stats.region_count);
+             (unsigned)stats.region_count,
+             (unsigned)stats.large_count);
 }
 
 static bool m_elf_range_ok(uint32_t offset, uint32_t size, size_t len)
@@ -822,9 +823,9 @@ int m_elf_run_file(const char *path, int argc, char *argv[], int *out_rc)
                 new_capacity *= 2;
             }
             /*
-             * Read buffer is transient and can exceed a single Magnolia region's
-             * max payload (e.g. 8192). Use ESP-IDF heap directly to avoid
-             * spurious -ENOMEM from the job allocator.
+             * The image is transient and routinely larger than the per-job
+             * heap limit. Keep it on the kernel heap so an oversized file
+             * fails with -ENOMEM instead of cancelling the caller's job.
              */
             uint8_t *new_buf = (uint8_t *)heap_caps_realloc(buffer,
                                                             new_capacity,
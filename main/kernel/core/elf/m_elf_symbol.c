@@ -302,6 +302,7 @@ static const struct m_elfsym g_kernel_libc_syms[] = {
 
     /* System info */
     M_ELFSYM_EXPORT(m_meminfo),
+    M_ELFSYM_EXPORT(m_tasklist),
 
     /* Magnolia ELF exec helpers (used by /bin/sh and friends) */
     { "m_elf_run_file", (void *)m_elf_run_file },
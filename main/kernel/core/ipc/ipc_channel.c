@@ -7,8 +7,11 @@
 
 #include <string.h>
 
+#include "freertos/FreeRTOS.h"
+
 #include "kernel/core/ipc/ipc_channel.h"
 #include "kernel/core/ipc/ipc_channel_private.h"
+#include "kernel/core/memory/m_slab.h"
 #include "kernel/core/timer/m_timer.h"
 
 void m_ipc_handler_registry(void)
@@ -24,7 +27,13 @@ void m_ipc_handler_registry(void)
 
 #if CONFIG_MAGNOLIA_IPC_CHANNELS_ENABLED
 
-static ipc_channel_t g_channels[IPC_MAX_CHANNELS];
+/* Channel objects come from the slab cache the first time their handle slot
+ * is used and then stay with the slot, so a stale handle never points at
+ * freed memory. Only the message slots are returned on destroy. */
+static ipc_channel_t *g_channels[IPC_MAX_CHANNELS];
+
+static m_slab_cache_t g_channel_cache =
+        M_SLAB_CACHE_INITIALIZER("ipc_channel", ipc_channel_t);
 
 static inline ipc_handle_registry_t *ipc_channel_registry(void)
 {
@@ -57,7 +66,7 @@ ipc_channel_t *_m_ipc_channel_lookup(ipc_handle_t handle)
         return NULL;
     }
 
-    return &g_channels[index];
+    return g_channels[index];
 }
 
 /**
@@ -205,15 +214,40 @@ static ipc_error_t _m_ipc_channel_wait_for_message(ipc_channel_t *channel,
 }
 
 /**
- * @brief Enqueue bytes into the circular slot.
+ * @brief Check whether every slot holds a message.
+ */
+static bool _m_ipc_channel_full(const ipc_channel_t *channel)
+{
+    return channel->depth == channel->capacity;
+}
+
+/**
+ * @brief Payload storage of slot @p index.
+ */
+static inline uint8_t *_m_ipc_channel_slot(const ipc_channel_t *channel,
+                                           size_t index)
+{
+    return channel->data + index * channel->message_size;
+}
+
+/**
+ * @brief Length of the oldest queued message.
+ */
+static size_t _m_ipc_channel_peek_length(const ipc_channel_t *channel)
+{
+    return channel->lengths[channel->head];
+}
+
+/**
+ * @brief Copy bytes into the next free slot.
  */
 static void _m_ipc_channel_enqueue_message(ipc_channel_t *channel,
                                           const void *message,
                                           size_t length)
 {
     size_t index = channel->tail;
-    memcpy(channel->messages[index].data, message, length);
-    channel->messages[index].length = length;
+    memcpy(_m_ipc_channel_slot(channel, index), message, length);
+    channel->lengths[index] = (uint16_t)length;
     channel->tail = (index + 1) % channel->capacity;
     channel->depth++;
 }
@@ -226,8 +260,8 @@ static void _m_ipc_channel_dequeue_message(ipc_channel_t *channel,
                                           size_t *out_length)
 {
     size_t index = channel->head;
-    size_t length = channel->messages[index].length;
-    memcpy(out_buffer, channel->messages[index].data, length);
+    size_t length = channel->lengths[index];
+    memcpy(out_buffer, _m_ipc_channel_slot(channel, index), length);
     channel->head = (index + 1) % channel->capacity;
     channel->depth--;
     *out_length = length;
@@ -269,7 +303,7 @@ static ipc_error_t _m_ipc_channel_send_internal(ipc_channel_t *channel,
         return IPC_ERR_OBJECT_DESTROYED;
     }
 
-    while (channel->depth == channel->capacity) {
+    while (_m_ipc_channel_full(channel)) {
         ipc_error_t wait_result = _m_ipc_channel_wait_for_space(channel, timeout_us);
         if (wait_result != IPC_OK) {
             return wait_result;
@@ -312,8 +346,7 @@ static ipc_error_t _m_ipc_channel_recv_internal(ipc_channel_t *channel,
         }
     }
 
-    size_t next_index = channel->head;
-    size_t message_length = channel->messages[next_index].length;
+    size_t message_length = _m_ipc_channel_peek_length(channel);
     if (buffer_size < message_length) {
         portEXIT_CRITICAL(&channel->header.lock);
         return IPC_ERR_INVALID_ARGUMENT;
@@ -332,9 +365,14 @@ static ipc_error_t _m_ipc_channel_recv_internal(ipc_channel_t *channel,
 /*=============== Public API ===============*/
 void m_ipc_channel_module_init(void)
 {
-    memset(g_channels, 0, sizeof(g_channels));
     for (size_t i = 0; i < IPC_MAX_CHANNELS; i++) {
-        g_channels[i].header.lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+        ipc_channel_t *channel = g_channels[i];
+        if (channel == NULL) {
+            continue;
+        }
+        vPortFree(channel->lengths);
+        memset(channel, 0, sizeof(*channel));
+        channel->header.lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
     }
 }
 
@@ -360,7 +398,19 @@ ipc_error_t m_ipc_channel_create(size_t capacity,
         return alloc;
     }
 
-    ipc_channel_t *channel = &g_channels[index];
+    /* One allocation: the length table, then the payload slots. */
+    uint16_t *lengths = pvPortMalloc(capacity * (sizeof(uint16_t) + message_size));
+    ipc_channel_t *channel = g_channels[index];
+    if (channel == NULL) {
+        channel = m_slab_alloc(&g_channel_cache);
+        g_channels[index] = channel;
+    }
+    if (lengths == NULL || channel == NULL) {
+        vPortFree(lengths);
+        ipc_handle_release(registry, index);
+        return IPC_ERR_NO_SPACE;
+    }
+
     memset(channel, 0, sizeof(*channel));
     channel->header.lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
     channel->header.handle = handle;
@@ -368,6 +418,8 @@ ipc_error_t m_ipc_channel_create(size_t capacity,
     channel->header.generation = registry->generation[index];
     channel->capacity = capacity;
     channel->message_size = message_size;
+    channel->lengths = lengths;
+    channel->data = (uint8_t *)(lengths + capacity);
     ipc_wait_queue_init(&channel->send_waiters);
     ipc_wait_queue_init(&channel->recv_waiters);
 
@@ -393,6 +445,9 @@ ipc_error_t m_ipc_channel_destroy(ipc_handle_t handle)
     channel->depth = 0;
     channel->head = 0;
     channel->tail = 0;
+    uint16_t *lengths = channel->lengths;
+    channel->lengths = NULL;
+    channel->data = NULL;
     ipc_wake_all(&channel->send_waiters, IPC_WAIT_RESULT_OBJECT_DESTROYED);
     ipc_wake_all(&channel->recv_waiters, IPC_WAIT_RESULT_OBJECT_DESTROYED);
     channel->waiting_senders = 0;
@@ -402,6 +457,9 @@ ipc_error_t m_ipc_channel_destroy(ipc_handle_t handle)
     ipc_wait_queue_init(&channel->recv_waiters);
     portEXIT_CRITICAL(&channel->header.lock);
 
+    /* Every path that touches the slots checks destroyed under the lock. */
+    vPortFree(lengths);
+
     ipc_handle_registry_t *registry = ipc_channel_registry();
     uint16_t index = (uint16_t)(handle & IPC_HANDLE_INDEX_MASK);
     ipc_handle_release(registry, index);
@@ -443,7 +501,7 @@ ipc_error_t m_ipc_channel_try_send(ipc_handle_t handle,
         return IPC_ERR_INVALID_ARGUMENT;
     }
 
-    if (channel->depth == channel->capacity) {
+    if (_m_ipc_channel_full(channel)) {
         portEXIT_CRITICAL(&channel->header.lock);
         return IPC_ERR_NO_SPACE;
     }
@@ -515,8 +573,7 @@ ipc_error_t m_ipc_channel_try_recv(ipc_handle_t handle,
         return IPC_ERR_NOT_READY;
     }
 
-    size_t next_index = channel->head;
-    size_t message_length = channel->messages[next_index].length;
+    size_t message_length = _m_ipc_channel_peek_length(channel);
     if (buffer_size < message_length) {
         portEXIT_CRITICAL(&channel->header.lock);
         return IPC_ERR_INVALID_ARGUMENT;
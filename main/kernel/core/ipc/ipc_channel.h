@@ -22,7 +22,7 @@ extern "C" {
 #define IPC_CHANNEL_MAX_CAPACITY CONFIG_MAGNOLIA_IPC_CHANNEL_CAPACITY_MAX
 
 /**
- * @brief Maximum message size for each slot stored in a channel.
+ * @brief Maximum message size a channel can be created with.
  */
 #define IPC_CHANNEL_MAX_MESSAGE_SIZE CONFIG_MAGNOLIA_IPC_CHANNEL_MAX_MESSAGE_SIZE
 
@@ -35,15 +35,16 @@ void m_ipc_channel_module_init(void);
 
 /**
  * @brief Create a bounded FIFO channel handle.
- * @details Allocates slot storage, initializes synchronization metadata, and registers the handle.
+ * @details Allocates message slots sized from @p capacity and @p message_size, initializes
+ *          synchronization metadata, and registers the handle.
  *
- * @param capacity Number of slots (1 ≤ capacity ≤ IPC_CHANNEL_MAX_CAPACITY).
- * @param message_size Bytes per slot (1 ≤ message_size ≤ IPC_CHANNEL_MAX_MESSAGE_SIZE).
+ * @param capacity Maximum queued messages (1 ≤ capacity ≤ IPC_CHANNEL_MAX_CAPACITY).
+ * @param message_size Maximum bytes per message (1 ≤ message_size ≤ IPC_CHANNEL_MAX_MESSAGE_SIZE).
  * @param out_handle Receives the newly allocated handle.
  *
  * @return IPC_OK                   Channel created successfully.
  * @return IPC_ERR_INVALID_ARGUMENT Invalid capacity, message_size, or null output pointer.
- * @return IPC_ERR_NO_SPACE         Channel registry cannot allocate a new handle.
+ * @return IPC_ERR_NO_SPACE         No free handle or not enough memory for the slots.
  */
 ipc_error_t m_ipc_channel_create(size_t capacity,
                                 size_t message_size,
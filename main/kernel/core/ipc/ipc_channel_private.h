@@ -16,16 +16,11 @@
 extern "C" {
 #endif
 
-/**
- * @brief   Storage slot for a single channel message.
- */
-typedef struct {
-    size_t length;
-    uint8_t data[IPC_CHANNEL_MAX_MESSAGE_SIZE];
-} ipc_channel_message_t;
-
 /**
  * @brief   Runtime state tracking for a bounded FIFO channel.
+ * @details Holds @p capacity slots of @p message_size bytes in one heap
+ *          block sized from the create arguments; @p head and @p tail are
+ *          slot indices.
  */
 typedef struct ipc_channel {
     ipc_object_header_t header;
@@ -34,11 +29,12 @@ typedef struct ipc_channel {
     size_t depth;
     size_t head;
     size_t tail;
+    uint16_t *lengths;
+    uint8_t *data;
     ipc_wait_queue_t send_waiters;
     ipc_wait_queue_t recv_waiters;
     size_t waiting_senders;
     size_t waiting_receivers;
-    ipc_channel_message_t messages[IPC_CHANNEL_MAX_CAPACITY];
 } ipc_channel_t;
 
 /**
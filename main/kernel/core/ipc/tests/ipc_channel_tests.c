@@ -400,6 +400,47 @@ static bool run_test_invalid_handle(void)
     return ok;
 }
 
+/*
+ * Mixed-length messages cycle through the slots many times, so each slot
+ * must report the length of its latest message. One message is always left
+ * queued so the reader trails the writer.
+ */
+static void channel_wrap_pattern(size_t round, uint8_t *out, size_t *out_length)
+{
+    *out_length = 1 + (round * 5) % 8;
+    for (size_t i = 0; i < *out_length; i++) {
+        out[i] = (uint8_t)(round * 31 + i);
+    }
+}
+
+static bool run_test_slot_wraparound(void)
+{
+    ipc_handle_t handle = IPC_HANDLE_INVALID;
+    if (m_ipc_channel_create(3, 8, &handle) != IPC_OK) {
+        return false;
+    }
+
+    uint8_t message[8];
+    uint8_t buffer[8];
+    size_t length = 0;
+    channel_wrap_pattern(0, message, &length);
+    bool ok = (m_ipc_channel_try_send(handle, message, length) == IPC_OK);
+    for (size_t round = 1; round < 64 && ok; round++) {
+        channel_wrap_pattern(round, message, &length);
+        ok &= (m_ipc_channel_try_send(handle, message, length) == IPC_OK);
+
+        size_t received = 0;
+        ok &= (m_ipc_channel_try_recv(handle, buffer, sizeof(buffer), &received)
+               == IPC_OK);
+        channel_wrap_pattern(round - 1, message, &length);
+        ok &= (received == length);
+        ok &= (memcmp(buffer, message, length) == 0);
+    }
+
+    ok &= (m_ipc_channel_destroy(handle) == IPC_OK);
+    return ok;
+}
+
 static bool run_test_memory_exhaustion(void)
 {
     ipc_handle_t handles[IPC_MAX_CHANNELS];
@@ -464,6 +505,7 @@ bool ipc_channel_tests_run(void)
     overall &= test_report("channel blocking", run_test_blocking_behavior());
     overall &= test_report("channel timed", run_test_timed_waits());
     overall &= test_report("channel FIFO", run_test_fifo_ordering());
+    overall &= test_report("channel slot wraparound", run_test_slot_wraparound());
     overall &= test_report("channel destroy wakes", run_test_destroy_wakes_waiters());
     overall &= test_report("channel invalid handle", run_test_invalid_handle());
     overall &= test_report("channel memory exhaustion", run_test_memory_exhaustion());
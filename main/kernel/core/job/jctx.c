@@ -4,6 +4,7 @@
 
 #include "kernel/core/job/jctx.h"
 #include "kernel/core/memory/m_alloc.h"
+#include "kernel/core/memory/m_slab.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -15,6 +16,9 @@
 
 #define JCTX_TLS_TASK_INDEX 0
 
+static m_slab_cache_t g_job_ctx_cache =
+        M_SLAB_CACHE_INITIALIZER("job_ctx", job_ctx_t);
+
 typedef struct {
     job_ctx_field_id_t id;
     job_ctx_field_type_t type;
@@ -327,12 +331,11 @@ static job_ctx_error_t jctx_copy_from_buffer(const job_ctx_field_descriptor_t *d
     return JOB_CTX_OK;
 }
 
-job_ctx_t *jctx_create(m_job_id_t job_id, m_job_id_t parent_job_id)
+static void jctx_init(job_ctx_t *ctx,
+                      m_job_id_t job_id,
+                      m_job_id_t parent_job_id,
+                      m_timer_time_t now)
 {
-    job_ctx_t *ctx = pvPortMalloc(sizeof(*ctx));
-    if (ctx == NULL) {
-        return NULL;
-    }
     memset(ctx, 0, sizeof(*ctx));
     ctx->job_id = job_id;
     ctx->parent_job_id = parent_job_id;
@@ -342,16 +345,60 @@ job_ctx_t *jctx_create(m_job_id_t job_id, m_job_id_t parent_job_id)
     ctx->egid = 0;
     ctx->cwd[0] = '/';
     ctx->cwd[1] = '\0';
-    ctx->trace_id = ((uint64_t)(uintptr_t)job_id << 32) ^ m_timer_get_monotonic();
-    ctx->submitted_at = m_timer_get_monotonic();
+    ctx->trace_id = ((uint64_t)(uintptr_t)job_id << 32) ^ now;
+    ctx->submitted_at = now;
     ctx->deadline.infinite = true;
     ctx->internal.scheduler_state = JOB_CTX_SCHED_STATE_PENDING;
     ctx->internal.refcount = 1;
     ctx->internal.cancelled = false;
     ctx->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+}
+
+job_ctx_t *jctx_create(m_job_id_t job_id, m_job_id_t parent_job_id)
+{
+    job_ctx_t *ctx = m_slab_alloc(&g_job_ctx_cache);
+    if (ctx == NULL) {
+        return NULL;
+    }
+    jctx_init(ctx, job_id, parent_job_id, m_timer_get_monotonic());
     return ctx;
 }
 
+bool jctx_create_bulk(m_job_id_t const *job_ids,
+                      m_job_id_t parent_job_id,
+                      job_ctx_t **out,
+                      size_t count)
+{
+    size_t got = m_slab_alloc_bulk(&g_job_ctx_cache, (void **)out, count);
+    if (got < count) {
+        for (size_t i = 0; i < got; ++i) {
+            m_slab_free(&g_job_ctx_cache, out[i]);
+        }
+        return false;
+    }
+
+    m_timer_time_t now = m_timer_get_monotonic();
+    for (size_t i = 0; i < count; ++i) {
+        jctx_init(out[i], job_ids[i], parent_job_id, now);
+    }
+    return true;
+}
+
+void jctx_inherit_identity(job_ctx_t *dst, job_ctx_t *src)
+{
+    if (dst == NULL || src == NULL) {
+        return;
+    }
+    jctx_lock_ctx(src);
+    dst->uid = src->uid;
+    dst->gid = src->gid;
+    dst->euid = src->euid;
+    dst->egid = src->egid;
+    memcpy(dst->cwd, src->cwd, sizeof(dst->cwd));
+    dst->trace_id = src->trace_id;
+    jctx_unlock_ctx(src);
+}
+
 void jctx_acquire(job_ctx_t *ctx)
 {
     if (ctx == NULL) {
@@ -396,7 +443,7 @@ void jctx_release(job_ctx_t *ctx)
             }
         }
         m_alloc_teardown_job_ctx(ctx);
-        vPortFree(ctx);
+        m_slab_free(&g_job_ctx_cache, ctx);
     }
 }
 
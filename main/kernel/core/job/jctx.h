@@ -52,6 +52,11 @@ struct job_ctx {
 };
 
 job_ctx_t *jctx_create(m_job_id_t job_id, m_job_id_t parent_job_id);
+bool jctx_create_bulk(m_job_id_t const *job_ids,
+                      m_job_id_t parent_job_id,
+                      job_ctx_t **out,
+                      size_t count);
+void jctx_inherit_identity(job_ctx_t *dst, job_ctx_t *src);
 void jctx_acquire(job_ctx_t *ctx);
 void jctx_release(job_ctx_t *ctx);
 job_ctx_t *jctx_current(void);
@@ -1,7 +1,7 @@
 /**
  * @file        m_job.h
  * @brief       Public job subsystem API aggregator.
- * @details     Re-exports the queue, future, wait, result, and diagnostic interfaces.
+ * @details     Re-exports the queue, future, graph, wait, result, and diagnostic interfaces.
  */
 #ifndef MAGNOLIA_JOB_M_JOB_H
 #define MAGNOLIA_JOB_M_JOB_H
@@ -12,6 +12,7 @@
 #include "kernel/core/job/m_job_queue.h"
 #include "kernel/core/job/m_job_result.h"
 #include "kernel/core/job/m_job_future.h"
+#include "kernel/core/job/m_job_graph.h"
 #include "kernel/core/job/m_job_wait.h"
 #include "kernel/core/job/m_job_diag.h"
 
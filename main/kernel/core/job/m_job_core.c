@@ -11,9 +11,17 @@
 #include "freertos/FreeRTOS.h"
 #include "kernel/core/job/m_job_core.h"
 #include "kernel/core/job/m_job_event.h"
+#include "kernel/core/job/m_job_graph.h"
 #include "kernel/core/job/jctx.h"
+#include "kernel/core/memory/m_slab.h"
 #include "kernel/core/timer/m_timer.h"
 
+static m_slab_cache_t g_job_handle_cache =
+        M_SLAB_CACHE_INITIALIZER("job_handle", m_job_handle_t);
+
+/* Batched contexts are created in chunks so the scratch array stays small. */
+#define M_JOB_BATCH_CHUNK 16
+
 /**
  * @brief   Zero-initialize a job handle before submission.
  */
@@ -25,6 +33,7 @@ static void _m_job_handle_init(m_job_handle_t *handle,
     handle->handler = handler;
     handle->data = data;
     handle->state = M_JOB_STATE_PENDING;
+    handle->deadline.infinite = true;
     handle->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
     ipc_wait_queue_init(&handle->waiters);
 }
@@ -46,6 +55,16 @@ void _m_job_handle_set_result(m_job_handle_t *handle,
     ipc_wake_all(&handle->waiters, IPC_WAIT_RESULT_OK);
 }
 
+struct m_job_continuation *_m_job_handle_detach_continuations(m_job_handle_t *handle)
+{
+    if (!handle->result_ready) {
+        return NULL;
+    }
+    struct m_job_continuation *list = handle->continuations;
+    handle->continuations = NULL;
+    return list;
+}
+
 void _m_job_handle_record_cancellation(m_job_handle_t *handle)
 {
     if (handle->result_ready || handle->destroyed) {
@@ -69,7 +88,7 @@ m_job_handle_t *_m_job_handle_create(m_job_handler_t handler,
                                       void *data,
                                       m_job_id_t parent_job)
 {
-    m_job_handle_t *handle = pvPortMalloc(sizeof(*handle));
+    m_job_handle_t *handle = m_slab_alloc(&g_job_handle_cache);
     if (handle == NULL) {
         return NULL;
     }
@@ -77,13 +96,83 @@ m_job_handle_t *_m_job_handle_create(m_job_handler_t handler,
     _m_job_handle_init(handle, handler, data);
     handle->ctx = jctx_create(handle, parent_job);
     if (handle->ctx == NULL) {
-        vPortFree(handle);
+        m_slab_free(&g_job_handle_cache, handle);
+        return NULL;
+    }
+    handle->result.status = M_JOB_RESULT_ERROR;
+    return handle;
+}
+
+m_job_handle_t *_m_job_handle_create_lite(m_job_handler_t handler, void *data)
+{
+    m_job_handle_t *handle = m_slab_alloc(&g_job_handle_cache);
+    if (handle == NULL) {
         return NULL;
     }
+
+    _m_job_handle_init(handle, handler, data);
+    handle->lite = true;
+    handle->owner_ctx = jctx_current();
+    jctx_acquire(handle->owner_ctx);
     handle->result.status = M_JOB_RESULT_ERROR;
     return handle;
 }
 
+bool _m_job_handle_create_batch(const m_job_handler_t *handlers,
+                                void *const *data,
+                                size_t count,
+                                m_job_id_t parent_job,
+                                m_job_handle_t **out)
+{
+    size_t got = m_slab_alloc_bulk(&g_job_handle_cache, (void **)out, count);
+    if (got < count) {
+        for (size_t i = 0; i < got; ++i) {
+            m_slab_free(&g_job_handle_cache, out[i]);
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        _m_job_handle_init(out[i], handlers[i], data ? data[i] : NULL);
+        out[i]->result.status = M_JOB_RESULT_ERROR;
+    }
+
+    job_ctx_t *ctxs[M_JOB_BATCH_CHUNK];
+    for (size_t done = 0; done < count;) {
+        size_t chunk = count - done;
+        if (chunk > M_JOB_BATCH_CHUNK) {
+            chunk = M_JOB_BATCH_CHUNK;
+        }
+        if (!jctx_create_bulk((m_job_id_t const *)&out[done],
+                              parent_job,
+                              ctxs,
+                              chunk)) {
+            for (size_t i = 0; i < done; ++i) {
+                jctx_release(out[i]->ctx);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                m_slab_free(&g_job_handle_cache, out[i]);
+            }
+            return false;
+        }
+        for (size_t i = 0; i < chunk; ++i) {
+            out[done + i]->ctx = ctxs[i];
+        }
+        done += chunk;
+    }
+    return true;
+}
+
+void _m_job_handle_discard(m_job_handle_t *handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    jctx_release(handle->ctx);
+    jctx_release(handle->owner_ctx);
+    m_slab_free(&g_job_handle_cache, handle);
+}
+
 m_job_error_t m_job_cancel(m_job_id_t job)
 {
 #if CONFIG_MAGNOLIA_JOB_ENABLE_CANCELLATION
@@ -97,7 +186,9 @@ m_job_error_t m_job_cancel(m_job_id_t job)
         return M_JOB_ERR_STATE;
     }
     _m_job_handle_record_cancellation(job);
+    m_job_continuation_t *continuations = _m_job_handle_detach_continuations(job);
     portEXIT_CRITICAL(&job->lock);
+    _m_job_continuations_run(continuations);
     return M_JOB_OK;
 #else
     (void)job;
@@ -120,7 +211,7 @@ m_job_error_t m_job_handle_destroy(m_job_id_t job)
         portEXIT_CRITICAL(&job->lock);
         return M_JOB_ERR_NOT_READY;
     }
-    if (job->future_count > 0) {
+    if (job->future_count > 0 || job->pending_deps > 0) {
         portEXIT_CRITICAL(&job->lock);
         return M_JOB_ERR_BUSY;
     }
@@ -154,10 +245,56 @@ m_job_error_t m_job_handle_destroy(m_job_id_t job)
         jctx_release(job->ctx);
         job->ctx = NULL;
     }
-    vPortFree(job);
+    jctx_release(job->owner_ctx);
+    job->owner_ctx = NULL;
+    m_slab_free(&g_job_handle_cache, job);
     return M_JOB_OK;
 }
 
+/**
+ * @brief   Take a reference on the job's own context, creating it for lite
+ *          jobs on first use.
+ *
+ * A materialized context inherits identity and cwd from the submitter.
+ */
+static job_ctx_t *_m_job_handle_acquire_ctx(m_job_id_t job)
+{
+    portENTER_CRITICAL(&job->lock);
+    if (job->destroyed) {
+        portEXIT_CRITICAL(&job->lock);
+        return NULL;
+    }
+    job_ctx_t *ctx = job->ctx;
+    job_ctx_t *owner = job->owner_ctx;
+    jctx_acquire(ctx);
+    jctx_acquire(owner);
+    bool lite = job->lite;
+    portEXIT_CRITICAL(&job->lock);
+
+    if (ctx != NULL || !lite) {
+        jctx_release(owner);
+        return ctx;
+    }
+
+    job_ctx_t *fresh = jctx_create(job, owner ? owner->job_id : NULL);
+    jctx_inherit_identity(fresh, owner);
+    jctx_release(owner);
+    if (fresh == NULL) {
+        return NULL;
+    }
+
+    portENTER_CRITICAL(&job->lock);
+    if (job->ctx == NULL && !job->destroyed) {
+        job->ctx = fresh;
+        fresh = NULL;
+    }
+    ctx = job->ctx;
+    jctx_acquire(ctx);
+    portEXIT_CRITICAL(&job->lock);
+    jctx_release(fresh);
+    return ctx;
+}
+
 job_ctx_error_t m_job_field_get(m_job_id_t job,
                                 job_ctx_field_id_t field,
                                 void *out_buf,
@@ -167,16 +304,11 @@ job_ctx_error_t m_job_field_get(m_job_id_t job,
         return JOB_CTX_ERR_INVALID_PARAM;
     }
 
-    portENTER_CRITICAL(&job->lock);
-    if (job->destroyed || job->ctx == NULL) {
-        portEXIT_CRITICAL(&job->lock);
+    job_ctx_t *ctx = _m_job_handle_acquire_ctx(job);
+    if (ctx == NULL) {
         return JOB_CTX_ERR_INVALID_FIELD;
     }
 
-    job_ctx_t *ctx = job->ctx;
-    jctx_acquire(ctx);
-    portEXIT_CRITICAL(&job->lock);
-
     job_ctx_field_policy_t policy = jctx_field_policy(field);
     if (policy == JOB_CTX_FIELD_POLICY_PRIVATE) {
         jctx_release(ctx);
@@ -197,24 +329,21 @@ job_ctx_error_t m_job_field_set(m_job_id_t job,
         return JOB_CTX_ERR_INVALID_PARAM;
     }
 
-    portENTER_CRITICAL(&job->lock);
-    if (job->destroyed || job->ctx == NULL) {
-        portEXIT_CRITICAL(&job->lock);
+    job_ctx_t *ctx = _m_job_handle_acquire_ctx(job);
+    if (ctx == NULL) {
         return JOB_CTX_ERR_INVALID_FIELD;
     }
 
-    job_ctx_t *ctx = job->ctx;
-    jctx_acquire(ctx);
-    portEXIT_CRITICAL(&job->lock);
-
     job_ctx_field_policy_t policy = jctx_field_policy(field);
     if (policy != JOB_CTX_FIELD_POLICY_PUBLIC) {
         jctx_release(ctx);
         return JOB_CTX_ERR_NO_PERMISSION;
     }
 
+    /* A running lite job's current context is its submitter's. */
     job_ctx_t *current = jctx_current();
-    if (current == NULL || current->job_id != job) {
+    if (current == NULL
+        || (current->job_id != job && !(job->lite && current == job->owner_ctx))) {
         jctx_release(ctx);
         return JOB_CTX_ERR_NO_PERMISSION;
     }
@@ -28,6 +28,9 @@ extern "C" {
 typedef struct m_job_handle m_job_handle_t;
 typedef m_job_handle_t *m_job_id_t;
 
+struct m_job_queue;
+struct m_job_continuation;
+
 /**
  * @brief   Result status produced by job handlers.
  */
@@ -89,7 +92,20 @@ struct m_job_handle {
     m_job_handler_t handler;
     void *data;
     job_ctx_t *ctx;
+    /* Lite jobs run in their submitter's context (NULL for kernel tasks)
+     * and only get a ctx of their own on first field access. */
+    job_ctx_t *owner_ctx;
+    bool lite;
     m_job_state_t state;
+    /* Dispatch order within a queue: class, then deadline, then sequence. */
+    uint32_t priority;
+    m_timer_deadline_t deadline;
+    size_t sequence;
+    /* Queue the job was submitted to, or will be once pending_deps drops to
+     * zero; continuations waiting on this job hang off continuations. */
+    struct m_job_queue *queue;
+    size_t pending_deps;
+    struct m_job_continuation *continuations;
     bool cancelled;
     bool destroyed;
     bool result_ready;
@@ -120,7 +136,8 @@ m_job_error_t m_job_cancel(m_job_id_t job);
  * @return  M_JOB_ERR_INVALID_HANDLE Job handle pointer was NULL.
  * @return  M_JOB_ERR_DESTROYED  Job handle already destroyed.
  * @return  M_JOB_ERR_NOT_READY  Job result is not ready yet.
- * @return  M_JOB_ERR_BUSY       Job has attached futures preventing destruction.
+ * @return  M_JOB_ERR_BUSY       Job has attached futures or still waits on
+ *                               predecessors, preventing destruction.
  */
 m_job_error_t m_job_handle_destroy(m_job_id_t job);
 
@@ -147,6 +164,33 @@ m_job_handle_t *_m_job_handle_create(m_job_handler_t handler,
                                       void *data,
                                       m_job_id_t parent_job);
 
+/**
+ * @brief   Allocate a job handle that borrows the caller's job context.
+ */
+m_job_handle_t *_m_job_handle_create_lite(m_job_handler_t handler, void *data);
+
+/**
+ * @brief   Allocate @p count handles and their contexts in bulk; all or none.
+ */
+bool _m_job_handle_create_batch(const m_job_handler_t *handlers,
+                                void *const *data,
+                                size_t count,
+                                m_job_id_t parent_job,
+                                m_job_handle_t **out);
+
+/**
+ * @brief   Free a handle that was created but never submitted.
+ */
+void _m_job_handle_discard(m_job_handle_t *handle);
+
+/**
+ * @brief   Take the continuation list of a job that now has a result.
+ *
+ * Call with the job lock held, in the same critical section that recorded
+ * the result, and pass the list to _m_job_continuations_run() afterwards.
+ */
+struct m_job_continuation *_m_job_handle_detach_continuations(m_job_handle_t *handle);
+
 /**
  * @brief   Record that a job handler completed with the provided result.
  */
@@ -0,0 +1,243 @@
+/**
+ * @file        m_job_graph.c
+ * @brief       Job continuations and dependency graph implementation.
+ * @details     A dependent job is created and given a queue slot up front but
+ *              only published once its pending predecessor count drops to
+ *              zero. The count starts at one as a guard held by the submitter,
+ *              so predecessors finishing during setup cannot release it early.
+ */
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "kernel/core/job/m_job_graph.h"
+#include "kernel/core/memory/m_slab.h"
+
+static m_slab_cache_t g_job_continuation_cache =
+        M_SLAB_CACHE_INITIALIZER("job_continuation", m_job_continuation_t);
+
+/**
+ * @brief   Free a list of unused continuation links.
+ */
+static void _m_job_links_free(m_job_continuation_t *links)
+{
+    while (links != NULL) {
+        m_job_continuation_t *next = links->next;
+        m_slab_free(&g_job_continuation_cache, links);
+        links = next;
+    }
+}
+
+/**
+ * @brief   Allocate @p count continuation links chained through next.
+ *
+ * Links are taken before any job is linked so that running out of memory
+ * never leaves a graph half wired.
+ */
+static m_job_error_t _m_job_links_alloc(size_t count,
+                                        m_job_continuation_t **out)
+{
+    m_job_continuation_t *links = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        m_job_continuation_t *link = m_slab_alloc(&g_job_continuation_cache);
+        if (link == NULL) {
+            _m_job_links_free(links);
+            return M_JOB_ERR_NO_MEMORY;
+        }
+        link->dependent = NULL;
+        link->next = links;
+        links = link;
+    }
+    *out = links;
+    return M_JOB_OK;
+}
+
+/**
+ * @brief   Create a dependent job holding its reserved slot and the guard.
+ */
+static m_job_error_t _m_job_dependent_prepare(m_job_queue_t *queue,
+                                              m_job_handler_t handler,
+                                              void *data,
+                                              m_job_handle_t **out)
+{
+    m_job_error_t err = _m_job_queue_prepare(queue, handler, data, out);
+    if (err == M_JOB_OK) {
+        (*out)->pending_deps = 1;
+    }
+    return err;
+}
+
+/**
+ * @brief   Drop one pending predecessor and queue the dependent at zero.
+ *
+ * A dependent cancelled while it waited only gives its slot back.
+ */
+static void _m_job_dependent_release(m_job_handle_t *dependent)
+{
+    portENTER_CRITICAL(&dependent->lock);
+    size_t remaining = --dependent->pending_deps;
+    bool cancelled = dependent->result_ready;
+    m_job_queue_t *queue = dependent->queue;
+    portEXIT_CRITICAL(&dependent->lock);
+
+    if (remaining > 0) {
+        return;
+    }
+    if (cancelled) {
+        _m_job_queue_release_slot(queue);
+    } else {
+        _m_job_queue_commit(queue, dependent);
+    }
+}
+
+/**
+ * @brief   Make @p dependent wait for @p job, consuming @p link.
+ *
+ * Lock order is predecessor, then dependent. A predecessor that already has
+ * a result does not hold the dependent back.
+ */
+static void _m_job_depend_on(m_job_handle_t *job,
+                             m_job_handle_t *dependent,
+                             m_job_continuation_t *link)
+{
+    portENTER_CRITICAL(&job->lock);
+    if (job->result_ready) {
+        portEXIT_CRITICAL(&job->lock);
+        m_slab_free(&g_job_continuation_cache, link);
+        return;
+    }
+    portENTER_CRITICAL(&dependent->lock);
+    dependent->pending_deps++;
+    portEXIT_CRITICAL(&dependent->lock);
+    link->dependent = dependent;
+    link->next = job->continuations;
+    job->continuations = link;
+    portEXIT_CRITICAL(&job->lock);
+}
+
+void _m_job_continuations_run(m_job_continuation_t *list)
+{
+    while (list != NULL) {
+        m_job_continuation_t *next = list->next;
+        _m_job_dependent_release(list->dependent);
+        m_slab_free(&g_job_continuation_cache, list);
+        list = next;
+    }
+}
+
+m_job_error_t m_job_then(m_job_id_t job,
+                         m_job_handler_t handler,
+                         void *data,
+                         m_job_handle_t **out_handle)
+{
+    if (job == NULL || job->queue == NULL) {
+        return M_JOB_ERR_INVALID_HANDLE;
+    }
+    return m_job_when_all(job->queue, &job, 1, handler, data, out_handle);
+}
+
+m_job_error_t m_job_when_all(m_job_queue_t *queue,
+                             const m_job_id_t *jobs,
+                             size_t count,
+                             m_job_handler_t handler,
+                             void *data,
+                             m_job_handle_t **out_handle)
+{
+    if (queue == NULL || handler == NULL || (jobs == NULL && count > 0)) {
+        return M_JOB_ERR_INVALID_PARAM;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (jobs[i] == NULL) {
+            return M_JOB_ERR_INVALID_HANDLE;
+        }
+        /* The dependent holds a raw pointer to its queue; only the drain in
+         * m_job_queue_destroy() of that same queue can release it safely. */
+        if (jobs[i]->queue != queue) {
+            return M_JOB_ERR_INVALID_PARAM;
+        }
+    }
+
+    m_job_continuation_t *links = NULL;
+    m_job_error_t err = _m_job_links_alloc(count, &links);
+    if (err != M_JOB_OK) {
+        return err;
+    }
+
+    m_job_handle_t *dependent = NULL;
+    err = _m_job_dependent_prepare(queue, handler, data, &dependent);
+    if (err != M_JOB_OK) {
+        _m_job_links_free(links);
+        return err;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        m_job_continuation_t *link = links;
+        links = link->next;
+        _m_job_depend_on(jobs[i], dependent, link);
+    }
+    _m_job_dependent_release(dependent);
+    if (out_handle != NULL) {
+        *out_handle = dependent;
+    }
+    return M_JOB_OK;
+}
+
+m_job_error_t m_job_graph_submit(m_job_queue_t *queue,
+                                 m_job_graph_node_t *nodes,
+                                 size_t count)
+{
+    if (queue == NULL || nodes == NULL || count == 0) {
+        return M_JOB_ERR_INVALID_PARAM;
+    }
+
+    size_t edges = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (nodes[i].handler == NULL
+                || (nodes[i].deps == NULL && nodes[i].dep_count > 0)) {
+            return M_JOB_ERR_INVALID_PARAM;
+        }
+        for (size_t d = 0; d < nodes[i].dep_count; ++d) {
+            if (nodes[i].deps[d] >= i) {
+                return M_JOB_ERR_INVALID_PARAM;
+            }
+        }
+        edges += nodes[i].dep_count;
+        nodes[i].handle = NULL;
+    }
+
+    m_job_continuation_t *links = NULL;
+    m_job_error_t err = _m_job_links_alloc(edges, &links);
+    if (err != M_JOB_OK) {
+        return err;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        m_job_graph_node_t *node = &nodes[i];
+        if (node->dep_count == 0) {
+            err = m_job_queue_submit_with_handle(queue,
+                                                 node->handler,
+                                                 node->data,
+                                                 &node->handle);
+            if (err != M_JOB_OK) {
+                break;
+            }
+            continue;
+        }
+
+        err = _m_job_dependent_prepare(queue, node->handler, node->data,
+                                       &node->handle);
+        if (err != M_JOB_OK) {
+            node->handle = NULL;
+            break;
+        }
+        for (size_t d = 0; d < node->dep_count; ++d) {
+            m_job_handle_t *job = nodes[node->deps[d]].handle;
+            m_job_continuation_t *link = links;
+            links = link->next;
+            _m_job_depend_on(job, node->handle, link);
+        }
+        _m_job_dependent_release(node->handle);
+    }
+
+    _m_job_links_free(links);
+    return err;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file        m_job_graph.h
+ * @brief       Job continuations and dependency graphs.
+ * @details     Dependents are queued by whichever thread completes their last
+ *              predecessor, so multi-stage pipelines run without parking a
+ *              worker on intermediate results.
+ */
+#ifndef MAGNOLIA_JOB_M_JOB_GRAPH_H
+#define MAGNOLIA_JOB_M_JOB_GRAPH_H
+
+#include <stddef.h>
+
+#include "sdkconfig.h"
+#include "kernel/core/job/m_job_core.h"
+#include "kernel/core/job/m_job_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Link from a predecessor to a job waiting on it.
+ */
+typedef struct m_job_continuation {
+    m_job_handle_t *dependent;
+    struct m_job_continuation *next;
+} m_job_continuation_t;
+
+/**
+ * @brief   One node of a job graph passed to m_job_graph_submit().
+ *
+ * @p deps holds indices of earlier nodes; the graph must be listed in
+ * topological order. @p handle receives the node's job handle.
+ */
+typedef struct {
+    m_job_handler_t handler;
+    void *data;
+    const size_t *deps;
+    size_t dep_count;
+    m_job_handle_t *handle;
+} m_job_graph_node_t;
+
+/**
+ * @brief   Run @p handler on the queue of @p job once @p job has a result.
+ *
+ * Dependents run whatever the status of their predecessors; use
+ * m_job_query_result() on a predecessor to inspect it. A queue slot is
+ * reserved for the dependent up front, so completing the predecessor never
+ * blocks. A dependent cannot be destroyed while predecessors are pending.
+ * The dependent runs on the same queue as @p job; destroying that queue
+ * cancels it along with the jobs it waits on.
+ *
+ * @return  M_JOB_ERR_INVALID_HANDLE when @p job was never queued.
+ */
+m_job_error_t m_job_then(m_job_id_t job,
+                         m_job_handler_t handler,
+                         void *data,
+                         m_job_handle_t **out_handle);
+
+/**
+ * @brief   Run @p handler on @p queue once every job in @p jobs has a result.
+ *
+ * Every job in @p jobs must have been submitted to @p queue. Edges across
+ * queues are rejected, because the dependent's reserved slot would outlive
+ * its queue if that queue were destroyed before a foreign predecessor
+ * finished.
+ *
+ * @return  M_JOB_ERR_INVALID_PARAM when a job belongs to another queue.
+ */
+m_job_error_t m_job_when_all(m_job_queue_t *queue,
+                             const m_job_id_t *jobs,
+                             size_t count,
+                             m_job_handler_t handler,
+                             void *data,
+                             m_job_handle_t **out_handle);
+
+/**
+ * @brief   Submit a dependency graph to @p queue.
+ *
+ * Nodes without dependencies are queued immediately; the others are queued
+ * as their predecessors complete. On error, nodes already submitted keep
+ * running and have their handle set; the rest are left NULL.
+ */
+m_job_error_t m_job_graph_submit(m_job_queue_t *queue,
+                                 m_job_graph_node_t *nodes,
+                                 size_t count);
+
+/**
+ * @brief   Release the dependents detached from a completed job.
+ *
+ * Internal: called by whoever recorded the result, after dropping the job
+ * lock, with the list returned by _m_job_handle_detach_continuations().
+ */
+void _m_job_continuations_run(m_job_continuation_t *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAGNOLIA_JOB_M_JOB_GRAPH_H */
@@ -3,6 +3,7 @@
  * @brief       Implements the Magnolia job queue operations.
  */
 
+#include <stdint.h>
 #include <string.h>
 
 #include "sdkconfig.h"
@@ -10,6 +11,7 @@
 #include "kernel/core/job/m_job_queue.h"
 #include "kernel/core/job/m_job_worker.h"
 #include "kernel/core/job/m_job_core.h"
+#include "kernel/core/job/m_job_graph.h"
 #include "kernel/core/timer/m_timer.h"
 #include "kernel/core/sched/m_sched.h"
 
@@ -168,135 +170,832 @@ static void _m_job_submit_wait_remove_locked(m_job_queue_t *queue,
 }
 
 /**
- * @brief   Enqueue a job and wake a waiting worker.
+ * @brief   Claim up to @p max units of queue capacity without the lock.
+ *
+ * @return  Number of units claimed, 0 when the queue is full.
  */
-static void _m_job_enqueue_job_locked(m_job_queue_t *queue,
-                                      m_job_handle_t *job)
+static size_t _m_job_slots_try_reserve(m_job_queue_t *queue, size_t max)
 {
-    queue->ring[queue->tail] = job;
-    queue->tail = (queue->tail + 1) % queue->capacity;
-    queue->count++;
-    queue->stats.submitted++;
-    _m_job_wake_worker_locked(queue);
+    size_t free_slots = atomic_load_explicit(&queue->free_slots,
+                                             memory_order_relaxed);
+    while (free_slots > 0) {
+        size_t take = (free_slots < max) ? free_slots : max;
+        if (atomic_compare_exchange_weak_explicit(&queue->free_slots,
+                                                  &free_slots,
+                                                  free_slots - take,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            return take;
+        }
+    }
+    return 0;
 }
 
 /**
- * @brief   Wait for free space in the queue, optionally with a deadline.
+ * @brief   Claim one unit of queue capacity without taking the lock.
  */
-static m_job_error_t _m_job_wait_for_space(m_job_queue_t *queue,
-                                            const m_timer_deadline_t *deadline)
+static bool _m_job_slot_try_reserve(m_job_queue_t *queue)
 {
-    m_job_submit_wait_node_t *node = NULL;
-    while (queue->count >= queue->capacity) {
-        if (queue->destroyed) {
-            _m_job_queue_unlock(queue);
-            return M_JOB_ERR_DESTROYED;
+    return _m_job_slots_try_reserve(queue, 1) == 1;
+}
+
+/**
+ * @brief   Publish a job into a reserved ring cell.
+ *
+ * The capacity reservation guarantees a free cell, so producers only ever
+ * race each other for the enqueue position.
+ */
+static void _m_job_ring_push(m_job_queue_t *queue,
+                             m_job_queue_level_t *level,
+                             m_job_handle_t *job)
+{
+    size_t pos = atomic_load_explicit(&level->enqueue_pos, memory_order_relaxed);
+    m_job_queue_slot_t *slot;
+    for (;;) {
+        slot = &level->ring[pos & queue->ring_mask];
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&level->enqueue_pos,
+                                                      &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else {
+            pos = atomic_load_explicit(&level->enqueue_pos, memory_order_relaxed);
         }
+    }
 
-        if (queue->shutdown_requested) {
-            _m_job_queue_unlock(queue);
-            return M_JOB_ERR_SHUTDOWN;
+    slot->job = job;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+}
+
+/**
+ * @brief   Pop the oldest published job, or NULL when none is visible.
+ */
+static m_job_handle_t *_m_job_ring_pop(m_job_queue_t *queue,
+                                       m_job_queue_level_t *level)
+{
+    size_t pos = atomic_load_explicit(&level->dequeue_pos, memory_order_relaxed);
+    m_job_queue_slot_t *slot;
+    for (;;) {
+        slot = &level->ring[pos & queue->ring_mask];
+        size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&level->dequeue_pos,
+                                                      &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&level->dequeue_pos, memory_order_relaxed);
         }
+    }
 
-        if (node == NULL) {
-            node = pvPortMalloc(sizeof(*node));
-            if (node == NULL) {
-                _m_job_queue_unlock(queue);
-                return M_JOB_ERR_NO_MEMORY;
+    m_job_handle_t *job = slot->job;
+    atomic_store_explicit(&slot->sequence,
+                          pos + queue->ring_mask + 1,
+                          memory_order_release);
+    return job;
+}
+
+/**
+ * @brief   Whether @p a should be dispatched before @p b within one class.
+ */
+static bool _m_job_runs_before(const m_job_handle_t *a, const m_job_handle_t *b)
+{
+    if (a->deadline.infinite != b->deadline.infinite) {
+        return !a->deadline.infinite;
+    }
+    if (!a->deadline.infinite && a->deadline.target != b->deadline.target) {
+        return a->deadline.target < b->deadline.target;
+    }
+    return (intptr_t)(a->sequence - b->sequence) < 0;
+}
+
+/**
+ * @brief   Insert a job into a deadline-ordered class.
+ *
+ * The heap holds as many entries as a ring, so a reserved slot always fits.
+ */
+static void _m_job_heap_push(m_job_queue_level_t *level, m_job_handle_t *job)
+{
+    portENTER_CRITICAL(&level->heap_lock);
+    size_t i = level->heap_count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!_m_job_runs_before(job, level->heap[parent])) {
+            break;
+        }
+        level->heap[i] = level->heap[parent];
+        i = parent;
+    }
+    level->heap[i] = job;
+    portEXIT_CRITICAL(&level->heap_lock);
+}
+
+/**
+ * @brief   Remove the job with the earliest deadline from a class.
+ */
+static m_job_handle_t *_m_job_heap_pop(m_job_queue_level_t *level)
+{
+    portENTER_CRITICAL(&level->heap_lock);
+    if (level->heap_count == 0) {
+        portEXIT_CRITICAL(&level->heap_lock);
+        return NULL;
+    }
+    m_job_handle_t *top = level->heap[0];
+    m_job_handle_t *last = level->heap[--level->heap_count];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= level->heap_count) {
+            break;
+        }
+        if (child + 1 < level->heap_count
+            && _m_job_runs_before(level->heap[child + 1], level->heap[child])) {
+            child++;
+        }
+        if (!_m_job_runs_before(level->heap[child], last)) {
+            break;
+        }
+        level->heap[i] = level->heap[child];
+        i = child;
+    }
+    if (level->heap_count > 0) {
+        level->heap[i] = last;
+    }
+    portEXIT_CRITICAL(&level->heap_lock);
+    return top;
+}
+
+/**
+ * @brief   Cheap emptiness hint for a class; may race with push and pop.
+ */
+static bool _m_job_level_has_work(const m_job_queue_t *queue,
+                                  m_job_queue_level_t *level)
+{
+    if (queue->deadline_dispatch) {
+        return level->heap_count > 0;
+    }
+    return atomic_load_explicit(&level->enqueue_pos, memory_order_relaxed)
+           != atomic_load_explicit(&level->dequeue_pos, memory_order_relaxed);
+}
+
+static m_job_handle_t *_m_job_level_pop(m_job_queue_t *queue,
+                                        m_job_queue_level_t *level)
+{
+    if (queue->deadline_dispatch) {
+        return _m_job_heap_pop(level);
+    }
+    return _m_job_ring_pop(queue, level);
+}
+
+/**
+ * @brief   Queue a job on the shared class matching its priority.
+ */
+static void _m_job_shared_push(m_job_queue_t *queue, m_job_handle_t *job)
+{
+    size_t index = job->priority;
+    if (index >= queue->level_count) {
+        index = queue->level_count - 1;
+    }
+    m_job_queue_level_t *level = &queue->levels[index];
+    if (queue->deadline_dispatch) {
+        job->sequence = atomic_fetch_add_explicit(&queue->sequence, 1,
+                                                  memory_order_relaxed);
+        _m_job_heap_push(level, job);
+    } else {
+        _m_job_ring_push(queue, level, job);
+    }
+}
+
+/**
+ * @brief   Take the next job from the shared classes.
+ *
+ * The most urgent class with work wins, except that after starvation_limit
+ * such dispatches in a row while a less urgent class waits, one job of a
+ * waiting class runs. The waiting classes are served round-robin so a
+ * middle class cannot be skipped forever either.
+ */
+static m_job_handle_t *_m_job_shared_pop(m_job_queue_t *queue)
+{
+    if (queue->level_count == 1) {
+        return _m_job_level_pop(queue, &queue->levels[0]);
+    }
+
+    if (queue->starvation_limit > 0
+        && atomic_load_explicit(&queue->starvation_streak, memory_order_relaxed)
+                   >= queue->starvation_limit) {
+        size_t top = 0;
+        while (top < queue->level_count
+               && !_m_job_level_has_work(queue, &queue->levels[top])) {
+            top++;
+        }
+        atomic_store_explicit(&queue->starvation_streak, 0, memory_order_relaxed);
+        if (top + 1 < queue->level_count) {
+            size_t waiting = queue->level_count - top - 1;
+            unsigned cursor = atomic_fetch_add_explicit(&queue->starvation_cursor,
+                                                        1,
+                                                        memory_order_relaxed);
+            for (size_t i = 0; i < waiting; ++i) {
+                size_t index = top + 1 + (cursor + i) % waiting;
+                m_job_handle_t *job =
+                        _m_job_level_pop(queue, &queue->levels[index]);
+                if (job != NULL) {
+                    return job;
+                }
             }
-            memset(node, 0, sizeof(*node));
-            m_sched_wait_context_prepare_with_reason(&node->ctx,
-                                                     M_SCHED_WAIT_REASON_JOB);
         }
+    }
 
-        node->linked = true;
-        node->next = NULL;
-        if (queue->submit_waiters_tail) {
-            queue->submit_waiters_tail->next = node;
+    for (size_t i = 0; i < queue->level_count; ++i) {
+        m_job_handle_t *job = _m_job_level_pop(queue, &queue->levels[i]);
+        if (job == NULL) {
+            continue;
+        }
+        bool others_waiting = false;
+        for (size_t j = i + 1; j < queue->level_count && !others_waiting; ++j) {
+            others_waiting = _m_job_level_has_work(queue, &queue->levels[j]);
+        }
+        if (others_waiting) {
+            atomic_fetch_add_explicit(&queue->starvation_streak, 1,
+                                      memory_order_relaxed);
         } else {
-            queue->submit_waiters_head = node;
+            atomic_store_explicit(&queue->starvation_streak, 0,
+                                  memory_order_relaxed);
         }
-        queue->submit_waiters_tail = node;
+        return job;
+    }
+    return NULL;
+}
 
-        _m_job_queue_unlock(queue);
-        m_sched_wait_result_t wait_res = m_sched_wait_block(&node->ctx, deadline);
-        _m_job_queue_lock(queue);
+/**
+ * @brief   Push a job onto the bottom of a worker deque.
+ *
+ * Deques hold as many slots as the ring, so a reserved slot always fits.
+ */
+static void _m_job_deque_push(m_job_deque_t *deque, m_job_handle_t *job)
+{
+    portENTER_CRITICAL(&deque->lock);
+    deque->slots[deque->bottom & deque->mask] = job;
+    deque->bottom++;
+    portEXIT_CRITICAL(&deque->lock);
+}
+
+/**
+ * @brief   Pop the newest job from the bottom of the owner's deque.
+ */
+static m_job_handle_t *_m_job_deque_pop(m_job_deque_t *deque)
+{
+    m_job_handle_t *job = NULL;
+    portENTER_CRITICAL(&deque->lock);
+    if (deque->bottom != deque->top) {
+        deque->bottom--;
+        job = deque->slots[deque->bottom & deque->mask];
+    }
+    portEXIT_CRITICAL(&deque->lock);
+    return job;
+}
+
+/**
+ * @brief   Steal the oldest job from the top of a sibling's deque.
+ */
+static m_job_handle_t *_m_job_deque_steal(m_job_deque_t *deque)
+{
+    m_job_handle_t *job = NULL;
+    portENTER_CRITICAL(&deque->lock);
+    if (deque->bottom != deque->top) {
+        job = deque->slots[deque->top & deque->mask];
+        deque->top++;
+    }
+    portEXIT_CRITICAL(&deque->lock);
+    return job;
+}
+
+/**
+ * @brief   Find the worker of @p queue running on the calling task, if any.
+ *
+ * Deques are plain LIFO, so queues dispatching by priority or deadline keep
+ * every job on the shared classes.
+ */
+static m_job_worker_t *_m_job_current_worker(m_job_queue_t *queue)
+{
+    if (!queue->work_stealing || queue->level_count > 1
+        || queue->deadline_dispatch) {
+        return NULL;
+    }
 
-        if (node->linked) {
-            _m_job_submit_wait_remove_locked(queue, node);
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (size_t i = 0; i < queue->worker_count; ++i) {
+        if (queue->workers[i].task_handle == self) {
+            return &queue->workers[i];
         }
+    }
+    return NULL;
+}
 
-        if (wait_res != M_SCHED_WAIT_RESULT_OK) {
-            vPortFree(node);
-            queue->stats.dropped++;
-            m_job_error_t err = (wait_res == M_SCHED_WAIT_RESULT_TIMEOUT)
-                                ? M_JOB_ERR_TIMEOUT
-                                : (wait_res == M_SCHED_WAIT_RESULT_OBJECT_DESTROYED)
-                                        ? M_JOB_ERR_DESTROYED
-                                        : M_JOB_ERR_SHUTDOWN;
-            return err;
+/**
+ * @brief   Steal from siblings, trying workers pinned to the same core first.
+ */
+static m_job_handle_t *_m_job_steal(m_job_queue_t *queue, m_job_worker_t *worker)
+{
+    size_t self = (size_t)(worker - queue->workers);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 1; i < queue->worker_count; ++i) {
+            m_job_worker_t *victim =
+                    &queue->workers[(self + i) % queue->worker_count];
+            bool same_core = (victim->core == worker->core);
+            if (same_core != (pass == 0)) {
+                continue;
+            }
+            m_job_handle_t *job = _m_job_deque_steal(&victim->deque);
+            if (job != NULL) {
+                atomic_fetch_add_explicit(&queue->stats.stolen, 1,
+                                          memory_order_relaxed);
+                return job;
+            }
         }
+    }
+    return NULL;
+}
 
-        vPortFree(node);
-        node = NULL;
+/**
+ * @brief   Pick the next job for a worker: own deque, shared classes, siblings.
+ */
+static m_job_handle_t *_m_job_next_job(m_job_queue_t *queue,
+                                        m_job_worker_t *worker)
+{
+    if (!queue->work_stealing) {
+        return _m_job_shared_pop(queue);
     }
 
-    return M_JOB_OK;
+    m_job_handle_t *job = _m_job_deque_pop(&worker->deque);
+    if (job == NULL) {
+        job = _m_job_shared_pop(queue);
+    }
+    if (job == NULL) {
+        job = _m_job_steal(queue, worker);
+    }
+    return job;
 }
 
-m_job_error_t _m_job_queue_take(m_job_queue_t *queue,
-                                 m_job_handle_t **out,
-                                 m_job_worker_t *worker)
+/*
+ * Waiters publish themselves in worker_waiting/submit_waiting and then
+ * re-check the ring; the fast paths publish to the ring and then check the
+ * counters. The seq_cst fences on both sides make sure at least one of them
+ * observes the other, so a wakeup cannot be lost.
+ */
+
+/**
+ * @brief   Start the worker in slot @p worker; pinned per core when stealing.
+ */
+static m_sched_error_t _m_job_worker_start(m_job_queue_t *queue,
+                                           m_job_worker_t *worker)
 {
-    *out = NULL;
+    size_t index = (size_t)(worker - queue->workers);
+    worker->queue = queue;
+    worker->core = queue->work_stealing
+                           ? (int)(index % portNUM_PROCESSORS)
+                           : M_SCHED_CPU_AFFINITY_ANY;
+    worker->task_id = M_SCHED_TASK_ID_INVALID;
+    worker->task_handle = NULL;
+    worker->waiting = false;
+    worker->retiring = false;
+    worker->next_waiter = NULL;
+    worker->prev_waiter = NULL;
+    m_sched_task_options_t opts = {
+        .entry = m_job_worker_entry,
+        .name = queue->name,
+        .argument = worker,
+        .stack_depth = queue->stack_depth,
+        .priority = queue->worker_priority,
+        .cpu_affinity = worker->core,
+        .tag = "job_worker",
+        .creation_flags = M_SCHED_TASK_FLAG_WORKER,
+        .user_data = queue,
+    };
+    return m_sched_task_create(&opts, &worker->task_id);
+}
+
+/**
+ * @brief   Start one more worker if queued work has no idle worker to take it.
+ *
+ * Caller holds the queue lock. The new worker's start hook blocks on that
+ * lock until its slot is filled in here.
+ */
+static void _m_job_pool_grow_locked(m_job_queue_t *queue)
+{
+    size_t running = atomic_load_explicit(&queue->running_workers,
+                                          memory_order_relaxed);
+    size_t depth = queue->capacity
+                   - atomic_load_explicit(&queue->free_slots, memory_order_relaxed);
+    bool grow = !queue->shutdown_requested && running < queue->worker_count
+                && queue->worker_waiters_head == NULL
+                && (running == 0 || depth >= queue->spawn_threshold);
+    for (size_t i = 0; grow && i < queue->worker_count; ++i) {
+        m_job_worker_t *worker = &queue->workers[i];
+        if (worker->task_id != M_SCHED_TASK_ID_INVALID) {
+            continue;
+        }
+        if (_m_job_worker_start(queue, worker) == M_SCHED_OK) {
+            atomic_store_explicit(&queue->running_workers, running + 1,
+                                  memory_order_relaxed);
+            ++queue->spawned_workers;
+        } else {
+            worker->task_id = M_SCHED_TASK_ID_INVALID;
+        }
+        break;
+    }
+}
+
+static void _m_job_pool_grow(m_job_queue_t *queue)
+{
+    if (!queue->elastic
+        || atomic_load_explicit(&queue->worker_waiting, memory_order_relaxed) > 0
+        || atomic_load_explicit(&queue->running_workers, memory_order_relaxed)
+                   >= queue->worker_count) {
+        return;
+    }
+
+    _m_job_queue_lock(queue);
+    _m_job_pool_grow_locked(queue);
+    _m_job_queue_unlock(queue);
+}
+
+void _m_job_queue_refill_locked(m_job_queue_t *queue)
+{
+    if (!queue->elastic || queue->worker_waiters_head != NULL) {
+        return;
+    }
+    for (size_t i = 0; i < queue->level_count; ++i) {
+        if (_m_job_level_has_work(queue, &queue->levels[i])) {
+            _m_job_pool_grow_locked(queue);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief   Enqueue jobs into reserved slots and wake up to @p count workers.
+ *
+ * Jobs submitted by a handler running on a work-stealing worker go to that
+ * worker's deque; the woken siblings, if any, steal them.
+ */
+static void _m_job_enqueue_jobs(m_job_queue_t *queue,
+                                m_job_handle_t *const *jobs,
+                                size_t count)
+{
+    m_job_worker_t *local = _m_job_current_worker(queue);
+    for (size_t i = 0; i < count; ++i) {
+        jobs[i]->queue = queue;
+        if (local != NULL) {
+            _m_job_deque_push(&local->deque, jobs[i]);
+        } else {
+            _m_job_shared_push(queue, jobs[i]);
+        }
+    }
+    if (local != NULL) {
+        atomic_fetch_add_explicit(&queue->stats.local_submitted, count,
+                                  memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&queue->stats.submitted, count, memory_order_relaxed);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->worker_waiting, memory_order_relaxed) > 0) {
+        _m_job_queue_lock(queue);
+        for (size_t i = 0; i < count && queue->worker_waiters_head != NULL; ++i) {
+            _m_job_wake_worker_locked(queue);
+        }
+        _m_job_queue_unlock(queue);
+    }
+    _m_job_pool_grow(queue);
+}
+
+static void _m_job_enqueue_job(m_job_queue_t *queue, m_job_handle_t *job)
+{
+    _m_job_enqueue_jobs(queue, &job, 1);
+}
+
+/**
+ * @brief   Return a slot freed by a worker and wake a blocked submitter.
+ */
+static void _m_job_slot_release(m_job_queue_t *queue)
+{
+    atomic_fetch_add_explicit(&queue->free_slots, 1, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->submit_waiting, memory_order_relaxed) > 0) {
+        _m_job_queue_lock(queue);
+        _m_job_wake_submitter_locked(queue);
+        _m_job_queue_unlock(queue);
+    }
+}
+
+/**
+ * @brief   Reserve queue capacity, blocking until the optional deadline.
+ *
+ * Spins for up to M_JOB_SUBMIT_SPIN_COUNT attempts before parking; the wait
+ * node lives on the submitter's stack, which is safe because wakers only
+ * touch it under the queue lock and the waiter retakes that lock before
+ * returning.
+ */
+static m_job_error_t _m_job_reserve_slot(m_job_queue_t *queue,
+                                         const m_timer_deadline_t *deadline)
+{
+    if (_m_job_slot_try_reserve(queue)) {
+        return M_JOB_OK;
+    }
+#if M_JOB_SUBMIT_SPIN_COUNT > 0
+    for (uint32_t spin = 0; spin < M_JOB_SUBMIT_SPIN_COUNT; ++spin) {
+        if (atomic_load_explicit(&queue->free_slots, memory_order_relaxed) > 0
+            && _m_job_slot_try_reserve(queue)) {
+            return M_JOB_OK;
+        }
+    }
+#endif
+
+    uint64_t blocked_at = m_timer_get_monotonic();
+    m_job_submit_wait_node_t node = {0};
+    m_job_error_t err = M_JOB_OK;
     _m_job_queue_lock(queue);
-    while (queue->count == 0) {
+    for (;;) {
         if (queue->destroyed) {
-            _m_job_queue_unlock(queue);
-            return M_JOB_ERR_DESTROYED;
+            err = M_JOB_ERR_DESTROYED;
+            break;
         }
 
         if (queue->shutdown_requested) {
-            _m_job_queue_unlock(queue);
-            return M_JOB_ERR_SHUTDOWN;
+            err = M_JOB_ERR_SHUTDOWN;
+            break;
         }
 
-        m_sched_wait_context_prepare_with_reason(&worker->wait,
+        m_sched_wait_context_prepare_with_reason(&node.ctx,
                                                  M_SCHED_WAIT_REASON_JOB);
-        _m_job_worker_wait_append_locked(queue, worker);
-        _m_job_queue_unlock(queue);
 
-        m_sched_wait_result_t wait_res = m_sched_wait_block(&worker->wait, NULL);
+        node.linked = true;
+        node.next = NULL;
+        if (queue->submit_waiters_tail) {
+            queue->submit_waiters_tail->next = &node;
+        } else {
+            queue->submit_waiters_head = &node;
+        }
+        queue->submit_waiters_tail = &node;
+        atomic_fetch_add_explicit(&queue->submit_waiting, 1, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_seq_cst);
+        bool reserved = _m_job_slot_try_reserve(queue);
+        m_sched_wait_result_t wait_res = M_SCHED_WAIT_RESULT_OK;
+        if (!reserved) {
+            _m_job_queue_unlock(queue);
+            wait_res = m_sched_wait_block(&node.ctx, deadline);
+            _m_job_queue_lock(queue);
+        }
+
+        if (node.linked) {
+            _m_job_submit_wait_remove_locked(queue, &node);
+        }
+        atomic_fetch_sub_explicit(&queue->submit_waiting, 1, memory_order_relaxed);
+
+        if (reserved) {
+            break;
+        }
 
-        _m_job_queue_lock(queue);
-        _m_job_worker_wait_remove_locked(queue, worker);
         if (wait_res != M_SCHED_WAIT_RESULT_OK) {
-            _m_job_queue_unlock(queue);
-            return (wait_res == M_SCHED_WAIT_RESULT_OBJECT_DESTROYED)
-                           ? M_JOB_ERR_DESTROYED
-                           : M_JOB_ERR_SHUTDOWN;
+            atomic_fetch_add_explicit(&queue->stats.dropped, 1, memory_order_relaxed);
+            err = (wait_res == M_SCHED_WAIT_RESULT_TIMEOUT)
+                          ? M_JOB_ERR_TIMEOUT
+                          : (wait_res == M_SCHED_WAIT_RESULT_OBJECT_DESTROYED)
+                                    ? M_JOB_ERR_DESTROYED
+                                    : M_JOB_ERR_SHUTDOWN;
+            break;
+        }
+
+        if (_m_job_slot_try_reserve(queue)) {
+            break;
         }
     }
 
-    m_job_handle_t *job = queue->ring[queue->head];
-    queue->head = (queue->head + 1) % queue->capacity;
-    queue->count--;
-    _m_job_wake_submitter_locked(queue);
+    uint64_t waited = m_timer_get_monotonic() - blocked_at;
+    ++queue->submit_blocked;
+    queue->submit_wait_total_us += waited;
+    if (waited > queue->submit_wait_max_us) {
+        queue->submit_wait_max_us = waited;
+    }
     _m_job_queue_unlock(queue);
+    return err;
+}
+
+/**
+ * @brief   Whether an idle worker of @p queue may retire; call with the lock.
+ */
+static bool _m_job_worker_may_retire_locked(const m_job_queue_t *queue)
+{
+    return queue->elastic
+           && atomic_load_explicit(&queue->running_workers, memory_order_relaxed)
+                      > queue->min_workers;
+}
+
+/**
+ * @brief   Block until a job is available for @p worker or the queue stops.
+ *
+ * Returns M_JOB_ERR_TIMEOUT when an elastic worker idled out and gave up its
+ * slot; the worker then exits.
+ */
+static m_job_error_t _m_job_queue_wait_next(m_job_queue_t *queue,
+                                            m_job_handle_t **out,
+                                            m_job_worker_t *worker)
+{
+    m_job_handle_t *job = _m_job_next_job(queue, worker);
+    if (job == NULL) {
+        m_job_error_t err = M_JOB_OK;
+        _m_job_queue_lock(queue);
+        for (;;) {
+            if (queue->destroyed) {
+                err = M_JOB_ERR_DESTROYED;
+                break;
+            }
+
+            if (queue->shutdown_requested) {
+                err = M_JOB_ERR_SHUTDOWN;
+                break;
+            }
+
+            m_sched_wait_context_prepare_with_reason(&worker->wait,
+                                                     M_SCHED_WAIT_REASON_JOB);
+            _m_job_worker_wait_append_locked(queue, worker);
+            atomic_fetch_add_explicit(&queue->worker_waiting, 1, memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_seq_cst);
+            job = _m_job_next_job(queue, worker);
+            m_sched_wait_result_t wait_res = M_SCHED_WAIT_RESULT_OK;
+            if (job == NULL) {
+                m_timer_deadline_t idle_deadline;
+                const m_timer_deadline_t *idle = NULL;
+                if (_m_job_worker_may_retire_locked(queue)) {
+                    idle_deadline =
+                            m_timer_deadline_from_relative(queue->idle_timeout_us);
+                    idle = &idle_deadline;
+                }
+                _m_job_queue_unlock(queue);
+                wait_res = m_sched_wait_block(&worker->wait, idle);
+                _m_job_queue_lock(queue);
+            }
+
+            _m_job_worker_wait_remove_locked(queue, worker);
+            atomic_fetch_sub_explicit(&queue->worker_waiting, 1, memory_order_relaxed);
+
+            if (job != NULL) {
+                break;
+            }
+
+            if (wait_res != M_SCHED_WAIT_RESULT_OK
+                && wait_res != M_SCHED_WAIT_RESULT_TIMEOUT) {
+                err = (wait_res == M_SCHED_WAIT_RESULT_OBJECT_DESTROYED)
+                              ? M_JOB_ERR_DESTROYED
+                              : M_JOB_ERR_SHUTDOWN;
+                break;
+            }
+
+            job = _m_job_next_job(queue, worker);
+            if (job != NULL) {
+                break;
+            }
+
+            /* Until the stop hook frees this slot, a submitter that misses
+             * this worker may find no slot to start a replacement in; the
+             * hook checks for such a job and starts one itself. */
+            if (wait_res == M_SCHED_WAIT_RESULT_TIMEOUT
+                && _m_job_worker_may_retire_locked(queue)) {
+                worker->retiring = true;
+                atomic_fetch_sub_explicit(&queue->running_workers, 1,
+                                          memory_order_relaxed);
+                ++queue->retiring_workers;
+                err = M_JOB_ERR_TIMEOUT;
+                break;
+            }
+        }
+        _m_job_queue_unlock(queue);
+
+        if (job == NULL) {
+            return err;
+        }
+    }
 
     *out = job;
     return M_JOB_OK;
 }
 
+/**
+ * @brief   Cancel a job whose deadline passed while it was queued.
+ */
+static bool _m_job_drop_if_expired(m_job_queue_t *queue, m_job_handle_t *job)
+{
+    if (job->deadline.infinite
+        || m_timer_get_monotonic() <= job->deadline.target) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&job->lock);
+    _m_job_handle_record_cancellation(job);
+    m_job_continuation_t *continuations = _m_job_handle_detach_continuations(job);
+    portEXIT_CRITICAL(&job->lock);
+    atomic_fetch_add_explicit(&queue->stats.dropped, 1, memory_order_relaxed);
+    _m_job_continuations_run(continuations);
+    return true;
+}
+
+m_job_error_t _m_job_queue_take(m_job_queue_t *queue,
+                                 m_job_handle_t **out,
+                                 m_job_worker_t *worker)
+{
+    *out = NULL;
+    for (;;) {
+        m_job_handle_t *job = NULL;
+        m_job_error_t err = _m_job_queue_wait_next(queue, &job, worker);
+        if (err != M_JOB_OK) {
+            return err;
+        }
+        _m_job_slot_release(queue);
+        if (!_m_job_drop_if_expired(queue, job)) {
+            *out = job;
+            return M_JOB_OK;
+        }
+    }
+}
+
+/**
+ * @brief   Free the queue, its class storage, and the worker deques.
+ */
+static void _m_job_queue_free(m_job_queue_t *queue)
+{
+    if (queue->workers != NULL) {
+        for (size_t i = 0; i < queue->worker_count; ++i) {
+            vPortFree(queue->workers[i].deque.slots);
+        }
+        vPortFree(queue->workers);
+    }
+    for (size_t i = 0; i < queue->level_count; ++i) {
+        vPortFree(queue->levels[i].ring);
+        vPortFree(queue->levels[i].heap);
+    }
+    vPortFree(queue);
+}
+
+/**
+ * @brief   Cancel every job still held by a class or a worker deque.
+ */
+static void _m_job_queue_cancel_pending(m_job_queue_t *queue)
+{
+    for (size_t i = 0; i <= queue->worker_count; ++i) {
+        m_job_handle_t *job;
+        for (;;) {
+            if (i == queue->worker_count) {
+                job = _m_job_shared_pop(queue);
+            } else if (queue->work_stealing) {
+                job = _m_job_deque_pop(&queue->workers[i].deque);
+            } else {
+                job = NULL;
+            }
+            if (job == NULL) {
+                break;
+            }
+            portENTER_CRITICAL(&job->lock);
+            if (!job->result_ready) {
+                _m_job_handle_record_cancellation(job);
+            }
+            m_job_continuation_t *continuations =
+                    _m_job_handle_detach_continuations(job);
+            portEXIT_CRITICAL(&job->lock);
+            /* Dependents on this queue land back on the shared classes and
+             * are cancelled by this same drain. */
+            _m_job_continuations_run(continuations);
+        }
+    }
+}
+
 m_job_queue_t *m_job_queue_create(const m_job_queue_config_t *config)
 {
-    if (config == NULL || config->capacity == 0 || config->worker_count == 0
-        || config->name == NULL) {
+    if (config == NULL || config->capacity == 0 || config->name == NULL) {
+        return NULL;
+    }
+
+    bool elastic = (config->max_workers > 0);
+    size_t slots = elastic ? config->max_workers : config->worker_count;
+    if (slots == 0 || (elastic && config->min_workers > config->max_workers)) {
         return NULL;
     }
 
     if (config->capacity > CONFIG_MAGNOLIA_JOB_QUEUE_CAPACITY_MAX
-        || config->worker_count > CONFIG_MAGNOLIA_JOB_QUEUE_WORKER_COUNT_MAX) {
+        || slots > CONFIG_MAGNOLIA_JOB_QUEUE_WORKER_COUNT_MAX
+        || config->priority_levels > M_JOB_QUEUE_PRIORITY_LEVELS_MAX) {
         return NULL;
     }
 
@@ -308,66 +1007,110 @@ m_job_queue_t *m_job_queue_create(const m_job_queue_config_t *config)
     strncpy(queue->name, config->name, M_JOB_QUEUE_NAME_MAX_LEN);
     queue->name[M_JOB_QUEUE_NAME_MAX_LEN - 1] = '\0';
     queue->capacity = config->capacity;
-    queue->worker_count = config->worker_count;
+    queue->worker_count = slots;
     queue->worker_priority = config->priority;
+    queue->stack_depth = config->stack_depth;
+    queue->elastic = elastic;
+    queue->min_workers = elastic ? config->min_workers : slots;
+    queue->spawn_threshold = config->spawn_threshold ? config->spawn_threshold : 1;
+    queue->idle_timeout_us = (uint64_t)(config->idle_timeout_ms
+                                                ? config->idle_timeout_ms
+                                                : CONFIG_MAGNOLIA_JOB_WORKER_IDLE_TIMEOUT_MS)
+                             * 1000ULL;
     queue->debug = config->debug_log;
-
-    queue->ring = pvPortMalloc(sizeof(m_job_handle_t *) * queue->capacity);
-    if (queue->ring == NULL) {
-        vPortFree(queue);
-        return NULL;
+    queue->work_stealing = config->work_stealing;
+    queue->level_count = config->priority_levels ? config->priority_levels : 1;
+    queue->deadline_dispatch = config->deadline_dispatch;
+    queue->starvation_limit = config->starvation_limit;
+
+    size_t ring_size = 1;
+    while (ring_size < queue->capacity) {
+        ring_size <<= 1;
+    }
+    queue->ring_mask = ring_size - 1;
+    for (size_t l = 0; l < queue->level_count; ++l) {
+        m_job_queue_level_t *level = &queue->levels[l];
+        atomic_init(&level->enqueue_pos, 0);
+        atomic_init(&level->dequeue_pos, 0);
+        level->heap_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+        if (queue->deadline_dispatch) {
+            level->heap = pvPortMalloc(sizeof(m_job_handle_t *) * ring_size);
+            if (level->heap == NULL) {
+                _m_job_queue_free(queue);
+                return NULL;
+            }
+            continue;
+        }
+        level->ring = pvPortMalloc(sizeof(m_job_queue_slot_t) * ring_size);
+        if (level->ring == NULL) {
+            _m_job_queue_free(queue);
+            return NULL;
+        }
+        for (size_t i = 0; i < ring_size; ++i) {
+            atomic_init(&level->ring[i].sequence, i);
+            level->ring[i].job = NULL;
+        }
     }
+    atomic_init(&queue->starvation_streak, 0);
+    atomic_init(&queue->starvation_cursor, 0);
+    atomic_init(&queue->sequence, 0);
+    atomic_init(&queue->free_slots, queue->capacity);
+    atomic_init(&queue->worker_waiting, 0);
+    atomic_init(&queue->submit_waiting, 0);
+    atomic_init(&queue->running_workers, 0);
 
     queue->workers =
             pvPortMalloc(sizeof(m_job_worker_t) * queue->worker_count);
     if (queue->workers == NULL) {
-        vPortFree(queue->ring);
-        vPortFree(queue);
+        _m_job_queue_free(queue);
         return NULL;
     }
+    memset(queue->workers, 0, sizeof(m_job_worker_t) * queue->worker_count);
+
+    if (queue->work_stealing) {
+        for (size_t i = 0; i < queue->worker_count; ++i) {
+            m_job_deque_t *deque = &queue->workers[i].deque;
+            deque->slots = pvPortMalloc(sizeof(m_job_handle_t *) * ring_size);
+            if (deque->slots == NULL) {
+                _m_job_queue_free(queue);
+                return NULL;
+            }
+            deque->mask = ring_size - 1;
+            deque->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+        }
+    }
 
     queue->lock = xSemaphoreCreateMutexStatic(&queue->lock_storage);
     if (queue->lock == NULL) {
-        vPortFree(queue->workers);
-        vPortFree(queue->ring);
-        vPortFree(queue);
+        _m_job_queue_free(queue);
         return NULL;
     }
 
-    queue->stats = (m_job_stats_t){0};
+    atomic_init(&queue->stats.submitted, 0);
+    atomic_init(&queue->stats.executed, 0);
+    atomic_init(&queue->stats.failed, 0);
+    atomic_init(&queue->stats.dropped, 0);
+    atomic_init(&queue->stats.local_submitted, 0);
+    atomic_init(&queue->stats.stolen, 0);
     queue->destroyed = false;
     queue->shutdown_requested = false;
 
     m_job_worker_register_scheduler_hooks();
 
     for (size_t i = 0; i < queue->worker_count; ++i) {
-        m_job_worker_t *worker = &queue->workers[i];
-        memset(worker, 0, sizeof(*worker));
-        worker->queue = queue;
-        worker->task_id = M_SCHED_TASK_ID_INVALID;
-        worker->waiting = false;
-        worker->next_waiter = NULL;
-        worker->prev_waiter = NULL;
-        m_sched_task_options_t opts = {
-            .entry = m_job_worker_entry,
-            .name = queue->name,
-            .argument = worker,
-            .stack_depth = config->stack_depth,
-            .priority = config->priority,
-            .tag = "job_worker",
-            .creation_flags = M_SCHED_TASK_FLAG_WORKER,
-            .user_data = queue,
-        };
-        if (m_sched_task_create(&opts, &worker->task_id) != M_SCHED_OK) {
+        queue->workers[i].task_id = M_SCHED_TASK_ID_INVALID;
+    }
+    for (size_t i = 0; i < queue->min_workers; ++i) {
+        if (_m_job_worker_start(queue, &queue->workers[i]) != M_SCHED_OK) {
             for (size_t j = 0; j < i; ++j) {
                 m_sched_task_destroy(queue->workers[j].task_id);
             }
-            vPortFree(queue->workers);
-            vPortFree(queue->ring);
-            vPortFree(queue);
+            _m_job_queue_free(queue);
             return NULL;
         }
     }
+    atomic_store_explicit(&queue->running_workers, queue->min_workers,
+                          memory_order_relaxed);
     return queue;
 }
 
@@ -380,25 +1123,28 @@ m_job_error_t m_job_queue_destroy(m_job_queue_t *queue)
     _m_job_queue_lock(queue);
     queue->destroyed = true;
     queue->shutdown_requested = true;
-    size_t pending = queue->count;
-    size_t pending_head = queue->head;
     _m_job_wake_all_submitters_locked(queue,
                                       M_SCHED_WAIT_RESULT_OBJECT_DESTROYED);
     _m_job_wake_all_workers_locked(queue,
                                    M_SCHED_WAIT_RESULT_OBJECT_DESTROYED);
     _m_job_queue_unlock(queue);
 
-    for (size_t i = 0, idx = pending_head; i < pending; ++i) {
-        m_job_handle_t *job = queue->ring[idx];
-        if (job != NULL) {
-            portENTER_CRITICAL(&job->lock);
-            if (!job->result_ready) {
-                _m_job_handle_record_cancellation(job);
-            }
-            portEXIT_CRITICAL(&job->lock);
-        }
-        idx = (idx + 1) % queue->capacity;
+    _m_job_queue_cancel_pending(queue);
+
+    /* Retiring workers clear their own slot from the stop hook, which still
+     * takes the queue lock, so let them finish before freeing the queue. */
+    m_sched_wait_context_t retire_wait = {0};
+    _m_job_queue_lock(queue);
+    while (queue->retiring_workers > 0) {
+        m_sched_wait_context_prepare_with_reason(&retire_wait,
+                                                 M_SCHED_WAIT_REASON_JOB);
+        queue->retire_waiter = &retire_wait;
+        _m_job_queue_unlock(queue);
+        m_sched_wait_block(&retire_wait, NULL);
+        _m_job_queue_lock(queue);
     }
+    queue->retire_waiter = NULL;
+    _m_job_queue_unlock(queue);
 
     for (size_t i = 0; i < queue->worker_count; ++i) {
         if (queue->workers[i].task_id != M_SCHED_TASK_ID_INVALID) {
@@ -406,9 +1152,11 @@ m_job_error_t m_job_queue_destroy(m_job_queue_t *queue)
         }
     }
 
-    vPortFree(queue->workers);
-    vPortFree(queue->ring);
-    vPortFree(queue);
+    /* A job that finished while the first drain ran may have committed a
+     * dependent after it; cancel that too before the slots go away. */
+    _m_job_queue_cancel_pending(queue);
+
+    _m_job_queue_free(queue);
     return M_JOB_OK;
 }
 
@@ -448,16 +1196,13 @@ m_job_error_t m_job_queue_submit_with_handle(m_job_queue_t *queue,
         return M_JOB_ERR_NO_MEMORY;
     }
 
-    _m_job_queue_lock(queue);
-    m_job_error_t err = _m_job_wait_for_space(queue, NULL);
+    m_job_error_t err = _m_job_reserve_slot(queue, NULL);
     if (err != M_JOB_OK) {
-        _m_job_queue_unlock(queue);
-        vPortFree(handle);
+        _m_job_handle_discard(handle);
         return err;
     }
 
-    _m_job_enqueue_job_locked(queue, handle);
-    _m_job_queue_unlock(queue);
+    _m_job_enqueue_job(queue, handle);
 
     if (out_handle != NULL) {
         *out_handle = handle;
@@ -479,16 +1224,118 @@ m_job_error_t m_job_queue_submit_nowait_with_handle(m_job_queue_t *queue,
         return M_JOB_ERR_NO_MEMORY;
     }
 
-    _m_job_queue_lock(queue);
-    if (queue->count >= queue->capacity) {
-        queue->stats.dropped++;
-        _m_job_queue_unlock(queue);
-        vPortFree(handle);
+    if (!_m_job_slot_try_reserve(queue)) {
+        atomic_fetch_add_explicit(&queue->stats.dropped, 1, memory_order_relaxed);
+        _m_job_handle_discard(handle);
         return M_JOB_ERR_QUEUE_FULL;
     }
 
-    _m_job_enqueue_job_locked(queue, handle);
-    _m_job_queue_unlock(queue);
+    _m_job_enqueue_job(queue, handle);
+
+    if (out_handle != NULL) {
+        *out_handle = handle;
+    }
+    return M_JOB_OK;
+}
+
+m_job_error_t m_job_queue_submit_batch(m_job_queue_t *queue,
+                                      const m_job_handler_t *handlers,
+                                      void *const *data,
+                                      size_t count,
+                                      m_job_handle_t **out_handles)
+{
+    if (queue == NULL || handlers == NULL || count == 0) {
+        return M_JOB_ERR_INVALID_PARAM;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (handlers[i] == NULL) {
+            return M_JOB_ERR_INVALID_PARAM;
+        }
+    }
+
+    m_job_handle_t *scratch[M_JOB_QUEUE_BATCH_MAX];
+    m_job_handle_t **handles = (out_handles != NULL) ? out_handles : scratch;
+    if (out_handles == NULL && count > M_JOB_QUEUE_BATCH_MAX) {
+        return M_JOB_ERR_INVALID_PARAM;
+    }
+    if (!_m_job_handle_create_batch(handlers,
+                                    data,
+                                    count,
+                                    jctx_current_job_id(),
+                                    handles)) {
+        if (out_handles != NULL) {
+            memset(out_handles, 0, sizeof(*out_handles) * count);
+        }
+        return M_JOB_ERR_NO_MEMORY;
+    }
+    uint32_t priority = queue->worker_priority;
+    for (size_t i = 0; i < count; ++i) {
+        (void)jctx_set_field_kernel(handles[i]->ctx,
+                                    JOB_CTX_FIELD_PRIORITY_HINT,
+                                    &priority,
+                                    sizeof(priority));
+    }
+
+    /* Publish whatever capacity is free in one go and only block for the
+     * remainder, so a batch never sits on reserved slots it cannot fill. */
+    m_job_error_t err = M_JOB_OK;
+    size_t done = 0;
+    while (done < count) {
+        size_t reserved = _m_job_slots_try_reserve(queue, count - done);
+        if (reserved == 0) {
+            err = _m_job_reserve_slot(queue, NULL);
+            if (err != M_JOB_OK) {
+                break;
+            }
+            reserved = 1;
+        }
+        _m_job_enqueue_jobs(queue, &handles[done], reserved);
+        done += reserved;
+    }
+
+    for (size_t i = done; i < count; ++i) {
+        _m_job_handle_discard(handles[i]);
+        handles[i] = NULL;
+    }
+    return err;
+}
+
+m_job_error_t m_job_queue_submit_with_options(m_job_queue_t *queue,
+                                             m_job_handler_t handler,
+                                             void *data,
+                                             const m_job_submit_options_t *options,
+                                             m_job_handle_t **out_handle)
+{
+    if (queue == NULL || handler == NULL || options == NULL) {
+        return M_JOB_ERR_INVALID_PARAM;
+    }
+
+    m_job_handle_t *handle = options->lite
+                                     ? _m_job_handle_create_lite(handler, data)
+                                     : m_job_create_handle(queue, handler, data);
+    if (handle == NULL) {
+        return M_JOB_ERR_NO_MEMORY;
+    }
+
+    handle->priority = options->priority;
+    handle->deadline = options->deadline;
+    if (handle->ctx != NULL && !options->deadline.infinite) {
+        (void)jctx_set_field_kernel(handle->ctx,
+                                    JOB_CTX_FIELD_DEADLINE,
+                                    &options->deadline,
+                                    sizeof(options->deadline));
+    }
+
+    m_job_error_t err = _m_job_reserve_slot(queue,
+                                            options->deadline.infinite
+                                                    ? NULL
+                                                    : &options->deadline);
+    if (err != M_JOB_OK) {
+        _m_job_handle_discard(handle);
+        return err;
+    }
+
+    _m_job_enqueue_job(queue, handle);
 
     if (out_handle != NULL) {
         *out_handle = handle;
@@ -511,16 +1358,13 @@ m_job_error_t m_job_queue_submit_until_with_handle(m_job_queue_t *queue,
         return M_JOB_ERR_NO_MEMORY;
     }
 
-    _m_job_queue_lock(queue);
-    m_job_error_t err = _m_job_wait_for_space(queue, deadline);
+    m_job_error_t err = _m_job_reserve_slot(queue, deadline);
     if (err != M_JOB_OK) {
-        _m_job_queue_unlock(queue);
-        vPortFree(handle);
+        _m_job_handle_discard(handle);
         return err;
     }
 
-    _m_job_enqueue_job_locked(queue, handle);
-    _m_job_queue_unlock(queue);
+    _m_job_enqueue_job(queue, handle);
 
     if (out_handle != NULL) {
         *out_handle = handle;
@@ -528,20 +1372,60 @@ m_job_error_t m_job_queue_submit_until_with_handle(m_job_queue_t *queue,
     return M_JOB_OK;
 }
 
+m_job_error_t _m_job_queue_prepare(m_job_queue_t *queue,
+                                   m_job_handler_t handler,
+                                   void *data,
+                                   m_job_handle_t **out_handle)
+{
+    if (queue == NULL || handler == NULL || out_handle == NULL) {
+        return M_JOB_ERR_INVALID_PARAM;
+    }
+
+    m_job_handle_t *handle = m_job_create_handle(queue, handler, data);
+    if (handle == NULL) {
+        return M_JOB_ERR_NO_MEMORY;
+    }
+
+    m_job_error_t err = _m_job_reserve_slot(queue, NULL);
+    if (err != M_JOB_OK) {
+        _m_job_handle_discard(handle);
+        return err;
+    }
+
+    handle->queue = queue;
+    *out_handle = handle;
+    return M_JOB_OK;
+}
+
+void _m_job_queue_commit(m_job_queue_t *queue, m_job_handle_t *job)
+{
+    _m_job_enqueue_job(queue, job);
+}
+
+void _m_job_queue_release_slot(m_job_queue_t *queue)
+{
+    _m_job_slot_release(queue);
+}
+
 void m_job_queue_get_info(const m_job_queue_t *queue, m_job_queue_info_t *info)
 {
     if (queue == NULL || info == NULL) {
         return;
     }
 
-    _m_job_queue_lock((m_job_queue_t *)queue);
+    m_job_queue_t *mutable_queue = (m_job_queue_t *)queue;
+    size_t free_slots = atomic_load_explicit(&mutable_queue->free_slots,
+                                             memory_order_relaxed);
+    _m_job_queue_lock(mutable_queue);
     info->capacity = queue->capacity;
-    info->depth = queue->count;
+    info->depth = queue->capacity - free_slots;
     info->worker_count = queue->worker_count;
     info->active_workers = queue->active_workers;
+    info->spawned = queue->spawned_workers;
+    info->retired = queue->retired_workers;
     info->shutdown = queue->shutdown_requested;
     info->destroyed = queue->destroyed;
-    _m_job_queue_unlock((m_job_queue_t *)queue);
+    _m_job_queue_unlock(mutable_queue);
 }
 
 void m_job_queue_get_stats(const m_job_queue_t *queue, m_job_stats_t *stats)
@@ -550,9 +1434,21 @@ void m_job_queue_get_stats(const m_job_queue_t *queue, m_job_stats_t *stats)
         return;
     }
 
-    _m_job_queue_lock((m_job_queue_t *)queue);
-    *stats = queue->stats;
-    _m_job_queue_unlock((m_job_queue_t *)queue);
+    m_job_queue_counters_t *counters = &((m_job_queue_t *)queue)->stats;
+    stats->submitted = atomic_load_explicit(&counters->submitted, memory_order_relaxed);
+    stats->executed = atomic_load_explicit(&counters->executed, memory_order_relaxed);
+    stats->failed = atomic_load_explicit(&counters->failed, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&counters->dropped, memory_order_relaxed);
+    stats->local_submitted = atomic_load_explicit(&counters->local_submitted,
+                                                  memory_order_relaxed);
+    stats->stolen = atomic_load_explicit(&counters->stolen, memory_order_relaxed);
+
+    m_job_queue_t *mutable_queue = (m_job_queue_t *)queue;
+    _m_job_queue_lock(mutable_queue);
+    stats->blocked_submits = queue->submit_blocked;
+    stats->blocked_wait_total_us = queue->submit_wait_total_us;
+    stats->blocked_wait_max_us = queue->submit_wait_max_us;
+    _m_job_queue_unlock(mutable_queue);
 }
 
 #ifdef CONFIG_MAGNOLIA_JOB_SELFTESTS
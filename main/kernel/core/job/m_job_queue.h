@@ -7,6 +7,7 @@
 #ifndef MAGNOLIA_JOB_M_JOB_QUEUE_H
 #define MAGNOLIA_JOB_M_JOB_QUEUE_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -26,6 +27,10 @@ extern "C" {
 #endif
 
 #define M_JOB_QUEUE_NAME_MAX_LEN CONFIG_MAGNOLIA_JOB_QUEUE_NAME_MAX_LEN
+#define M_JOB_QUEUE_PRIORITY_LEVELS_MAX CONFIG_MAGNOLIA_JOB_QUEUE_PRIORITY_LEVELS_MAX
+#define M_JOB_SUBMIT_SPIN_COUNT CONFIG_MAGNOLIA_JOB_SUBMIT_SPIN_COUNT
+/* Largest batch accepted without caller-provided handle storage. */
+#define M_JOB_QUEUE_BATCH_MAX 64
 
 /**
  * @brief   Cumulative statistics emitted by the queue.
@@ -35,6 +40,13 @@ typedef struct {
     size_t executed;
     size_t failed;
     size_t dropped;
+    size_t local_submitted;
+    size_t stolen;
+    /* Submissions that found the queue full and had to wait, with the time
+     * they spent waiting for capacity, including ones that gave up. */
+    size_t blocked_submits;
+    uint64_t blocked_wait_total_us;
+    uint64_t blocked_wait_max_us;
 } m_job_stats_t;
 
 /**
@@ -45,6 +57,9 @@ typedef struct {
     size_t capacity;
     size_t worker_count;
     size_t active_workers;
+    /* Workers started and retired by an elastic pool since creation. */
+    size_t spawned;
+    size_t retired;
     bool shutdown;
     bool destroyed;
 } m_job_queue_info_t;
@@ -56,9 +71,28 @@ typedef struct {
     const char *name;
     size_t capacity;
     size_t worker_count;
+    /* Elastic pool: when max_workers is non-zero, worker_count is ignored
+     * and the queue runs between min_workers and max_workers workers. One
+     * is started whenever spawn_threshold jobs are queued with no idle
+     * worker, and workers above the floor exit after idle_timeout_ms. */
+    size_t min_workers;
+    size_t max_workers;
+    size_t spawn_threshold;
+    uint32_t idle_timeout_ms;
     size_t stack_depth;
     UBaseType_t priority;
     bool debug_log;
+    /* Pin one worker per core with a private deque; jobs submitted from a
+     * handler stay on the submitting worker and idle workers steal. */
+    bool work_stealing;
+    /* Priority classes, 0 being the most urgent; submissions above the last
+     * class are clamped to it. */
+    size_t priority_levels;
+    /* Order each class by earliest deadline instead of submission order. */
+    bool deadline_dispatch;
+    /* Dispatches a more urgent class may take in a row while a less urgent
+     * one waits; 0 lets urgent work starve the rest. */
+    uint32_t starvation_limit;
 } m_job_queue_config_t;
 
 /**
@@ -69,9 +103,39 @@ typedef struct {
         .name = "job_queue",                                                   \
         .capacity = CONFIG_MAGNOLIA_JOB_QUEUE_DEFAULT_CAPACITY,                \
         .worker_count = CONFIG_MAGNOLIA_JOB_QUEUE_DEFAULT_WORKER_COUNT,        \
+        .min_workers = 0,                                                      \
+        .max_workers = 0,                                                      \
+        .spawn_threshold = 1,                                                  \
+        .idle_timeout_ms = CONFIG_MAGNOLIA_JOB_WORKER_IDLE_TIMEOUT_MS,         \
         .stack_depth = CONFIG_MAGNOLIA_JOB_WORKER_STACK_DEPTH,                 \
         .priority = CONFIG_MAGNOLIA_JOB_WORKER_PRIORITY,                       \
         .debug_log = CONFIG_MAGNOLIA_JOB_ENABLE_EXTENDED_DIAGNOSTICS,          \
+        .work_stealing = false,                                                \
+        .priority_levels = 1,                                                  \
+        .deadline_dispatch = false,                                            \
+        .starvation_limit = CONFIG_MAGNOLIA_JOB_QUEUE_STARVATION_LIMIT,        \
+    }
+
+/**
+ * @brief   Per-job dispatch parameters accepted by the option submit calls.
+ *
+ * Jobs whose deadline has passed when a worker picks them up are cancelled
+ * instead of run and counted as dropped. A blocking submission also stops
+ * waiting for capacity at the deadline.
+ */
+typedef struct {
+    uint32_t priority;
+    m_timer_deadline_t deadline;
+    /* Skip the per-job context: the handler runs in the submitter's context
+     * and a private one is only created if the job's fields are accessed. */
+    bool lite;
+} m_job_submit_options_t;
+
+#define M_JOB_SUBMIT_OPTIONS_DEFAULT                                           \
+    {                                                                          \
+        .priority = 0,                                                         \
+        .deadline = {.target = 0, .infinite = true},                           \
+        .lite = false,                                                         \
     }
 
 typedef struct m_job_queue m_job_queue_t;
@@ -82,26 +146,100 @@ typedef struct m_job_submit_wait_node {
     bool linked;
 } m_job_submit_wait_node_t;
 
+/**
+ * @brief   Ring cell of the lock-free submit/take path.
+ *
+ * A cell is free for the producer at position p while sequence == p and
+ * holds a job for the consumer at position p while sequence == p + 1.
+ */
+typedef struct {
+    atomic_size_t sequence;
+    m_job_handle_t *job;
+} m_job_queue_slot_t;
+
+/**
+ * @brief   Statistics counters updated without the queue lock.
+ */
+typedef struct {
+    atomic_size_t submitted;
+    atomic_size_t executed;
+    atomic_size_t failed;
+    atomic_size_t dropped;
+    atomic_size_t local_submitted;
+    atomic_size_t stolen;
+} m_job_queue_counters_t;
+
+/**
+ * @brief   Pending jobs of one priority class.
+ *
+ * FIFO classes use the lock-free ring; deadline-ordered classes keep a
+ * binary min-heap under a spinlock instead.
+ */
+typedef struct {
+    m_job_queue_slot_t *ring;
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+    m_job_handle_t **heap;
+    size_t heap_count;
+    portMUX_TYPE heap_lock;
+} m_job_queue_level_t;
+
+/*
+ * Submit and take run lock-free on bounded MPMC rings, one per priority
+ * class, sized to the next power of two of the capacity; free_slots
+ * enforces the exact capacity across all of them. The mutex only guards the
+ * waiter lists, which are touched when a submitter finds the queue full or
+ * a worker finds it empty. In work-stealing mode the rings only carry jobs
+ * submitted from outside the workers; free_slots still bounds the jobs held
+ * across the rings and all worker deques. workers holds worker_count slots;
+ * an elastic pool leaves the slots of retired workers empty until it grows.
+ */
 struct m_job_queue {
     char name[M_JOB_QUEUE_NAME_MAX_LEN];
     size_t capacity;
-    size_t head;
-    size_t tail;
-    size_t count;
-    m_job_handle_t **ring;
+    m_job_queue_level_t levels[M_JOB_QUEUE_PRIORITY_LEVELS_MAX];
+    size_t level_count;
+    size_t ring_mask;
+    bool deadline_dispatch;
+    uint32_t starvation_limit;
+    atomic_uint starvation_streak;
+    atomic_uint starvation_cursor;
+    atomic_size_t sequence;
+    atomic_size_t free_slots;
+    atomic_size_t worker_waiting;
+    atomic_size_t submit_waiting;
     m_job_worker_t *workers;
     size_t worker_count;
     UBaseType_t worker_priority;
+    size_t stack_depth;
+    bool elastic;
+    size_t min_workers;
+    size_t spawn_threshold;
+    uint64_t idle_timeout_us;
+    /* Occupied worker slots; written under the lock, read lock-free by
+     * submitters deciding whether to grow the pool. */
+    atomic_size_t running_workers;
+    size_t retiring_workers;
+    /* Set by m_job_queue_destroy() while it waits for retiring workers; the
+     * stop hook of the last one wakes it. */
+    m_sched_wait_context_t *retire_waiter;
+    size_t spawned_workers;
+    size_t retired_workers;
     SemaphoreHandle_t lock;
     StaticSemaphore_t lock_storage;
     m_job_worker_t *worker_waiters_head;
     m_job_worker_t *worker_waiters_tail;
     m_job_submit_wait_node_t *submit_waiters_head;
     m_job_submit_wait_node_t *submit_waiters_tail;
-    m_job_stats_t stats;
+    m_job_queue_counters_t stats;
+    /* Blocked-submit latency, updated under the lock. */
+    size_t submit_blocked;
+    uint64_t submit_wait_total_us;
+    uint64_t submit_wait_max_us;
     bool destroyed;
     bool shutdown_requested;
     bool debug;
+    bool work_stealing;
     size_t active_workers;
 };
 
@@ -158,6 +296,47 @@ static inline m_job_error_t m_job_queue_submit_nowait(m_job_queue_t *queue,
     return m_job_queue_submit_nowait_with_handle(queue, handler, data, NULL);
 }
 
+/**
+ * @brief   Submit @p count jobs with one bulk allocation and reservation.
+ *
+ * Jobs are published as capacity frees up, waking at most one idle worker
+ * per published job. @p data may be NULL; @p out_handles may be NULL for up
+ * to M_JOB_QUEUE_BATCH_MAX fire-and-forget jobs. If the queue is destroyed
+ * or shut down midway, the jobs already published keep their handles and
+ * the remaining entries of @p out_handles are set to NULL.
+ */
+m_job_error_t m_job_queue_submit_batch(m_job_queue_t *queue,
+                                      const m_job_handler_t *handlers,
+                                      void *const *data,
+                                      size_t count,
+                                      m_job_handle_t **out_handles);
+
+/**
+ * @brief   Submit a job handler with a priority class and deadline.
+ */
+m_job_error_t m_job_queue_submit_with_options(m_job_queue_t *queue,
+                                             m_job_handler_t handler,
+                                             void *data,
+                                             const m_job_submit_options_t *options,
+                                             m_job_handle_t **out_handle);
+
+/**
+ * @brief   Submit a lite job, which has no job context of its own.
+ *
+ * Meant for high-rate internal work that never touches uid, cwd, or a job
+ * heap of its own; see m_job_submit_options_t.lite.
+ */
+static inline m_job_error_t m_job_queue_submit_lite(m_job_queue_t *queue,
+                                                    m_job_handler_t handler,
+                                                    void *data,
+                                                    m_job_handle_t **out_handle)
+{
+    m_job_submit_options_t options = M_JOB_SUBMIT_OPTIONS_DEFAULT;
+    options.lite = true;
+    return m_job_queue_submit_with_options(queue, handler, data, &options,
+                                           out_handle);
+}
+
 /**
  * @brief   Submit a job handler with a deadline for queue capacity.
  */
@@ -205,6 +384,32 @@ m_job_error_t _m_job_queue_take(m_job_queue_t *queue,
                                  m_job_handle_t **out,
                                  m_job_worker_t *worker);
 
+/**
+ * @brief   Internal helper used by the worker stop hook once a retired slot
+ *          is free again.
+ *
+ * A submit that raced the retirement may have queued a job with no worker
+ * left to run it and no free slot to start one in; this starts that worker.
+ * The caller holds the queue lock.
+ */
+void _m_job_queue_refill_locked(m_job_queue_t *queue);
+
+/**
+ * @brief   Internal helpers used by job graphs to queue a job later.
+ *
+ * _m_job_queue_prepare() creates the handle and reserves its slot, blocking
+ * for capacity; the slot is then either filled by _m_job_queue_commit() or
+ * given back with _m_job_queue_release_slot(). Neither of those blocks.
+ */
+m_job_error_t _m_job_queue_prepare(m_job_queue_t *queue,
+                                   m_job_handler_t handler,
+                                   void *data,
+                                   m_job_handle_t **out_handle);
+
+void _m_job_queue_commit(m_job_queue_t *queue, m_job_handle_t *job);
+
+void _m_job_queue_release_slot(m_job_queue_t *queue);
+
 #ifdef __cplusplus
 }
 #endif
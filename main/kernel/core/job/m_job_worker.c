@@ -11,6 +11,7 @@
 #include "kernel/core/job/m_job_worker.h"
 #include "kernel/core/job/m_job_queue.h"
 #include "kernel/core/job/m_job_core.h"
+#include "kernel/core/job/m_job_graph.h"
 #include "kernel/core/timer/m_timer.h"
 #include "kernel/core/sched/m_sched.h"
 
@@ -49,7 +50,6 @@ static void m_job_worker_hook_stop(m_sched_task_id_t id,
                                    m_sched_task_metadata_t *meta,
                                    void *user_data)
 {
-    (void)id;
     (void)user_data;
 
     m_job_queue_t *queue = (meta ? (m_job_queue_t *)meta->user_data : NULL);
@@ -61,6 +61,23 @@ static void m_job_worker_hook_stop(m_sched_task_id_t id,
     if (queue->active_workers > 0) {
         --queue->active_workers;
     }
+    for (size_t i = 0; i < queue->worker_count; ++i) {
+        m_job_worker_t *worker = &queue->workers[i];
+        if (worker->task_id == id && worker->retiring) {
+            worker->task_id = M_SCHED_TASK_ID_INVALID;
+            worker->task_handle = NULL;
+            worker->retiring = false;
+            --queue->retiring_workers;
+            ++queue->retired_workers;
+            _m_job_queue_refill_locked(queue);
+            if (queue->retiring_workers == 0 && queue->retire_waiter != NULL) {
+                m_sched_wait_wake(queue->retire_waiter,
+                                  M_SCHED_WAIT_RESULT_OK);
+                queue->retire_waiter = NULL;
+            }
+            break;
+        }
+    }
     if (queue->debug) {
         ESP_LOGD(TAG,
                  "worker %u stopped (active=%u)",
@@ -90,37 +107,49 @@ void m_job_worker_entry(void *arg)
         bool should_run = false;
         m_job_handler_result_t handler_result = {0};
 
-        job_ctx_t *ctx = job->ctx;
+        job_ctx_t *ctx = NULL;
         portENTER_CRITICAL(&job->lock);
-        if (!job->cancelled && !job->result_ready) {
+        if (!job->cancelled && !job->result_ready
+            && (job->ctx != NULL || job->lite)) {
             job->state = M_JOB_STATE_RUNNING;
             should_run = true;
         }
+        /* Lite jobs run in the submitter's context until they get one. */
+        bool own_ctx = (job->ctx != NULL);
+        ctx = own_ctx ? job->ctx : job->owner_ctx;
         portEXIT_CRITICAL(&job->lock);
 
-        if (should_run && ctx != NULL) {
-            jctx_set_started(ctx, m_timer_get_monotonic());
-            jctx_set_scheduler_state(ctx, JOB_CTX_SCHED_STATE_RUNNING);
+        if (should_run) {
+            if (own_ctx) {
+                jctx_set_started(ctx, m_timer_get_monotonic());
+                jctx_set_scheduler_state(ctx, JOB_CTX_SCHED_STATE_RUNNING);
+            }
             jctx_acquire(ctx);
             jctx_set_current(ctx);
 
             handler_result = job->handler(job, job->data);
-            _m_job_queue_lock(queue);
-            queue->stats.executed++;
+            atomic_fetch_add_explicit(&queue->stats.executed, 1,
+                                      memory_order_relaxed);
             if (handler_result.status != M_JOB_RESULT_SUCCESS) {
-                queue->stats.failed++;
+                atomic_fetch_add_explicit(&queue->stats.failed, 1,
+                                          memory_order_relaxed);
             }
-            _m_job_queue_unlock(queue);
             portENTER_CRITICAL(&job->lock);
             _m_job_handle_set_result(job, handler_result);
+            m_job_continuation_t *continuations =
+                    _m_job_handle_detach_continuations(job);
             portEXIT_CRITICAL(&job->lock);
+            _m_job_continuations_run(continuations);
 
             jctx_set_current(NULL);
             jctx_release(ctx);
         } else {
             portENTER_CRITICAL(&job->lock);
             _m_job_handle_record_cancellation(job);
+            m_job_continuation_t *continuations =
+                    _m_job_handle_detach_continuations(job);
             portEXIT_CRITICAL(&job->lock);
+            _m_job_continuations_run(continuations);
         }
     }
 }
@@ -6,6 +6,7 @@
 #define MAGNOLIA_JOB_M_JOB_WORKER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
@@ -17,13 +18,34 @@ extern "C" {
 #endif
 
 typedef struct m_job_queue m_job_queue_t;
+struct m_job_handle;
+
+/**
+ * @brief   Per-worker job deque used by work-stealing queues.
+ *
+ * The owning worker pushes and pops at the bottom (newest first) while idle
+ * siblings steal from the top (oldest first). top and bottom only grow and
+ * are masked into the slot array.
+ */
+typedef struct {
+    struct m_job_handle **slots;
+    size_t mask;
+    size_t top;
+    size_t bottom;
+    portMUX_TYPE lock;
+} m_job_deque_t;
 
 typedef struct m_job_worker {
     m_job_queue_t *queue;
+    m_job_deque_t deque;
+    int core;
     m_sched_wait_context_t wait;
     struct m_job_worker *next_waiter;
     struct m_job_worker *prev_waiter;
     bool waiting;
+    /* Set by an idle worker of an elastic pool on its way out; the slot is
+     * reusable once the stop hook has cleared task_id. */
+    bool retiring;
     m_sched_task_id_t task_id;
     TaskHandle_t task_handle;
 } m_job_worker_t;
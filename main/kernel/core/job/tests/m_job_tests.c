@@ -2,6 +2,8 @@
 
 #if CONFIG_MAGNOLIA_JOB_ENABLED && CONFIG_MAGNOLIA_JOB_SELFTESTS
 
+#include <stdatomic.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "esp_log.h"
@@ -9,10 +11,21 @@
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 
+#include "kernel/core/job/jctx.h"
 #include "kernel/core/job/m_job.h"
 #include "kernel/core/job/tests/m_job_tests.h"
+#include "kernel/core/memory/m_slab.h"
 #include "kernel/core/timer/m_timer.h"
 
+#define JOB_BENCH_MAX_PRODUCERS 4
+#define JOB_BENCH_JOBS_PER_PRODUCER 32
+#define JOB_BENCH_QUEUE_CAPACITY 16
+#define JOB_BENCH_WORKERS 2
+#define JOB_FANOUT_PARENTS 4
+#define JOB_FANOUT_CHILDREN 6
+#define JOB_ORDER_MAX 8
+#define JOB_BATCH_JOBS 64
+
 static const char *TAG = "job_tests";
 
 static bool test_report(const char *name, bool success)
@@ -192,6 +205,12 @@ static bool run_test_timeout_submission(void)
         m_sched_task_resume(worker_id);
     }
     bool ok = (err == M_JOB_ERR_TIMEOUT);
+
+    /* The timed-out wait is still accounted as a blocked submission. */
+    m_job_stats_t stats = {0};
+    m_job_queue_get_stats(queue, &stats);
+    ok &= (stats.blocked_submits == 1 && stats.blocked_wait_max_us > 0
+           && stats.blocked_wait_total_us == stats.blocked_wait_max_us);
     m_job_queue_destroy(queue);
     return ok;
 }
@@ -716,6 +735,773 @@ static bool run_test_completion_cancelled(void)
     return ok;
 }
 
+typedef struct {
+    m_job_queue_t *queue;
+    SemaphoreHandle_t start;
+    SemaphoreHandle_t done;
+    size_t submitted;
+    m_job_handle_t *handles[JOB_BENCH_JOBS_PER_PRODUCER];
+} job_bench_producer_t;
+
+static void job_bench_producer(void *arg)
+{
+    job_bench_producer_t *producer = arg;
+    xSemaphoreTake(producer->start, portMAX_DELAY);
+    for (size_t i = 0; i < JOB_BENCH_JOBS_PER_PRODUCER; ++i) {
+        if (m_job_queue_submit_with_handle(producer->queue,
+                                           job_noop,
+                                           NULL,
+                                           &producer->handles[i])
+            != M_JOB_OK) {
+            break;
+        }
+        producer->submitted++;
+    }
+    xSemaphoreGive(producer->done);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Submit throughput with 1..N concurrent producers feeding the same queue;
+ * the clock stops once every submitted job has completed.
+ */
+static bool job_bench_run(size_t producer_count)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_BENCH_QUEUE_CAPACITY;
+    config.worker_count = JOB_BENCH_WORKERS;
+
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    static StaticSemaphore_t start_storage;
+    static StaticSemaphore_t done_storage;
+    static job_bench_producer_t producers[JOB_BENCH_MAX_PRODUCERS];
+    SemaphoreHandle_t start = xSemaphoreCreateCountingStatic(
+            JOB_BENCH_MAX_PRODUCERS, 0, &start_storage);
+    SemaphoreHandle_t done = xSemaphoreCreateCountingStatic(
+            JOB_BENCH_MAX_PRODUCERS, 0, &done_storage);
+    if (start == NULL || done == NULL) {
+        m_job_queue_destroy(queue);
+        return false;
+    }
+
+    size_t created = 0;
+    for (; created < producer_count; ++created) {
+        job_bench_producer_t *producer = &producers[created];
+        memset(producer, 0, sizeof(*producer));
+        producer->queue = queue;
+        producer->start = start;
+        producer->done = done;
+        if (xTaskCreate(job_bench_producer,
+                        "job_bench",
+                        configMINIMAL_STACK_SIZE * 2,
+                        producer,
+                        CONFIG_MAGNOLIA_JOB_WORKER_PRIORITY,
+                        NULL)
+            != pdPASS) {
+            break;
+        }
+    }
+
+    m_timer_time_t begin = m_timer_get_monotonic();
+    for (size_t i = 0; i < created; ++i) {
+        xSemaphoreGive(start);
+    }
+    bool ok = (created == producer_count);
+    for (size_t i = 0; i < created; ++i) {
+        ok &= (xSemaphoreTake(done, pdMS_TO_TICKS(5000)) == pdTRUE);
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < created; ++i) {
+        job_bench_producer_t *producer = &producers[i];
+        for (size_t j = 0; j < producer->submitted; ++j) {
+            m_job_result_descriptor_t result = {0};
+            ok &= (m_job_wait_for_job(producer->handles[j], &result)
+                   == M_JOB_FUTURE_WAIT_OK);
+        }
+        total += producer->submitted;
+    }
+    uint64_t elapsed_us = m_timer_get_monotonic() - begin;
+
+    for (size_t i = 0; i < created; ++i) {
+        job_bench_producer_t *producer = &producers[i];
+        for (size_t j = 0; j < producer->submitted; ++j) {
+            m_job_handle_destroy(producer->handles[j]);
+        }
+    }
+
+    m_job_stats_t stats = {0};
+    m_job_queue_get_stats(queue, &stats);
+    ok &= (total == producer_count * JOB_BENCH_JOBS_PER_PRODUCER);
+    ok &= (stats.submitted == total && stats.executed == total);
+    m_job_queue_destroy(queue);
+
+    if (elapsed_us == 0) {
+        elapsed_us = 1;
+    }
+    ESP_LOGI(TAG,
+             "submit bench: %u producer(s) %u jobs %llu us -> %llu jobs/s",
+             (unsigned)producer_count,
+             (unsigned)total,
+             (unsigned long long)elapsed_us,
+             (unsigned long long)((uint64_t)total * 1000000ULL / elapsed_us));
+    return ok;
+}
+
+/*
+ * Fan out JOB_BATCH_JOBS jobs either one call at a time or as one batch;
+ * the clock stops once every job has completed.
+ */
+static bool job_batch_bench_run(bool batched, uint64_t *elapsed_us)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_BATCH_JOBS;
+    config.worker_count = JOB_BENCH_WORKERS;
+
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    static m_job_handler_t handlers[JOB_BATCH_JOBS];
+    static m_job_handle_t *handles[JOB_BATCH_JOBS];
+    for (size_t i = 0; i < JOB_BATCH_JOBS; ++i) {
+        handlers[i] = job_noop;
+        handles[i] = NULL;
+    }
+
+    bool ok = true;
+    m_timer_time_t begin = m_timer_get_monotonic();
+    if (batched) {
+        ok = (m_job_queue_submit_batch(queue,
+                                       handlers,
+                                       NULL,
+                                       JOB_BATCH_JOBS,
+                                       handles)
+              == M_JOB_OK);
+    } else {
+        for (size_t i = 0; i < JOB_BATCH_JOBS && ok; ++i) {
+            ok = (m_job_queue_submit_with_handle(queue,
+                                                 handlers[i],
+                                                 NULL,
+                                                 &handles[i])
+                  == M_JOB_OK);
+        }
+    }
+    for (size_t i = 0; i < JOB_BATCH_JOBS; ++i) {
+        if (handles[i] == NULL) {
+            continue;
+        }
+        m_job_result_descriptor_t result = {0};
+        ok &= (m_job_wait_for_job(handles[i], &result) == M_JOB_FUTURE_WAIT_OK);
+    }
+    *elapsed_us = m_timer_get_monotonic() - begin;
+
+    for (size_t i = 0; i < JOB_BATCH_JOBS; ++i) {
+        if (handles[i] != NULL) {
+            m_job_handle_destroy(handles[i]);
+        }
+    }
+
+    m_job_stats_t stats = {0};
+    m_job_queue_get_stats(queue, &stats);
+    ok &= (stats.submitted == JOB_BATCH_JOBS && stats.executed == JOB_BATCH_JOBS);
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool run_test_batch_submit(void)
+{
+    uint64_t single_us = 0;
+    uint64_t batch_us = 0;
+    bool ok = job_batch_bench_run(false, &single_us);
+    ok &= job_batch_bench_run(true, &batch_us);
+    ESP_LOGI(TAG,
+             "batch bench: %u jobs single %llu us, batched %llu us",
+             (unsigned)JOB_BATCH_JOBS,
+             (unsigned long long)single_us,
+             (unsigned long long)batch_us);
+    return ok;
+}
+
+static bool run_test_submit_throughput(void)
+{
+    bool ok = true;
+    for (size_t producers = 1; producers <= JOB_BENCH_MAX_PRODUCERS; ++producers) {
+        ok &= job_bench_run(producers);
+    }
+    return ok;
+}
+
+static int g_job_order[JOB_ORDER_MAX];
+static atomic_size_t g_job_order_count;
+
+static m_job_result_descriptor_t job_record_order(m_job_id_t job, void *arg)
+{
+    (void)job;
+    size_t index = atomic_fetch_add(&g_job_order_count, 1);
+    if (index < JOB_ORDER_MAX) {
+        g_job_order[index] = (int)(intptr_t)arg;
+    }
+    return m_job_result_success(NULL, 0);
+}
+
+/*
+ * Queue jobs behind a suspended worker with the given options, then let it
+ * run and record the order in which the handlers execute.
+ */
+static bool job_order_run(const m_job_queue_config_t *config,
+                          const m_job_submit_options_t *options,
+                          size_t count)
+{
+    m_job_queue_t *queue = m_job_queue_create(config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_sched_task_id_t worker_id = m_job_queue_get_worker_task_id(queue, 0);
+    bool suspended = (worker_id != M_SCHED_TASK_ID_INVALID)
+                     && (m_sched_task_suspend(worker_id) == M_SCHED_OK);
+
+    atomic_store(&g_job_order_count, 0);
+    m_job_handle_t *handles[JOB_ORDER_MAX] = {0};
+    bool ok = suspended;
+    for (size_t i = 0; i < count && ok; ++i) {
+        ok = (m_job_queue_submit_with_options(queue,
+                                              job_record_order,
+                                              (void *)(intptr_t)i,
+                                              &options[i],
+                                              &handles[i])
+              == M_JOB_OK);
+    }
+    if (suspended) {
+        m_sched_task_resume(worker_id);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (handles[i] == NULL) {
+            continue;
+        }
+        m_job_result_descriptor_t result = {0};
+        ok &= (m_job_wait_for_job(handles[i], &result) == M_JOB_FUTURE_WAIT_OK);
+        m_job_handle_destroy(handles[i]);
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool job_order_wait_all(m_job_handle_t *const *handles, size_t count)
+{
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (handles[i] == NULL) {
+            ok = false;
+            continue;
+        }
+        m_job_result_descriptor_t result = {0};
+        ok &= (m_job_wait_for_job(handles[i], &result) == M_JOB_FUTURE_WAIT_OK);
+        ok &= (m_job_handle_destroy(handles[i]) == M_JOB_OK);
+    }
+    return ok;
+}
+
+static bool run_test_job_continuations(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.worker_count = 2;
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    /* then-chain 0 -> 1 -> 2 */
+    atomic_store(&g_job_order_count, 0);
+    m_job_handle_t *chain[3] = {0};
+    bool ok = (m_job_queue_submit_with_handle(queue, job_record_order,
+                                              (void *)(intptr_t)0, &chain[0])
+               == M_JOB_OK);
+    for (size_t i = 1; i < 3 && ok; ++i) {
+        ok = (m_job_then(chain[i - 1], job_record_order, (void *)(intptr_t)i,
+                         &chain[i])
+              == M_JOB_OK);
+    }
+    ok &= job_order_wait_all(chain, 3);
+    ok &= (atomic_load(&g_job_order_count) == 3);
+    ok &= (g_job_order[0] == 0 && g_job_order[1] == 1 && g_job_order[2] == 2);
+
+    /* when_all over three jobs, one of them already finished */
+    atomic_store(&g_job_order_count, 0);
+    m_job_handle_t *fan[4] = {0};
+    for (size_t i = 0; i < 3 && ok; ++i) {
+        ok = (m_job_queue_submit_with_handle(queue, job_sleepy, NULL, &fan[i])
+              == M_JOB_OK);
+    }
+    if (ok) {
+        m_job_result_descriptor_t result = {0};
+        ok = (m_job_wait_for_job(fan[0], &result) == M_JOB_FUTURE_WAIT_OK);
+    }
+    ok = ok && (m_job_when_all(queue, fan, 3, job_record_order,
+                               (void *)(intptr_t)7, &fan[3])
+                == M_JOB_OK);
+    if (ok) {
+        m_job_result_descriptor_t result = {0};
+        ok = (m_job_wait_for_job(fan[3], &result) == M_JOB_FUTURE_WAIT_OK);
+        for (size_t i = 1; i < 3; ++i) {
+            ok &= (m_job_query_result(fan[i], &result) == M_JOB_OK);
+        }
+    }
+    ok &= job_order_wait_all(fan, 4);
+    ok &= (atomic_load(&g_job_order_count) == 1 && g_job_order[0] == 7);
+
+    /* Dependents may not wait on jobs of another queue. */
+    m_job_queue_t *other = m_job_queue_create(&config);
+    m_job_handle_t *foreign = NULL;
+    m_job_handle_t *cross = NULL;
+    ok &= (other != NULL);
+    ok = ok && (m_job_queue_submit_with_handle(other, job_sleepy, NULL, &foreign)
+                == M_JOB_OK);
+    ok = ok && (m_job_when_all(queue, &foreign, 1, job_record_order, NULL,
+                               &cross)
+                == M_JOB_ERR_INVALID_PARAM);
+    ok &= (cross == NULL);
+    if (foreign != NULL) {
+        ok &= job_order_wait_all(&foreign, 1);
+    }
+    if (other != NULL) {
+        m_job_queue_destroy(other);
+    }
+
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool run_test_job_graph_diamond(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.worker_count = 2;
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    /*   0
+     *  / \
+     * 1   2
+     *  \ /
+     *   3   */
+    static const size_t deps_root[] = {0};
+    static const size_t deps_join[] = {1, 2};
+    m_job_graph_node_t nodes[4] = {
+            {.handler = job_record_order, .data = (void *)(intptr_t)0},
+            {.handler = job_record_order, .data = (void *)(intptr_t)1,
+             .deps = deps_root, .dep_count = 1},
+            {.handler = job_record_order, .data = (void *)(intptr_t)2,
+             .deps = deps_root, .dep_count = 1},
+            {.handler = job_record_order, .data = (void *)(intptr_t)3,
+             .deps = deps_join, .dep_count = 2},
+    };
+
+    atomic_store(&g_job_order_count, 0);
+    bool ok = (m_job_graph_submit(queue, nodes, 4) == M_JOB_OK);
+    m_job_handle_t *handles[4];
+    for (size_t i = 0; i < 4; ++i) {
+        handles[i] = nodes[i].handle;
+    }
+    ok &= job_order_wait_all(handles, 4);
+    ok &= (atomic_load(&g_job_order_count) == 4);
+    ok &= (g_job_order[0] == 0 && g_job_order[3] == 3);
+
+    /* Dependencies must point at earlier nodes. */
+    m_job_graph_node_t cyclic[1] = {
+            {.handler = job_record_order, .deps = deps_root, .dep_count = 1},
+    };
+    ok &= (m_job_graph_submit(queue, cyclic, 1) == M_JOB_ERR_INVALID_PARAM);
+
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool run_test_elastic_pool(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.min_workers = 0;
+    config.max_workers = 2;
+    config.idle_timeout_ms = 50;
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_queue_info_t info = {0};
+    m_job_queue_get_info(queue, &info);
+    bool ok = (info.spawned == 0 && info.active_workers == 0);
+
+    /* A burst grows the pool up to max_workers... */
+    m_job_handle_t *handles[4] = {0};
+    for (size_t i = 0; i < 4 && ok; ++i) {
+        ok = (m_job_queue_submit_with_handle(queue, job_sleepy, NULL, &handles[i])
+              == M_JOB_OK);
+    }
+    ok &= job_order_wait_all(handles, 4);
+    m_job_queue_get_info(queue, &info);
+    ok &= (info.spawned >= 1 && info.spawned <= 2);
+
+    /* ...and idle workers retire back down to min_workers. */
+    m_sched_sleep_ms(200);
+    m_job_queue_get_info(queue, &info);
+    ok &= (info.retired == info.spawned && info.active_workers == 0);
+
+    /* An empty pool starts a worker for the next job. */
+    m_job_handle_t *late = NULL;
+    ok &= (m_job_queue_submit_with_handle(queue, job_noop, NULL, &late)
+           == M_JOB_OK);
+    ok &= job_order_wait_all(&late, 1);
+
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool run_test_elastic_retire_race(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.min_workers = 0;
+    config.max_workers = 1;
+    config.idle_timeout_ms = 20;
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    /* Submit as the only worker idles out, sweeping across its timeout so
+     * some submits land between its last look at the ring and its exit. */
+    bool ok = true;
+    for (uint64_t delay_us = 18000; delay_us <= 22000 && ok; delay_us += 200) {
+        m_job_handle_t *first = NULL;
+        ok = (m_job_queue_submit_with_handle(queue, job_noop, NULL, &first)
+              == M_JOB_OK);
+        ok &= job_order_wait_all(&first, 1);
+        m_sched_sleep_us(delay_us);
+
+        m_job_handle_t *late = NULL;
+        ok &= (m_job_queue_submit_with_handle(queue, job_noop, NULL, &late)
+               == M_JOB_OK);
+        if (late != NULL) {
+            m_timer_deadline_t deadline = m_timer_deadline_from_relative(500000);
+            m_job_result_descriptor_t result = {0};
+            ok &= (m_job_wait_for_job_timed(late, &deadline, &result)
+                   == M_JOB_FUTURE_WAIT_OK);
+            m_job_handle_destroy(late);
+        }
+    }
+
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool run_test_priority_dispatch(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.worker_count = 1;
+    config.priority_levels = 2;
+    config.starvation_limit = 0;
+
+    m_job_submit_options_t options[4] = {
+            M_JOB_SUBMIT_OPTIONS_DEFAULT, M_JOB_SUBMIT_OPTIONS_DEFAULT,
+            M_JOB_SUBMIT_OPTIONS_DEFAULT, M_JOB_SUBMIT_OPTIONS_DEFAULT};
+    options[0].priority = 1;
+    options[1].priority = 1;
+    options[2].priority = 0;
+    options[3].priority = 7;
+
+    bool ok = job_order_run(&config, options, 4);
+    ok &= (atomic_load(&g_job_order_count) == 4);
+    ok &= (g_job_order[0] == 2 && g_job_order[1] == 0 && g_job_order[2] == 1
+           && g_job_order[3] == 3);
+    return ok;
+}
+
+static bool run_test_starvation_limit(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.worker_count = 1;
+    config.priority_levels = 2;
+    config.starvation_limit = 2;
+
+    m_job_submit_options_t options[5] = {
+            M_JOB_SUBMIT_OPTIONS_DEFAULT, M_JOB_SUBMIT_OPTIONS_DEFAULT,
+            M_JOB_SUBMIT_OPTIONS_DEFAULT, M_JOB_SUBMIT_OPTIONS_DEFAULT,
+            M_JOB_SUBMIT_OPTIONS_DEFAULT};
+    options[0].priority = 1;
+
+    /* Two urgent dispatches pass the waiting bulk job, the third may not. */
+    bool ok = job_order_run(&config, options, 5);
+    ok &= (atomic_load(&g_job_order_count) == 5);
+    ok &= (g_job_order[0] == 1 && g_job_order[1] == 2 && g_job_order[2] == 0);
+    return ok;
+}
+
+static bool run_test_deadline_dispatch(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_ORDER_MAX;
+    config.worker_count = 1;
+    config.deadline_dispatch = true;
+
+    m_job_submit_options_t options[4] = {
+            M_JOB_SUBMIT_OPTIONS_DEFAULT, M_JOB_SUBMIT_OPTIONS_DEFAULT,
+            M_JOB_SUBMIT_OPTIONS_DEFAULT, M_JOB_SUBMIT_OPTIONS_DEFAULT};
+    options[1].deadline = m_timer_deadline_from_relative(3000000ULL);
+    options[2].deadline = m_timer_deadline_from_relative(1000000ULL);
+    options[3].deadline = m_timer_deadline_from_relative(2000000ULL);
+
+    bool ok = job_order_run(&config, options, 4);
+    ok &= (atomic_load(&g_job_order_count) == 4);
+    ok &= (g_job_order[0] == 2 && g_job_order[1] == 3 && g_job_order[2] == 1
+           && g_job_order[3] == 0);
+    return ok;
+}
+
+static bool run_test_expired_deadline_dropped(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = 2;
+    config.worker_count = 1;
+
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_sched_task_id_t worker_id = m_job_queue_get_worker_task_id(queue, 0);
+    bool suspended = (worker_id != M_SCHED_TASK_ID_INVALID)
+                     && (m_sched_task_suspend(worker_id) == M_SCHED_OK);
+
+    m_job_submit_options_t options = M_JOB_SUBMIT_OPTIONS_DEFAULT;
+    options.deadline = m_timer_deadline_from_relative(1000ULL);
+    m_job_handle_t *job = NULL;
+    bool ok = suspended
+              && (m_job_queue_submit_with_options(queue,
+                                                  job_noop,
+                                                  NULL,
+                                                  &options,
+                                                  &job)
+                  == M_JOB_OK);
+    m_sched_sleep_ms(5);
+    if (suspended) {
+        m_sched_task_resume(worker_id);
+    }
+
+    if (job != NULL) {
+        m_job_result_descriptor_t result = {0};
+        ok &= (m_job_wait_for_job(job, &result) == M_JOB_FUTURE_WAIT_OK);
+        ok &= (result.status == M_JOB_RESULT_CANCELLED);
+        m_job_handle_destroy(job);
+    }
+
+    m_job_stats_t stats = {0};
+    m_job_queue_get_stats(queue, &stats);
+    ok &= (stats.dropped == 1 && stats.executed == 0);
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static job_ctx_t *g_lite_seen_ctx;
+
+static m_job_result_descriptor_t job_lite_probe(m_job_id_t job, void *arg)
+{
+    (void)job;
+    (void)arg;
+    g_lite_seen_ctx = jctx_current();
+    return m_job_result_success(NULL, 0);
+}
+
+static bool job_ctx_cache_visit(const m_slab_cache_stats_t *stats,
+                                void *user_data)
+{
+    if (strcmp(stats->name, "job_ctx") != 0) {
+        return true;
+    }
+    *(size_t *)user_data = stats->active_objects;
+    return false;
+}
+
+static size_t job_ctx_active(void)
+{
+    size_t active = 0;
+    m_slab_cache_foreach(job_ctx_cache_visit, &active);
+    return active;
+}
+
+static bool run_test_lite_job(void)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = 2;
+    config.worker_count = 1;
+
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    size_t before = job_ctx_active();
+    g_lite_seen_ctx = (job_ctx_t *)&g_lite_seen_ctx;
+    m_job_handle_t *job = NULL;
+    if (m_job_queue_submit_lite(queue, job_lite_probe, NULL, &job) != M_JOB_OK) {
+        m_job_queue_destroy(queue);
+        return false;
+    }
+
+    m_job_result_descriptor_t result = {0};
+    bool ok = (m_job_wait_for_job(job, &result) == M_JOB_FUTURE_WAIT_OK);
+    ok &= (result.status == M_JOB_RESULT_SUCCESS);
+    ok &= (g_lite_seen_ctx == jctx_current());
+    ok &= (job_ctx_active() == before);
+
+    /* Reading a field materializes the job's own context. */
+    m_job_id_t id = NULL;
+    ok &= (m_job_field_get(job, JOB_CTX_FIELD_JOB_ID, &id, sizeof(id))
+           == JOB_CTX_OK);
+    ok &= (id == job);
+    ok &= (job_ctx_active() == before + 1);
+
+    m_job_handle_destroy(job);
+    ok &= (job_ctx_active() == before);
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+typedef struct {
+    m_job_queue_t *queue;
+    job_test_context_t *children;
+    m_job_handle_t *handles[JOB_FANOUT_CHILDREN];
+    size_t submitted;
+} job_fanout_parent_t;
+
+static m_job_result_descriptor_t job_fanout_parent(m_job_id_t job, void *arg)
+{
+    job_fanout_parent_t *parent = arg;
+    (void)job;
+    for (size_t i = 0; i < JOB_FANOUT_CHILDREN; ++i) {
+        if (m_job_queue_submit_with_handle(parent->queue,
+                                           job_increment,
+                                           parent->children,
+                                           &parent->handles[i])
+            != M_JOB_OK) {
+            break;
+        }
+        parent->submitted++;
+    }
+    return m_job_result_success(NULL, 0);
+}
+
+/*
+ * Parents submit their children from inside a handler, which is the case
+ * work stealing is meant for: children land on the submitting worker's
+ * deque and idle siblings take them from there.
+ */
+static bool job_fanout_run(bool work_stealing)
+{
+    m_job_queue_config_t config = M_JOB_QUEUE_CONFIG_DEFAULT;
+    config.capacity = JOB_FANOUT_PARENTS * (JOB_FANOUT_CHILDREN + 1);
+    config.worker_count = JOB_BENCH_WORKERS;
+    config.work_stealing = work_stealing;
+
+    m_job_queue_t *queue = m_job_queue_create(&config);
+    if (queue == NULL) {
+        return false;
+    }
+
+    static StaticSemaphore_t storage;
+    static job_fanout_parent_t parents[JOB_FANOUT_PARENTS];
+    const size_t total_children = JOB_FANOUT_PARENTS * JOB_FANOUT_CHILDREN;
+    SemaphoreHandle_t done =
+            xSemaphoreCreateCountingStatic(total_children, 0, &storage);
+    if (done == NULL) {
+        m_job_queue_destroy(queue);
+        return false;
+    }
+
+    job_test_context_t children = {.done = done, .count = 0};
+    m_job_handle_t *parent_handles[JOB_FANOUT_PARENTS] = {0};
+    bool ok = true;
+    m_timer_time_t begin = m_timer_get_monotonic();
+    for (size_t i = 0; i < JOB_FANOUT_PARENTS; ++i) {
+        memset(&parents[i], 0, sizeof(parents[i]));
+        parents[i].queue = queue;
+        parents[i].children = &children;
+        if (m_job_queue_submit_with_handle(queue,
+                                           job_fanout_parent,
+                                           &parents[i],
+                                           &parent_handles[i])
+            != M_JOB_OK) {
+            ok = false;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < JOB_FANOUT_PARENTS; ++i) {
+        if (parent_handles[i] == NULL) {
+            continue;
+        }
+        m_job_result_descriptor_t result = {0};
+        ok &= (m_job_wait_for_job(parent_handles[i], &result)
+               == M_JOB_FUTURE_WAIT_OK);
+        for (size_t j = 0; j < parents[i].submitted; ++j) {
+            ok &= (m_job_wait_for_job(parents[i].handles[j], &result)
+                   == M_JOB_FUTURE_WAIT_OK);
+        }
+        ok &= (parents[i].submitted == JOB_FANOUT_CHILDREN);
+    }
+    uint64_t elapsed_us = m_timer_get_monotonic() - begin;
+
+    for (size_t i = 0; i < JOB_FANOUT_PARENTS; ++i) {
+        if (parent_handles[i] == NULL) {
+            continue;
+        }
+        for (size_t j = 0; j < parents[i].submitted; ++j) {
+            m_job_handle_destroy(parents[i].handles[j]);
+        }
+        m_job_handle_destroy(parent_handles[i]);
+    }
+
+    m_job_stats_t stats = {0};
+    m_job_queue_get_stats(queue, &stats);
+    ok &= (children.count == (int)total_children);
+    ok &= (stats.executed == JOB_FANOUT_PARENTS + total_children);
+    if (work_stealing) {
+        ok &= (stats.local_submitted == total_children);
+    } else {
+        ok &= (stats.local_submitted == 0 && stats.stolen == 0);
+    }
+    m_job_queue_destroy(queue);
+
+    ESP_LOGI(TAG,
+             "fan-out %s: %u jobs %llu us, %u local, %u stolen",
+             work_stealing ? "stealing" : "shared",
+             (unsigned)stats.executed,
+             (unsigned long long)elapsed_us,
+             (unsigned)stats.local_submitted,
+             (unsigned)stats.stolen);
+    return ok;
+}
+
+static bool run_test_work_stealing_fanout(void)
+{
+    bool ok = job_fanout_run(false);
+    ok &= job_fanout_run(true);
+    return ok;
+}
+
 void m_job_selftests_run(void)
 {
     bool overall = true;
@@ -747,6 +1533,21 @@ void m_job_selftests_run(void)
                            run_test_completion_timed_timeout());
     overall &= test_report("completion cancelled",
                            run_test_completion_cancelled());
+    overall &= test_report("priority dispatch", run_test_priority_dispatch());
+    overall &= test_report("starvation limit", run_test_starvation_limit());
+    overall &= test_report("deadline dispatch", run_test_deadline_dispatch());
+    overall &= test_report("expired deadline dropped",
+                           run_test_expired_deadline_dropped());
+    overall &= test_report("submit throughput benchmark",
+                           run_test_submit_throughput());
+    overall &= test_report("lite job", run_test_lite_job());
+    overall &= test_report("batch submit benchmark", run_test_batch_submit());
+    overall &= test_report("work-stealing fan-out",
+                           run_test_work_stealing_fanout());
+    overall &= test_report("job continuations", run_test_job_continuations());
+    overall &= test_report("job graph diamond", run_test_job_graph_diamond());
+    overall &= test_report("elastic worker pool", run_test_elastic_pool());
+    overall &= test_report("elastic retire race", run_test_elastic_retire_race());
     ESP_LOGI(TAG, "job self-tests %s", overall ? "PASSED" : "FAILED");
 }
 
@@ -25,6 +25,7 @@
 #include "kernel/arch/m_arch.h"
 #include "kernel/core/job/jctx.h"
 #include "kernel/core/memory/m_alloc.h"
+#include "kernel/core/sched/m_sched_sleep.h"
 #include "kernel/core/timer/m_timer_deadline.h"
 #include "kernel/core/timer/m_timer_core.h"
 #include "kernel/core/vfs/m_vfs.h"
@@ -1108,7 +1109,7 @@ int m_libc_usleep(unsigned int usec)
     if (usec == 0) {
         return 0;
     }
-    vTaskDelay(m_timer_delta_to_ticks((uint64_t)usec));
+    m_sched_sleep_us((uint64_t)usec);
     return 0;
 }
 
@@ -1128,7 +1129,7 @@ int m_libc_nanosleep(const void *req, void *rem)
 
     uint64_t us = (uint64_t)ts->tv_sec * 1000000u + (uint64_t)ts->tv_nsec / 1000u;
     if (us > 0) {
-        vTaskDelay(m_timer_delta_to_ticks(us));
+        m_sched_sleep_us(us);
     }
     return 0;
 }
@@ -4,9 +4,11 @@
 
 #include <inttypes.h>
 #include <limits.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/reent.h>
 
@@ -39,6 +41,13 @@
 #define MAGNOLIA_ALLOC_MAX_REGIONS                                               ((CONFIG_MAGNOLIA_ALLOC_MAX_REGIONS_PER_JOB) < 4 ? 4 : (CONFIG_MAGNOLIA_ALLOC_MAX_REGIONS_PER_JOB))
 #define MAGNOLIA_ALLOC_MAX_JOB_HEAP                                              ((CONFIG_MAGNOLIA_ALLOC_MAX_HEAP_SIZE_PER_JOB) < 65536 ? 65536 : (CONFIG_MAGNOLIA_ALLOC_MAX_HEAP_SIZE_PER_JOB))
 #define MAGNOLIA_ALLOC_MAGIC 0x4D41474D
+/*
+ * Completely free regions beyond this count go back to the platform as soon as
+ * they drain; keeping a few around avoids grow/release thrash at a boundary.
+ */
+#define MAGNOLIA_ALLOC_RETAIN_EMPTY_REGIONS CONFIG_MAGNOLIA_ALLOC_RETAIN_EMPTY_REGIONS
+/* Attempts to grow before giving up when concurrent allocators take the new region. */
+#define MAGNOLIA_ALLOC_GROW_RETRIES 3
 
 #if CONFIG_MAGNOLIA_ALLOC_DEBUG
 #define MAGNOLIA_ALLOC_DEBUG_LOG(...) ESP_LOGD(TAG, __VA_ARGS__)
@@ -49,12 +58,32 @@
 typedef struct m_region m_region_t;
 typedef struct m_region_block m_region_block_t;
 typedef struct m_region_heap m_region_heap_t;
+typedef struct m_region_index_entry m_region_index_entry_t;
+
+/*
+ * Each heap indexes its regions by address granule so the libc wrappers can
+ * tell whether a pointer belongs to the job in constant time. A region owns
+ * one entry per granule it overlaps; chains only grow when regions sit a
+ * multiple of BUCKETS granules apart.
+ */
+#define MAGNOLIA_ALLOC_INDEX_SHIFT 12
+#define MAGNOLIA_ALLOC_INDEX_BUCKETS 32
+
+struct m_region_index_entry {
+    uintptr_t granule;
+    m_region_t *region;
+    m_region_index_entry_t *next;
+};
 
 struct m_region {
     void *raw;
     void *base;
     size_t size;
     m_region_t *next;
+    m_region_t *prev;
+    bool large;
+    size_t index_count;
+    m_region_index_entry_t index[];
 };
 
 struct m_region_block {
@@ -66,18 +95,72 @@ struct m_region_block {
     m_region_heap_t *owner;
     m_region_t *region;
     uint32_t magic;
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    uint16_t profile_site;
+#endif
     bool allocated;
 };
 
+/*
+ * Free blocks are kept in TLSF-style segregated lists: the first level splits
+ * sizes by power of two, the second level splits each power-of-two range into
+ * MAGNOLIA_ALLOC_SL_COUNT linear classes. Two bitmaps track which lists are
+ * non-empty so both lookup and insertion are constant time.
+ */
+#define MAGNOLIA_ALLOC_SL_LOG2 3
+#define MAGNOLIA_ALLOC_SL_COUNT (1U << MAGNOLIA_ALLOC_SL_LOG2)
+#define MAGNOLIA_ALLOC_FL_SHIFT 7
+#define MAGNOLIA_ALLOC_SMALL_BLOCK ((size_t)1U << MAGNOLIA_ALLOC_FL_SHIFT)
+#define MAGNOLIA_ALLOC_FL_COUNT 10
+#define MAGNOLIA_ALLOC_CLASS_SCAN_LIMIT 4
+
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+/*
+ * Profiling state of one heap. Sampled blocks remember their call site slot
+ * (1-based, 0 = not sampled) so frees can be charged back to it.
+ */
+typedef struct {
+    m_job_id_t job_id;
+    m_region_heap_t *next;
+    size_t countdown;
+    size_t allocations;
+    size_t live_objects;
+    size_t dropped_samples;
+    size_t histogram[MAGNOLIA_ALLOC_PROFILE_HISTOGRAM_BUCKETS];
+    size_t site_count;
+    magnolia_alloc_profile_site_t sites[MAGNOLIA_ALLOC_PROFILE_CALLSITES];
+} m_alloc_profile_state_t;
+#endif
+
 struct m_region_heap {
     m_region_t *regions;
     m_region_block_t *block_head;
     m_region_block_t *block_tail;
-    m_region_block_t *free_list;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[MAGNOLIA_ALLOC_FL_COUNT];
+    m_region_block_t *free_lists[MAGNOLIA_ALLOC_FL_COUNT][MAGNOLIA_ALLOC_SL_COUNT];
     size_t region_count;
     size_t total_capacity;
     size_t used_bytes;
     size_t peak_bytes;
+    m_region_t *large_regions;
+    size_t large_count;
+    size_t large_bytes;
+    size_t empty_regions;
+    size_t reclaimed_bytes;
+    size_t pending_regions;
+    m_region_index_entry_t *index[MAGNOLIA_ALLOC_INDEX_BUCKETS];
+    size_t ownership_checks;
+    size_t ownership_probes;
+#if CONFIG_MAGNOLIA_ALLOC_TRACE_LOCK_HOLD
+    uint32_t lock_acquired_at;
+    uint32_t lock_hold_count;
+    uint32_t lock_hold_max_cycles;
+    uint64_t lock_hold_total_cycles;
+#endif
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    m_alloc_profile_state_t profile;
+#endif
     portMUX_TYPE lock;
 };
 
@@ -87,9 +170,18 @@ struct m_region_heap {
 
 #define MAGNOLIA_ALLOC_MAX_PAYLOAD                                                (MAGNOLIA_ALLOC_REGION_BYTES - MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE)
 
+/*
+ * Requests at or above this size bypass the regions and get a dedicated
+ * platform allocation that is still accounted to the owning job heap.
+ */
+#define MAGNOLIA_ALLOC_LARGE_THRESHOLD                                           ((CONFIG_MAGNOLIA_ALLOC_LARGE_THRESHOLD) < MAGNOLIA_ALLOC_MAX_PAYLOAD ? (size_t)(CONFIG_MAGNOLIA_ALLOC_LARGE_THRESHOLD) : (size_t)MAGNOLIA_ALLOC_MAX_PAYLOAD)
+
 #if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
 _Static_assert(MAGNOLIA_ALLOC_REGION_BYTES > MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE,
                "Region size must exceed block header metadata (increase MAGNOLIA_ALLOC_REGION_SIZE)");
+_Static_assert(MAGNOLIA_ALLOC_REGION_BYTES
+                   <= ((size_t)1U << (MAGNOLIA_ALLOC_FL_COUNT + MAGNOLIA_ALLOC_FL_SHIFT - 1)),
+               "Region size exceeds the allocator size-class range");
 #else
 typedef char mag_alloc_region_guard[
     (MAGNOLIA_ALLOC_REGION_BYTES > MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE) ? 1 : -1];
@@ -100,12 +192,23 @@ typedef struct {
     size_t total_psram_bytes;
     size_t total_allocations;
     size_t total_frees;
+    size_t total_large_allocations;
 } m_alloc_global_stats_internal_t;
 
 static portMUX_TYPE g_alloc_stats_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
 static m_alloc_global_stats_internal_t g_alloc_globals = {0};
 static job_ctx_t *g_system_job_ctx;
 
+/* Return address of the function using it, recorded as the call site. */
+#define MAGNOLIA_ALLOC_CALLER() ((uintptr_t)__builtin_return_address(0))
+
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+#define MAGNOLIA_ALLOC_PROFILE_SAMPLE_RATE                                      ((CONFIG_MAGNOLIA_ALLOC_PROFILE_SAMPLE_RATE) < 1 ? 1 : (size_t)(CONFIG_MAGNOLIA_ALLOC_PROFILE_SAMPLE_RATE))
+
+static portMUX_TYPE g_alloc_profile_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+static m_region_heap_t *g_alloc_profile_heaps;
+#endif
+
 static inline size_t align_up(size_t size)
 {
     return MAGNOLIA_ALLOC_ROUND_UP(size, MAGNOLIA_ALLOC_ALIGNMENT);
@@ -126,6 +229,64 @@ static inline size_t block_total_bytes(m_region_block_t *block)
     return MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE + block->size;
 }
 
+static inline void m_region_heap_lock(m_region_heap_t *heap)
+{
+    portENTER_CRITICAL(&heap->lock);
+#if CONFIG_MAGNOLIA_ALLOC_TRACE_LOCK_HOLD
+    heap->lock_acquired_at = m_arch_get_cycle_count();
+#endif
+}
+
+static inline void m_region_heap_unlock(m_region_heap_t *heap)
+{
+#if CONFIG_MAGNOLIA_ALLOC_TRACE_LOCK_HOLD
+    uint32_t held = m_arch_get_cycle_count() - heap->lock_acquired_at;
+    heap->lock_hold_count += 1;
+    heap->lock_hold_total_cycles += held;
+    if (held > heap->lock_hold_max_cycles) {
+        heap->lock_hold_max_cycles = held;
+    }
+#endif
+    portEXIT_CRITICAL(&heap->lock);
+}
+
+/* Bytes charged against the job limit, including growth still in flight. */
+static inline size_t m_region_heap_committed_locked(m_region_heap_t *heap)
+{
+    return heap->total_capacity + heap->large_bytes
+           + heap->pending_regions * MAGNOLIA_ALLOC_REGION_BYTES;
+}
+
+static inline size_t m_region_index_bucket(uintptr_t granule)
+{
+    return granule & (MAGNOLIA_ALLOC_INDEX_BUCKETS - 1);
+}
+
+static void m_region_index_insert_locked(m_region_heap_t *heap, m_region_t *region)
+{
+    for (size_t i = 0; i < region->index_count; ++i) {
+        m_region_index_entry_t *entry = &region->index[i];
+        size_t bucket = m_region_index_bucket(entry->granule);
+        entry->next = heap->index[bucket];
+        heap->index[bucket] = entry;
+    }
+}
+
+static void m_region_index_remove_locked(m_region_heap_t *heap, m_region_t *region)
+{
+    for (size_t i = 0; i < region->index_count; ++i) {
+        m_region_index_entry_t *entry = &region->index[i];
+        m_region_index_entry_t **link = &heap->index[m_region_index_bucket(entry->granule)];
+        while (*link != NULL && *link != entry) {
+            link = &(*link)->next;
+        }
+        if (*link != NULL) {
+            *link = entry->next;
+        }
+        entry->next = NULL;
+    }
+}
+
 static bool m_alloc_ptr_in_heap_regions_locked(m_region_heap_t *heap, void *ptr)
 {
     if (heap == NULL || ptr == NULL) {
@@ -133,9 +294,18 @@ static bool m_alloc_ptr_in_heap_regions_locked(m_region_heap_t *heap, void *ptr)
     }
 
     uintptr_t addr = (uintptr_t)ptr;
-    for (m_region_t *region = heap->regions; region != NULL; region = region->next) {
-        uintptr_t start = (uintptr_t)region->base + MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE;
-        uintptr_t end = (uintptr_t)region->base + region->size;
+    uintptr_t granule = addr >> MAGNOLIA_ALLOC_INDEX_SHIFT;
+    heap->ownership_checks += 1;
+    for (m_region_index_entry_t *entry = heap->index[m_region_index_bucket(granule)];
+         entry != NULL;
+         entry = entry->next) {
+        heap->ownership_probes += 1;
+        if (entry->granule != granule) {
+            continue;
+        }
+        /* Neighbouring regions may share a granule; keep looking on a miss. */
+        uintptr_t start = (uintptr_t)entry->region->base + MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE;
+        uintptr_t end = (uintptr_t)entry->region->base + entry->region->size;
         if (addr >= start && addr < end) {
             return true;
         }
@@ -158,6 +328,14 @@ static void global_stats_report_alloc(void)
     portEXIT_CRITICAL(&g_alloc_stats_lock);
 }
 
+static void global_stats_report_large_alloc(void)
+{
+    portENTER_CRITICAL(&g_alloc_stats_lock);
+    g_alloc_globals.total_allocations += 1;
+    g_alloc_globals.total_large_allocations += 1;
+    portEXIT_CRITICAL(&g_alloc_stats_lock);
+}
+
 static void global_stats_report_free(void)
 {
     portENTER_CRITICAL(&g_alloc_stats_lock);
@@ -165,6 +343,165 @@ static void global_stats_report_free(void)
     portEXIT_CRITICAL(&g_alloc_stats_lock);
 }
 
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+static unsigned m_alloc_profile_bucket(size_t size)
+{
+    unsigned bucket = 0;
+    size_t limit = 16;
+    while (size > limit && bucket + 1 < MAGNOLIA_ALLOC_PROFILE_HISTOGRAM_BUCKETS) {
+        limit <<= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+static uintptr_t m_alloc_profile_pc(uintptr_t pc)
+{
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    /* Windowed calls keep the window increment in the top two bits and
+     * return past the call instruction; point back into the caller. */
+    if (pc & 0x80000000U) {
+        pc = (pc & 0x3FFFFFFFU) | 0x40000000U;
+    }
+    return pc - 3;
+#else
+    return pc;
+#endif
+}
+
+static uint16_t m_alloc_profile_site_locked(m_alloc_profile_state_t *profile,
+                                            uintptr_t callsite)
+{
+    for (size_t i = 0; i < profile->site_count; ++i) {
+        if (profile->sites[i].callsite == callsite) {
+            return (uint16_t)(i + 1);
+        }
+    }
+    if (profile->site_count == MAGNOLIA_ALLOC_PROFILE_CALLSITES) {
+        return 0;
+    }
+    magnolia_alloc_profile_site_t *site = &profile->sites[profile->site_count++];
+    memset(site, 0, sizeof(*site));
+    site->callsite = callsite;
+    return (uint16_t)profile->site_count;
+}
+
+static void m_alloc_profile_record_locked(m_region_heap_t *heap,
+                                          m_region_block_t *block,
+                                          size_t size,
+                                          uintptr_t caller)
+{
+    m_alloc_profile_state_t *profile = &heap->profile;
+    profile->allocations += 1;
+    profile->live_objects += 1;
+    profile->histogram[m_alloc_profile_bucket(size)] += 1;
+
+    block->profile_site = 0;
+    if (profile->countdown > 0) {
+        profile->countdown -= 1;
+        return;
+    }
+    profile->countdown = MAGNOLIA_ALLOC_PROFILE_SAMPLE_RATE - 1;
+
+    uint16_t slot = m_alloc_profile_site_locked(profile, m_alloc_profile_pc(caller));
+    if (slot == 0) {
+        profile->dropped_samples += 1;
+        return;
+    }
+    magnolia_alloc_profile_site_t *site = &profile->sites[slot - 1];
+    site->samples += 1;
+    site->sampled_bytes += block->size;
+    site->live_objects += 1;
+    site->live_bytes += block->size;
+    block->profile_site = slot;
+}
+
+static void m_alloc_profile_release_locked(m_region_heap_t *heap,
+                                           m_region_block_t *block)
+{
+    m_alloc_profile_state_t *profile = &heap->profile;
+    profile->live_objects -= 1;
+    if (block->profile_site == 0) {
+        return;
+    }
+    magnolia_alloc_profile_site_t *site = &profile->sites[block->profile_site - 1];
+    site->live_objects -= 1;
+    site->live_bytes -= block->size;
+    block->profile_site = 0;
+}
+
+static void m_alloc_profile_resize_locked(m_region_heap_t *heap,
+                                          m_region_block_t *block,
+                                          size_t old_size)
+{
+    if (block->profile_site == 0) {
+        return;
+    }
+    magnolia_alloc_profile_site_t *site = &heap->profile.sites[block->profile_site - 1];
+    site->live_bytes = site->live_bytes - old_size + block->size;
+}
+
+static void m_alloc_profile_register(m_region_heap_t *heap, job_ctx_t *ctx)
+{
+    heap->profile.job_id = ctx->job_id;
+    portENTER_CRITICAL(&g_alloc_profile_lock);
+    heap->profile.next = g_alloc_profile_heaps;
+    g_alloc_profile_heaps = heap;
+    portEXIT_CRITICAL(&g_alloc_profile_lock);
+}
+
+static void m_alloc_profile_unregister(m_region_heap_t *heap)
+{
+    portENTER_CRITICAL(&g_alloc_profile_lock);
+    m_region_heap_t **link = &g_alloc_profile_heaps;
+    while (*link != NULL && *link != heap) {
+        link = &(*link)->profile.next;
+    }
+    if (*link == heap) {
+        *link = heap->profile.next;
+    }
+    portEXIT_CRITICAL(&g_alloc_profile_lock);
+}
+#else
+static inline void m_alloc_profile_record_locked(m_region_heap_t *heap,
+                                                 m_region_block_t *block,
+                                                 size_t size,
+                                                 uintptr_t caller)
+{
+    (void)heap;
+    (void)block;
+    (void)size;
+    (void)caller;
+}
+
+static inline void m_alloc_profile_release_locked(m_region_heap_t *heap,
+                                                  m_region_block_t *block)
+{
+    (void)heap;
+    (void)block;
+}
+
+static inline void m_alloc_profile_resize_locked(m_region_heap_t *heap,
+                                                 m_region_block_t *block,
+                                                 size_t old_size)
+{
+    (void)heap;
+    (void)block;
+    (void)old_size;
+}
+
+static inline void m_alloc_profile_register(m_region_heap_t *heap, job_ctx_t *ctx)
+{
+    (void)heap;
+    (void)ctx;
+}
+
+static inline void m_alloc_profile_unregister(m_region_heap_t *heap)
+{
+    (void)heap;
+}
+#endif
+
 static void m_alloc_report_error(job_ctx_t *ctx,
                                  const char *message,
                                  void *related)
@@ -190,26 +527,84 @@ static void m_alloc_fallback_free(void *ptr)
     m_arch_free(ptr);
 }
 
+static inline unsigned size_class_fls(size_t size)
+{
+    return (unsigned)(31 - __builtin_clz((unsigned int)size));
+}
+
+static void size_class_mapping(size_t size, unsigned *fl, unsigned *sl)
+{
+    if (size < MAGNOLIA_ALLOC_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (unsigned)(size / (MAGNOLIA_ALLOC_SMALL_BLOCK / MAGNOLIA_ALLOC_SL_COUNT));
+        return;
+    }
+
+    unsigned top = size_class_fls(size);
+    *fl = top - (MAGNOLIA_ALLOC_FL_SHIFT - 1);
+    *sl = (unsigned)(size >> (top - MAGNOLIA_ALLOC_SL_LOG2)) & (MAGNOLIA_ALLOC_SL_COUNT - 1);
+    if (*fl >= MAGNOLIA_ALLOC_FL_COUNT) {
+        *fl = MAGNOLIA_ALLOC_FL_COUNT - 1;
+        *sl = MAGNOLIA_ALLOC_SL_COUNT - 1;
+    }
+}
+
+/*
+ * Round the request up to the next class boundary so any block taken from the
+ * resulting list is large enough without walking it.
+ */
+static bool size_class_search_mapping(size_t size, unsigned *fl, unsigned *sl)
+{
+    size_t rounded;
+    if (size < MAGNOLIA_ALLOC_SMALL_BLOCK) {
+        rounded = size + (MAGNOLIA_ALLOC_SMALL_BLOCK / MAGNOLIA_ALLOC_SL_COUNT) - 1;
+    } else {
+        rounded = size + ((size_t)1U << (size_class_fls(size) - MAGNOLIA_ALLOC_SL_LOG2)) - 1;
+    }
+    if (rounded >= ((size_t)1U << (MAGNOLIA_ALLOC_FL_COUNT + MAGNOLIA_ALLOC_FL_SHIFT - 1))) {
+        return false;
+    }
+    size_class_mapping(rounded, fl, sl);
+    return true;
+}
+
 static void insert_free_block(m_region_heap_t *heap, m_region_block_t *block)
 {
-    block->free_next = heap->free_list;
+    unsigned fl = 0;
+    unsigned sl = 0;
+    size_class_mapping(block->size, &fl, &sl);
+
+    m_region_block_t *head = heap->free_lists[fl][sl];
+    block->free_next = head;
     block->free_prev = NULL;
-    if (heap->free_list) {
-        heap->free_list->free_prev = block;
+    if (head) {
+        head->free_prev = block;
     }
-    heap->free_list = block;
+    heap->free_lists[fl][sl] = block;
+    heap->fl_bitmap |= (1U << fl);
+    heap->sl_bitmap[fl] |= (1U << sl);
 }
 
 static void detach_free_block(m_region_heap_t *heap, m_region_block_t *block)
 {
+    unsigned fl = 0;
+    unsigned sl = 0;
+    size_class_mapping(block->size, &fl, &sl);
+
     if (block->free_prev) {
         block->free_prev->free_next = block->free_next;
     }
     if (block->free_next) {
         block->free_next->free_prev = block->free_prev;
     }
-    if (heap->free_list == block) {
-        heap->free_list = block->free_next;
+    if (heap->free_lists[fl][sl] == block) {
+        heap->free_lists[fl][sl] = block->free_next;
+        if (heap->free_lists[fl][sl] == NULL) {
+            heap->sl_bitmap[fl] &= ~(1U << sl);
+            if (heap->sl_bitmap[fl] == 0) {
+                heap->fl_bitmap &= ~(1U << fl);
+            }
+        }
     }
     block->free_next = NULL;
     block->free_prev = NULL;
@@ -217,8 +612,35 @@ static void detach_free_block(m_region_heap_t *heap, m_region_block_t *block)
 
 static m_region_block_t *find_fit_block(m_region_heap_t *heap, size_t required)
 {
-    m_region_block_t *cursor = heap->free_list;
-    while (cursor != NULL) {
+    unsigned fl = 0;
+    unsigned sl = 0;
+    if (size_class_search_mapping(required, &fl, &sl)) {
+        uint32_t sl_map = heap->sl_bitmap[fl] & (~0U << sl);
+        if (sl_map == 0) {
+            uint32_t fl_map = (fl + 1 < MAGNOLIA_ALLOC_FL_COUNT)
+                                  ? (heap->fl_bitmap & (~0U << (fl + 1)))
+                                  : 0;
+            if (fl_map != 0) {
+                fl = (unsigned)__builtin_ctz(fl_map);
+                sl_map = heap->sl_bitmap[fl];
+            }
+        }
+        if (sl_map != 0) {
+            sl = (unsigned)__builtin_ctz(sl_map);
+            return heap->free_lists[fl][sl];
+        }
+    }
+
+    /*
+     * No class strictly above the request has a block; the request's own class
+     * may still hold one that fits (e.g. a fresh region's single block), so
+     * check a bounded number of its entries before giving up.
+     */
+    size_class_mapping(required, &fl, &sl);
+    m_region_block_t *cursor = heap->free_lists[fl][sl];
+    for (size_t scanned = 0;
+         cursor != NULL && scanned < MAGNOLIA_ALLOC_CLASS_SCAN_LIMIT;
+         ++scanned) {
         if (cursor->size >= required) {
             return cursor;
         }
@@ -230,15 +652,20 @@ static m_region_block_t *find_fit_block(m_region_heap_t *heap, size_t required)
 static void add_region_to_heap(m_region_heap_t *heap, m_region_t *region)
 {
     region->next = heap->regions;
+    region->prev = NULL;
+    if (heap->regions) {
+        heap->regions->prev = region;
+    }
     heap->regions = region;
     heap->region_count += 1;
     heap->total_capacity += region->size;
+    m_region_index_insert_locked(heap, region);
     global_stats_add_region(region->size);
 }
 
-static m_region_t *m_region_alloc(void)
+static m_region_t *m_region_alloc(size_t bytes, bool large)
 {
-    void *raw = m_arch_malloc(MAGNOLIA_ALLOC_REGION_BYTES);
+    void *raw = large ? m_arch_malloc_large(bytes) : m_arch_malloc(bytes);
     if (raw == NULL) {
         return NULL;
     }
@@ -246,18 +673,22 @@ static m_region_t *m_region_alloc(void)
     uintptr_t raw_addr = (uintptr_t)raw;
     uintptr_t aligned = MAGNOLIA_ALLOC_ROUND_UP(raw_addr, MAGNOLIA_ALLOC_ALIGNMENT);
     size_t offset = aligned - raw_addr;
-    if (offset >= MAGNOLIA_ALLOC_REGION_BYTES) {
+    if (offset >= bytes) {
         m_arch_free(raw);
         return NULL;
     }
 
-    size_t usable = MAGNOLIA_ALLOC_REGION_BYTES - offset;
+    size_t usable = bytes - offset;
     if (usable <= MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE) {
         m_arch_free(raw);
         return NULL;
     }
 
-    m_region_t *region = pvPortMalloc(sizeof(*region));
+    uintptr_t first = aligned >> MAGNOLIA_ALLOC_INDEX_SHIFT;
+    uintptr_t last = (aligned + usable - 1) >> MAGNOLIA_ALLOC_INDEX_SHIFT;
+    size_t index_count = (size_t)(last - first) + 1;
+    m_region_t *region = pvPortMalloc(sizeof(*region)
+                                      + index_count * sizeof(m_region_index_entry_t));
     if (region == NULL) {
         m_arch_free(raw);
         return NULL;
@@ -267,9 +698,30 @@ static m_region_t *m_region_alloc(void)
     region->base = (void *)aligned;
     region->size = usable;
     region->next = NULL;
+    region->prev = NULL;
+    region->large = large;
+    region->index_count = index_count;
+    for (size_t i = 0; i < index_count; ++i) {
+        region->index[i].granule = first + i;
+        region->index[i].region = region;
+        region->index[i].next = NULL;
+    }
     return region;
 }
 
+static void m_region_release(m_region_t *region)
+{
+    if (region->raw != NULL) {
+        m_arch_free(region->raw);
+    }
+    vPortFree(region);
+}
+
+static inline size_t large_footprint(size_t payload)
+{
+    return MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE + payload + MAGNOLIA_ALLOC_ALIGNMENT;
+}
+
 static m_region_block_t *merge_blocks(m_region_block_t *left,
                                       m_region_block_t *right,
                                       m_region_heap_t *heap)
@@ -288,17 +740,28 @@ static m_region_block_t *merge_blocks(m_region_block_t *left,
     return left;
 }
 
-static void coalesce_free_block(m_region_heap_t *heap, m_region_block_t *block)
+static inline bool block_spans_region(m_region_block_t *block)
+{
+    return (void *)block == block->region->base
+           && (block->next == NULL || block->next->region != block->region);
+}
+
+static m_region_block_t *coalesce_free_block(m_region_heap_t *heap,
+                                             m_region_block_t *block)
 {
-    if (block->prev && !block->prev->allocated) {
+    /* The block list spans every region; only merge physical neighbours. */
+    if (block->prev && !block->prev->allocated
+        && block->prev->region == block->region) {
         detach_free_block(heap, block->prev);
         block = merge_blocks(block->prev, block, heap);
     }
-    if (block->next && !block->next->allocated) {
+    if (block->next && !block->next->allocated
+        && block->next->region == block->region) {
         detach_free_block(heap, block->next);
         merge_blocks(block, block->next, heap);
     }
     insert_free_block(heap, block);
+    return block;
 }
 
 static void split_block(m_region_heap_t *heap,
@@ -341,21 +804,66 @@ static void split_block(m_region_heap_t *heap,
     insert_free_block(heap, second);
 }
 
-static bool m_region_heap_grow(m_region_heap_t *heap)
+/*
+ * Resize an allocated block in place: grow into a free physical neighbour or
+ * hand the unused tail back to the free lists. Returns false when the block
+ * cannot reach @p required without moving.
+ */
+static bool m_region_heap_resize_locked(m_region_heap_t *heap,
+                                        m_region_block_t *block,
+                                        size_t required)
 {
-    if (MAGNOLIA_ALLOC_MAX_REGIONS > 0 && heap->region_count >= MAGNOLIA_ALLOC_MAX_REGIONS) {
-        return false;
+    size_t old_size = block->size;
+    if (required > old_size) {
+        m_region_block_t *next = block->next;
+        if (next == NULL || next->allocated || next->region != block->region) {
+            return false;
+        }
+        uint8_t *next_end = (uint8_t *)block_data(next) + next->size;
+        if ((size_t)(next_end - (uint8_t *)block_data(block)) < required) {
+            return false;
+        }
+        detach_free_block(heap, next);
+        merge_blocks(block, next, heap);
     }
-    if (MAGNOLIA_ALLOC_MAX_JOB_HEAP > 0 &&
-        heap->total_capacity + MAGNOLIA_ALLOC_REGION_BYTES > MAGNOLIA_ALLOC_MAX_JOB_HEAP) {
-        return false;
+
+    split_block(heap, block, required);
+    m_region_block_t *tail = block->next;
+    if (tail != NULL && !tail->allocated && tail->region == block->region) {
+        detach_free_block(heap, tail);
+        coalesce_free_block(heap, tail);
     }
 
-    m_region_t *region = m_region_alloc();
-    if (region == NULL) {
+    heap->used_bytes = heap->used_bytes - old_size + block->size;
+    if (heap->used_bytes > heap->peak_bytes) {
+        heap->peak_bytes = heap->used_bytes;
+    }
+    m_alloc_profile_resize_locked(heap, block, old_size);
+    return true;
+}
+
+/*
+ * Growth is split so the platform allocator runs without the heap lock: the
+ * caller reserves a slot under the lock, drops it to allocate the region and
+ * publishes the result after relocking.
+ */
+static bool m_region_heap_reserve_growth_locked(m_region_heap_t *heap)
+{
+    if (MAGNOLIA_ALLOC_MAX_REGIONS > 0 &&
+        heap->region_count + heap->pending_regions >= MAGNOLIA_ALLOC_MAX_REGIONS) {
+        return false;
+    }
+    if (MAGNOLIA_ALLOC_MAX_JOB_HEAP > 0 &&
+        m_region_heap_committed_locked(heap) + MAGNOLIA_ALLOC_REGION_BYTES
+            > MAGNOLIA_ALLOC_MAX_JOB_HEAP) {
         return false;
     }
+    heap->pending_regions += 1;
+    return true;
+}
 
+static void m_region_heap_publish_locked(m_region_heap_t *heap, m_region_t *region)
+{
     add_region_to_heap(heap, region);
 
     m_region_block_t *block = (m_region_block_t *)region->base;
@@ -373,38 +881,176 @@ static bool m_region_heap_grow(m_region_heap_t *heap)
     }
     heap->block_tail = block;
     insert_free_block(heap, block);
-    return true;
+    heap->empty_regions += 1;
 }
 
-static void *m_region_heap_alloc(m_region_heap_t *heap, size_t size)
+/*
+ * Detach a drained region from the heap. The caller releases the returned
+ * region once the heap lock has been dropped.
+ */
+static m_region_t *m_region_heap_unlink_empty_locked(m_region_heap_t *heap,
+                                                     m_region_block_t *block)
 {
-    if (heap == NULL || size == 0) {
+    m_region_t *region = block->region;
+
+    detach_free_block(heap, block);
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        heap->block_head = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    } else {
+        heap->block_tail = block->prev;
+    }
+
+    if (region->prev) {
+        region->prev->next = region->next;
+    } else {
+        heap->regions = region->next;
+    }
+    if (region->next) {
+        region->next->prev = region->prev;
+    }
+    region->next = NULL;
+    region->prev = NULL;
+    m_region_index_remove_locked(heap, region);
+
+    heap->region_count -= 1;
+    heap->total_capacity -= region->size;
+    heap->empty_regions -= 1;
+    heap->reclaimed_bytes += region->size;
+    return region;
+}
+
+/*
+ * Large objects get their own platform allocation (PSRAM when available). The
+ * footprint is reserved against the job limit before the heap lock is dropped
+ * so the system allocator never runs inside the critical section.
+ */
+static void *m_region_heap_alloc_large(m_region_heap_t *heap,
+                                       size_t size,
+                                       uintptr_t caller)
+{
+    if (size > MAGNOLIA_ALLOC_MAX_JOB_HEAP) {
+        return NULL;
+    }
+    size_t required = align_up(size);
+    size_t footprint = large_footprint(required);
+
+    m_region_heap_lock(heap);
+    if (MAGNOLIA_ALLOC_MAX_JOB_HEAP > 0 &&
+        m_region_heap_committed_locked(heap) + footprint > MAGNOLIA_ALLOC_MAX_JOB_HEAP) {
+        m_region_heap_unlock(heap);
+        return NULL;
+    }
+    heap->large_bytes += footprint;
+    m_region_heap_unlock(heap);
+
+    m_region_t *region = m_region_alloc(footprint, true);
+    if (region == NULL || region->size < MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE + required) {
+        if (region != NULL) {
+            m_region_release(region);
+        }
+        m_region_heap_lock(heap);
+        heap->large_bytes -= footprint;
+        m_region_heap_unlock(heap);
         return NULL;
     }
 
-    if (size > MAGNOLIA_ALLOC_MAX_PAYLOAD) {
+    m_region_block_t *block = (m_region_block_t *)region->base;
+    memset(block, 0, MAGNOLIA_ALLOC_BLOCK_HEADER_SIZE);
+    block->size = required;
+    block->owner = heap;
+    block->region = region;
+    block->magic = MAGNOLIA_ALLOC_MAGIC;
+    block->allocated = true;
+
+    m_region_heap_lock(heap);
+    region->next = heap->large_regions;
+    if (heap->large_regions) {
+        heap->large_regions->prev = region;
+    }
+    heap->large_regions = region;
+    m_region_index_insert_locked(heap, region);
+    heap->large_count += 1;
+    heap->used_bytes += block->size;
+    if (heap->used_bytes > heap->peak_bytes) {
+        heap->peak_bytes = heap->used_bytes;
+    }
+    m_alloc_profile_record_locked(heap, block, size, caller);
+    global_stats_report_large_alloc();
+    m_region_heap_unlock(heap);
+    return block_data(block);
+}
+
+static void m_region_heap_unlink_large_locked(m_region_heap_t *heap,
+                                              m_region_block_t *block)
+{
+    m_region_t *region = block->region;
+    if (region->prev) {
+        region->prev->next = region->next;
+    } else {
+        heap->large_regions = region->next;
+    }
+    if (region->next) {
+        region->next->prev = region->prev;
+    }
+    region->next = NULL;
+    region->prev = NULL;
+    m_region_index_remove_locked(heap, region);
+
+    m_alloc_profile_release_locked(heap, block);
+    block->allocated = false;
+    heap->used_bytes -= block->size;
+    heap->large_bytes -= large_footprint(block->size);
+    heap->large_count -= 1;
+    global_stats_report_free();
+}
+
+static void *m_region_heap_alloc(m_region_heap_t *heap,
+                                 size_t size,
+                                 uintptr_t caller)
+{
+    if (heap == NULL || size == 0) {
         return NULL;
     }
 
+    if (size >= MAGNOLIA_ALLOC_LARGE_THRESHOLD) {
+        return m_region_heap_alloc_large(heap, size, caller);
+    }
+
     size_t required = align_up(size);
     if (required > MAGNOLIA_ALLOC_MAX_PAYLOAD) {
         return NULL;
     }
 
-    portENTER_CRITICAL(&heap->lock);
+    m_region_heap_lock(heap);
     m_region_block_t *block = find_fit_block(heap, required);
-    if (block == NULL) {
-        if (!m_region_heap_grow(heap)) {
-            portEXIT_CRITICAL(&heap->lock);
+    for (size_t attempt = 0; block == NULL; ++attempt) {
+        if (attempt >= MAGNOLIA_ALLOC_GROW_RETRIES
+            || !m_region_heap_reserve_growth_locked(heap)) {
+            m_region_heap_unlock(heap);
             return NULL;
         }
-        block = find_fit_block(heap, required);
-        if (block == NULL) {
-            portEXIT_CRITICAL(&heap->lock);
+        m_region_heap_unlock(heap);
+
+        m_region_t *region = m_region_alloc(MAGNOLIA_ALLOC_REGION_BYTES, false);
+
+        m_region_heap_lock(heap);
+        heap->pending_regions -= 1;
+        if (region == NULL) {
+            m_region_heap_unlock(heap);
             return NULL;
         }
+        m_region_heap_publish_locked(heap, region);
+        block = find_fit_block(heap, required);
     }
 
+    if (block_spans_region(block)) {
+        heap->empty_regions -= 1;
+    }
     detach_free_block(heap, block);
     split_block(heap, block, required);
     block->allocated = true;
@@ -412,18 +1058,30 @@ static void *m_region_heap_alloc(m_region_heap_t *heap, size_t size)
     if (heap->used_bytes > heap->peak_bytes) {
         heap->peak_bytes = heap->used_bytes;
     }
+    m_alloc_profile_record_locked(heap, block, size, caller);
     global_stats_report_alloc();
     void *result = block_data(block);
-    portEXIT_CRITICAL(&heap->lock);
+    m_region_heap_unlock(heap);
     return result;
 }
 
-static void m_region_heap_free_block(m_region_heap_t *heap, m_region_block_t *block)
+static m_region_t *m_region_heap_free_block(m_region_heap_t *heap,
+                                            m_region_block_t *block)
 {
+    m_alloc_profile_release_locked(heap, block);
     block->allocated = false;
     heap->used_bytes -= block->size;
     global_stats_report_free();
-    coalesce_free_block(heap, block);
+    m_region_block_t *merged = coalesce_free_block(heap, block);
+    if (!block_spans_region(merged)) {
+        return NULL;
+    }
+
+    heap->empty_regions += 1;
+    if (heap->empty_regions <= MAGNOLIA_ALLOC_RETAIN_EMPTY_REGIONS) {
+        return NULL;
+    }
+    return m_region_heap_unlink_empty_locked(heap, merged);
 }
 
 static void m_region_heap_destroy(m_region_heap_t *heap)
@@ -435,10 +1093,14 @@ static void m_region_heap_destroy(m_region_heap_t *heap)
     m_region_t *region = heap->regions;
     while (region != NULL) {
         m_region_t *next = region->next;
-        if (region->raw != NULL) {
-            m_arch_free(region->raw);
-        }
-        vPortFree(region);
+        m_region_release(region);
+        region = next;
+    }
+
+    region = heap->large_regions;
+    while (region != NULL) {
+        m_region_t *next = region->next;
+        m_region_release(region);
         region = next;
     }
 
@@ -480,6 +1142,7 @@ static m_region_heap_t *m_alloc_ensure_heap(job_ctx_t *ctx)
     if (ctx == NULL) {
         return NULL;
     }
+    bool created = false;
     portENTER_CRITICAL(&ctx->lock);
     m_region_heap_t *heap = ctx->region_heap;
     if (heap == NULL) {
@@ -488,9 +1151,13 @@ static m_region_heap_t *m_alloc_ensure_heap(job_ctx_t *ctx)
             memset(heap, 0, sizeof(*heap));
             heap->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
             ctx->region_heap = heap;
+            created = true;
         }
     }
     portEXIT_CRITICAL(&ctx->lock);
+    if (created) {
+        m_alloc_profile_register(heap, ctx);
+    }
     return heap;
 }
 
@@ -507,7 +1174,7 @@ void m_alloc_init(void)
     g_system_job_ctx = ctx;
 }
 
-void *m_job_alloc(job_ctx_t *ctx, size_t size)
+static void *m_job_alloc_from(job_ctx_t *ctx, size_t size, uintptr_t caller)
 {
     if (size == 0) {
         return NULL;
@@ -524,7 +1191,7 @@ void *m_job_alloc(job_ctx_t *ctx, size_t size)
         return NULL;
     }
 
-    void *result = m_region_heap_alloc(heap, size);
+    void *result = m_region_heap_alloc(heap, size, caller);
     if (result == NULL) {
         m_alloc_report_error(target, "out of memory", NULL);
     }
@@ -537,7 +1204,10 @@ void *m_job_alloc(job_ctx_t *ctx, size_t size)
     return result;
 }
 
-void *m_job_calloc(job_ctx_t *ctx, size_t nmemb, size_t size)
+static void *m_job_calloc_from(job_ctx_t *ctx,
+                               size_t nmemb,
+                               size_t size,
+                               uintptr_t caller)
 {
     if (nmemb == 0 || size == 0) {
         return NULL;
@@ -549,7 +1219,7 @@ void *m_job_calloc(job_ctx_t *ctx, size_t nmemb, size_t size)
     job_ctx_t *logger_ctx = m_alloc_effective_ctx(ctx);
 
     size_t total = nmemb * size;
-    void *ptr = m_job_alloc(ctx, total);
+    void *ptr = m_job_alloc_from(ctx, total, caller);
     if (ptr != NULL) {
         memset(ptr, 0, total);
         MAGNOLIA_ALLOC_DEBUG_LOG("job=%p calloc size=%zu ptr=%p",
@@ -560,10 +1230,13 @@ void *m_job_calloc(job_ctx_t *ctx, size_t nmemb, size_t size)
     return ptr;
 }
 
-void *m_job_realloc(job_ctx_t *ctx, void *ptr, size_t new_size)
+static void *m_job_realloc_from(job_ctx_t *ctx,
+                                void *ptr,
+                                size_t new_size,
+                                uintptr_t caller)
 {
     if (ptr == NULL) {
-        return m_job_alloc(ctx, new_size);
+        return m_job_alloc_from(ctx, new_size, caller);
     }
     if (new_size == 0) {
         m_job_free(ctx, ptr);
@@ -591,11 +1264,26 @@ void *m_job_realloc(job_ctx_t *ctx, void *ptr, size_t new_size)
         return NULL;
     }
 
+    if (!block->region->large
+        && (new_size <= block->size || new_size < MAGNOLIA_ALLOC_LARGE_THRESHOLD)) {
+        m_region_heap_lock(heap);
+        if (!block->allocated) {
+            m_region_heap_unlock(heap);
+            m_alloc_report_error(target, "realloc after free", ptr);
+            return NULL;
+        }
+        bool resized = m_region_heap_resize_locked(heap, block, align_up(new_size));
+        m_region_heap_unlock(heap);
+        if (resized) {
+            return ptr;
+        }
+    }
+
     if (new_size <= block->size) {
         return ptr;
     }
 
-    void *new_ptr = m_region_heap_alloc(heap, new_size);
+    void *new_ptr = m_region_heap_alloc(heap, new_size, caller);
     if (new_ptr == NULL) {
         return NULL;
     }
@@ -610,6 +1298,25 @@ void *m_job_realloc(job_ctx_t *ctx, void *ptr, size_t new_size)
     return new_ptr;
 }
 
+/*
+ * The public entry points and libc wrappers record their own return address
+ * so the profiler attributes allocations to the code that asked for them.
+ */
+void *m_job_alloc(job_ctx_t *ctx, size_t size)
+{
+    return m_job_alloc_from(ctx, size, MAGNOLIA_ALLOC_CALLER());
+}
+
+void *m_job_calloc(job_ctx_t *ctx, size_t nmemb, size_t size)
+{
+    return m_job_calloc_from(ctx, nmemb, size, MAGNOLIA_ALLOC_CALLER());
+}
+
+void *m_job_realloc(job_ctx_t *ctx, void *ptr, size_t new_size)
+{
+    return m_job_realloc_from(ctx, ptr, new_size, MAGNOLIA_ALLOC_CALLER());
+}
+
 void m_job_free(job_ctx_t *ctx, void *ptr)
 {
     if (ptr == NULL) {
@@ -641,9 +1348,9 @@ void m_job_free(job_ctx_t *ctx, void *ptr)
              * an interior pointer will corrupt ESP-IDF's heap and eventually
              * assert in TLSF.
              */
-            portENTER_CRITICAL(&heap->lock);
+            m_region_heap_lock(heap);
             bool in_regions = m_alloc_ptr_in_heap_regions_locked(heap, ptr);
-            portEXIT_CRITICAL(&heap->lock);
+            m_region_heap_unlock(heap);
             if (in_regions) {
                 m_alloc_report_error(target, "free header corrupted", ptr);
                 return;
@@ -659,17 +1366,27 @@ void m_job_free(job_ctx_t *ctx, void *ptr)
         return;
     }
 
-    portENTER_CRITICAL(&heap->lock);
+    m_region_t *released = NULL;
+    m_region_heap_lock(heap);
     if (!block->allocated) {
-        portEXIT_CRITICAL(&heap->lock);
+        m_region_heap_unlock(heap);
         m_alloc_report_error(target, "double free", ptr);
         return;
     }
-    m_region_heap_free_block(heap, block);
+    if (block->region->large) {
+        released = block->region;
+        m_region_heap_unlink_large_locked(heap, block);
+    } else {
+        released = m_region_heap_free_block(heap, block);
+    }
     MAGNOLIA_ALLOC_DEBUG_LOG("job=%p free ptr=%p",
                              target->job_id,
                              ptr);
-    portEXIT_CRITICAL(&heap->lock);
+    m_region_heap_unlock(heap);
+
+    if (released != NULL) {
+        m_region_release(released);
+    }
 }
 
 void m_alloc_teardown_job_ctx(job_ctx_t *ctx)
@@ -685,10 +1402,51 @@ void m_alloc_teardown_job_ctx(job_ctx_t *ctx)
     portEXIT_CRITICAL(&ctx->lock);
 
     if (heap != NULL) {
+        m_alloc_profile_unregister(heap);
         m_region_heap_destroy(heap);
     }
 }
 
+size_t m_alloc_trim(job_ctx_t *ctx)
+{
+    if (ctx == NULL) {
+        return 0;
+    }
+
+    m_region_heap_t *heap = NULL;
+    portENTER_CRITICAL(&ctx->lock);
+    heap = ctx->region_heap;
+    portEXIT_CRITICAL(&ctx->lock);
+
+    if (heap == NULL) {
+        return 0;
+    }
+
+    m_region_t *released = NULL;
+    size_t reclaimed = 0;
+    m_region_heap_lock(heap);
+    m_region_t *region = heap->regions;
+    while (region != NULL && heap->empty_regions > 0) {
+        m_region_t *next = region->next;
+        m_region_block_t *block = (m_region_block_t *)region->base;
+        if (!block->allocated && block_spans_region(block)) {
+            m_region_heap_unlink_empty_locked(heap, block);
+            reclaimed += region->size;
+            region->next = released;
+            released = region;
+        }
+        region = next;
+    }
+    m_region_heap_unlock(heap);
+
+    while (released != NULL) {
+        m_region_t *next = released->next;
+        m_region_release(released);
+        released = next;
+    }
+    return reclaimed;
+}
+
 void m_alloc_get_job_stats(job_ctx_t *ctx, magnolia_alloc_job_stats_t *out)
 {
     if (out == NULL) {
@@ -709,12 +1467,22 @@ void m_alloc_get_job_stats(job_ctx_t *ctx, magnolia_alloc_job_stats_t *out)
         return;
     }
 
-    portENTER_CRITICAL(&heap->lock);
+    m_region_heap_lock(heap);
     out->used_bytes = heap->used_bytes;
     out->peak_bytes = heap->peak_bytes;
-    out->capacity_bytes = heap->total_capacity;
+    out->capacity_bytes = heap->total_capacity + heap->large_bytes;
     out->region_count = heap->region_count;
-    portEXIT_CRITICAL(&heap->lock);
+    out->large_count = heap->large_count;
+    out->large_bytes = heap->large_bytes;
+    out->reclaimed_bytes = heap->reclaimed_bytes;
+    out->ownership_checks = heap->ownership_checks;
+    out->ownership_probes = heap->ownership_probes;
+#if CONFIG_MAGNOLIA_ALLOC_TRACE_LOCK_HOLD
+    out->lock_hold_count = heap->lock_hold_count;
+    out->lock_hold_max_cycles = heap->lock_hold_max_cycles;
+    out->lock_hold_total_cycles = heap->lock_hold_total_cycles;
+#endif
+    m_region_heap_unlock(heap);
 }
 
 void m_alloc_get_global_stats(magnolia_alloc_global_stats_t *out)
@@ -728,9 +1496,180 @@ void m_alloc_get_global_stats(magnolia_alloc_global_stats_t *out)
     out->total_psram_bytes = g_alloc_globals.total_psram_bytes;
     out->total_allocations = g_alloc_globals.total_allocations;
     out->total_frees = g_alloc_globals.total_frees;
+    out->total_large_allocations = g_alloc_globals.total_large_allocations;
     portEXIT_CRITICAL(&g_alloc_stats_lock);
 }
 
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+static void m_alloc_profile_copy_locked(m_region_heap_t *heap,
+                                        magnolia_alloc_profile_t *out)
+{
+    const m_alloc_profile_state_t *profile = &heap->profile;
+    out->job_id = profile->job_id;
+    out->sample_rate = MAGNOLIA_ALLOC_PROFILE_SAMPLE_RATE;
+    out->allocations = profile->allocations;
+    out->live_objects = profile->live_objects;
+    out->used_bytes = heap->used_bytes;
+    out->peak_bytes = heap->peak_bytes;
+    out->dropped_samples = profile->dropped_samples;
+    memcpy(out->histogram, profile->histogram, sizeof(out->histogram));
+    out->site_count = profile->site_count;
+    memcpy(out->sites, profile->sites, profile->site_count * sizeof(out->sites[0]));
+}
+#endif
+
+bool m_alloc_profile_get_job(job_ctx_t *ctx, magnolia_alloc_profile_t *out)
+{
+    if (out == NULL) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    if (ctx == NULL) {
+        return false;
+    }
+
+    m_region_heap_t *heap = NULL;
+    portENTER_CRITICAL(&ctx->lock);
+    heap = ctx->region_heap;
+    portEXIT_CRITICAL(&ctx->lock);
+
+    if (heap == NULL) {
+        return false;
+    }
+
+    m_region_heap_lock(heap);
+    m_alloc_profile_copy_locked(heap, out);
+    m_region_heap_unlock(heap);
+    return true;
+#else
+    (void)ctx;
+    return false;
+#endif
+}
+
+bool m_alloc_profile_get(size_t index, magnolia_alloc_profile_t *out)
+{
+    if (out == NULL) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    bool found = false;
+    portENTER_CRITICAL(&g_alloc_profile_lock);
+    m_region_heap_t *heap = g_alloc_profile_heaps;
+    while (heap != NULL && index > 0) {
+        heap = heap->profile.next;
+        --index;
+    }
+    if (heap != NULL) {
+        m_region_heap_lock(heap);
+        m_alloc_profile_copy_locked(heap, out);
+        m_region_heap_unlock(heap);
+        found = true;
+    }
+    portEXIT_CRITICAL(&g_alloc_profile_lock);
+    return found;
+#else
+    (void)index;
+    return false;
+#endif
+}
+
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+static size_t m_alloc_profile_append(char *buf,
+                                     size_t len,
+                                     size_t offset,
+                                     const char *fmt,
+                                     ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    char *dst = (offset < len) ? buf + offset : NULL;
+    size_t room = (offset < len) ? len - offset : 0;
+    int written = vsnprintf(dst, room, fmt, args);
+    va_end(args);
+    return written > 0 ? offset + (size_t)written : offset;
+}
+
+static void m_alloc_profile_sort_sites(magnolia_alloc_profile_t *profile)
+{
+    for (size_t i = 1; i < profile->site_count; ++i) {
+        magnolia_alloc_profile_site_t site = profile->sites[i];
+        size_t j = i;
+        while (j > 0 && (profile->sites[j - 1].live_bytes < site.live_bytes
+                         || (profile->sites[j - 1].live_bytes == site.live_bytes
+                             && profile->sites[j - 1].samples < site.samples))) {
+            profile->sites[j] = profile->sites[j - 1];
+            --j;
+        }
+        profile->sites[j] = site;
+    }
+}
+#endif
+
+size_t m_alloc_profile_format(char *buf, size_t len)
+{
+    if (buf != NULL && len > 0) {
+        buf[0] = '\0';
+    } else {
+        buf = NULL;
+        len = 0;
+    }
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    magnolia_alloc_profile_t *profile = pvPortMalloc(sizeof(*profile));
+    if (profile == NULL) {
+        return 0;
+    }
+
+    size_t offset = 0;
+    for (size_t index = 0; m_alloc_profile_get(index, profile); ++index) {
+        offset = m_alloc_profile_append(buf, len, offset,
+                                        "job %p used=%zu peak=%zu live=%zu "
+                                        "allocs=%zu sample=1/%zu dropped=%zu\n",
+                                        profile->job_id,
+                                        profile->used_bytes,
+                                        profile->peak_bytes,
+                                        profile->live_objects,
+                                        profile->allocations,
+                                        profile->sample_rate,
+                                        profile->dropped_samples);
+
+        offset = m_alloc_profile_append(buf, len, offset, "  sizes:");
+        size_t limit = 16;
+        for (size_t b = 0; b < MAGNOLIA_ALLOC_PROFILE_HISTOGRAM_BUCKETS; ++b) {
+            if (profile->histogram[b] != 0) {
+                bool last = (b + 1 == MAGNOLIA_ALLOC_PROFILE_HISTOGRAM_BUCKETS);
+                offset = m_alloc_profile_append(buf, len, offset,
+                                                last ? " >%zu:%zu" : " <=%zu:%zu",
+                                                last ? limit >> 1 : limit,
+                                                profile->histogram[b]);
+            }
+            limit <<= 1;
+        }
+        offset = m_alloc_profile_append(buf, len, offset, "\n");
+
+        m_alloc_profile_sort_sites(profile);
+        for (size_t i = 0; i < profile->site_count; ++i) {
+            const magnolia_alloc_profile_site_t *site = &profile->sites[i];
+            offset = m_alloc_profile_append(buf, len, offset,
+                                            "  pc=0x%08" PRIxPTR " samples=%zu "
+                                            "bytes=%zu live=%zu live_bytes=%zu\n",
+                                            site->callsite,
+                                            site->samples,
+                                            site->sampled_bytes,
+                                            site->live_objects,
+                                            site->live_bytes);
+        }
+    }
+
+    vPortFree(profile);
+    return offset;
+#else
+    return 0;
+#endif
+}
+
 #if CONFIG_MAGNOLIA_ALLOC_WRAP_LIBC
 /* Provided by the linker when using -Wl,--wrap=... */
 void *__real_malloc(size_t size);
@@ -755,16 +1694,16 @@ static bool m_alloc_ptr_in_job_regions(job_ctx_t *ctx, void *ptr)
         return false;
     }
 
-    portENTER_CRITICAL(&heap->lock);
+    m_region_heap_lock(heap);
     bool in_regions = m_alloc_ptr_in_heap_regions_locked(heap, ptr);
-    portEXIT_CRITICAL(&heap->lock);
+    m_region_heap_unlock(heap);
     return in_regions;
 }
 
 void *__wrap_malloc(size_t size)
 {
     if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED && jctx_current() != NULL) {
-        return m_job_alloc(NULL, size);
+        return m_job_alloc_from(NULL, size, MAGNOLIA_ALLOC_CALLER());
     }
     return __real_malloc(size);
 }
@@ -772,7 +1711,7 @@ void *__wrap_malloc(size_t size)
 void *__wrap_calloc(size_t nmemb, size_t size)
 {
     if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED && jctx_current() != NULL) {
-        return m_job_calloc(NULL, nmemb, size);
+        return m_job_calloc_from(NULL, nmemb, size, MAGNOLIA_ALLOC_CALLER());
     }
     return __real_calloc(nmemb, size);
 }
@@ -783,7 +1722,7 @@ void *__wrap_realloc(void *ptr, size_t size)
         job_ctx_t *ctx = jctx_current();
         if (ctx != NULL) {
             if (ptr == NULL || m_alloc_ptr_in_job_regions(ctx, ptr)) {
-                return m_job_realloc(ctx, ptr, size);
+                return m_job_realloc_from(ctx, ptr, size, MAGNOLIA_ALLOC_CALLER());
             }
             m_alloc_report_error(ctx, "realloc pointer mismatch", ptr);
             return NULL;
@@ -817,7 +1756,7 @@ void __wrap_free(void *ptr)
 void *__wrap__malloc_r(struct _reent *r, size_t size)
 {
     if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED && jctx_current() != NULL) {
-        return m_job_alloc(NULL, size);
+        return m_job_alloc_from(NULL, size, MAGNOLIA_ALLOC_CALLER());
     }
     return __real__malloc_r(r, size);
 }
@@ -825,7 +1764,7 @@ void *__wrap__malloc_r(struct _reent *r, size_t size)
 void *__wrap__calloc_r(struct _reent *r, size_t nmemb, size_t size)
 {
     if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED && jctx_current() != NULL) {
-        return m_job_calloc(NULL, nmemb, size);
+        return m_job_calloc_from(NULL, nmemb, size, MAGNOLIA_ALLOC_CALLER());
     }
     return __real__calloc_r(r, nmemb, size);
 }
@@ -836,7 +1775,7 @@ void *__wrap__realloc_r(struct _reent *r, void *ptr, size_t size)
         job_ctx_t *ctx = jctx_current();
         if (ctx != NULL) {
             if (ptr == NULL || m_alloc_ptr_in_job_regions(ctx, ptr)) {
-                return m_job_realloc(ctx, ptr, size);
+                return m_job_realloc_from(ctx, ptr, size, MAGNOLIA_ALLOC_CALLER());
             }
             m_alloc_report_error(ctx, "realloc pointer mismatch", ptr);
             return NULL;
@@ -5,6 +5,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "kernel/core/job/jctx.h"
@@ -21,6 +22,18 @@ typedef struct {
     size_t peak_bytes;
     size_t capacity_bytes;
     size_t region_count;
+    size_t large_count;
+    size_t large_bytes;
+    size_t reclaimed_bytes;
+    /* Pointer ownership lookups made by the libc free/realloc wrappers and
+     * the index entries they visited; probes / checks is the average cost. */
+    size_t ownership_checks;
+    size_t ownership_probes;
+    /* Heap critical-section tracepoint; zero unless
+     * CONFIG_MAGNOLIA_ALLOC_TRACE_LOCK_HOLD is enabled. */
+    uint32_t lock_hold_count;
+    uint32_t lock_hold_max_cycles;
+    uint64_t lock_hold_total_cycles;
 } magnolia_alloc_job_stats_t;
 
 /**
@@ -31,8 +44,48 @@ typedef struct {
     size_t total_psram_bytes;
     size_t total_allocations;
     size_t total_frees;
+    size_t total_large_allocations;
 } magnolia_alloc_global_stats_t;
 
+#ifndef CONFIG_MAGNOLIA_ALLOC_PROFILE_CALLSITES
+#define CONFIG_MAGNOLIA_ALLOC_PROFILE_CALLSITES 16
+#endif
+
+/* Histogram bucket i counts requests of at most 16 << i bytes; the last
+ * bucket takes everything larger. */
+#define MAGNOLIA_ALLOC_PROFILE_HISTOGRAM_BUCKETS 12
+#define MAGNOLIA_ALLOC_PROFILE_CALLSITES CONFIG_MAGNOLIA_ALLOC_PROFILE_CALLSITES
+
+/**
+ * @brief Sampled allocations attributed to one caller return address.
+ */
+typedef struct {
+    uintptr_t callsite;
+    size_t samples;
+    size_t sampled_bytes;
+    size_t live_objects;
+    size_t live_bytes;
+} magnolia_alloc_profile_site_t;
+
+/**
+ * @brief Heap profile of a single job (CONFIG_MAGNOLIA_ALLOC_PROFILE).
+ *
+ * Histogram and live-object counts cover every allocation; the call site
+ * table only sees one out of sample_rate allocations.
+ */
+typedef struct {
+    m_job_id_t job_id;
+    size_t sample_rate;
+    size_t allocations;
+    size_t live_objects;
+    size_t used_bytes;
+    size_t peak_bytes;
+    size_t dropped_samples;
+    size_t histogram[MAGNOLIA_ALLOC_PROFILE_HISTOGRAM_BUCKETS];
+    size_t site_count;
+    magnolia_alloc_profile_site_t sites[MAGNOLIA_ALLOC_PROFILE_CALLSITES];
+} magnolia_alloc_profile_t;
+
 /**
  * @brief Initialize Magnolia allocator subsystems (system job context, stats, etc.).
  */
@@ -48,9 +101,39 @@ void m_job_free(job_ctx_t *ctx, void *ptr);
  */
 void m_alloc_teardown_job_ctx(job_ctx_t *ctx);
 
+/**
+ * @brief Return every completely free region of a job heap to the system.
+ *
+ * @return Number of bytes released.
+ */
+size_t m_alloc_trim(job_ctx_t *ctx);
+
 void m_alloc_get_job_stats(job_ctx_t *ctx, magnolia_alloc_job_stats_t *out);
 void m_alloc_get_global_stats(magnolia_alloc_global_stats_t *out);
 
+/**
+ * @brief Copy the heap profile of a job.
+ *
+ * @return false when profiling is disabled or the job has no heap yet.
+ */
+bool m_alloc_profile_get_job(job_ctx_t *ctx, magnolia_alloc_profile_t *out);
+
+/**
+ * @brief Copy the profile of the @p index-th live job heap.
+ *
+ * Iterate from 0 until this returns false. Heaps created or torn down while
+ * iterating may be skipped or reported twice.
+ */
+bool m_alloc_profile_get(size_t index, magnolia_alloc_profile_t *out);
+
+/**
+ * @brief Render the profile of every live job heap as text.
+ *
+ * @return Length of the full report, which may exceed @p len; the buffer
+ *         holds a NUL-terminated prefix in that case (snprintf semantics).
+ */
+size_t m_alloc_profile_format(char *buf, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
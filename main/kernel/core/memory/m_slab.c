@@ -0,0 +1,538 @@
+#include "kernel/core/memory/m_slab.h"
+
+#include "sdkconfig.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/portmacro.h"
+
+#include "kernel/arch/m_arch.h"
+
+#define TAG "m_slab"
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define M_SLAB_ALIGNMENT ((size_t)_Alignof(max_align_t))
+#else
+#define M_SLAB_ALIGNMENT (sizeof(void *))
+#endif
+#define M_SLAB_ROUND_UP(value, align) (((value) + ((align) - 1)) & ~((align) - 1))
+
+#define M_SLAB_MAGIC 0x4D534C42
+#define M_SLAB_BYTES CONFIG_MAGNOLIA_SLAB_SIZE
+#define M_SLAB_RETAIN_EMPTY CONFIG_MAGNOLIA_SLAB_RETAIN_EMPTY
+/* Even caches of large objects get a few per slab so growth is amortised. */
+#define M_SLAB_MIN_OBJECTS 4
+
+/*
+ * Every object is preceded by a tag holding its slab pointer, which makes
+ * free O(1). The low bit marks objects sitting on a free list or in a
+ * magazine so double frees are caught.
+ */
+#define M_SLAB_TAG_BYTES M_SLAB_ROUND_UP(sizeof(uintptr_t), M_SLAB_ALIGNMENT)
+#define M_SLAB_TAG_FREE ((uintptr_t)1)
+
+struct m_slab {
+    m_slab_cache_t *cache;
+    m_slab_t *next;
+    m_slab_t *prev;
+    void *free_list;
+    uint32_t magic;
+    uint16_t used;
+    uint16_t capacity;
+};
+
+#define M_SLAB_HEADER_BYTES M_SLAB_ROUND_UP(sizeof(m_slab_t), M_SLAB_ALIGNMENT)
+
+static portMUX_TYPE g_slab_registry_lock = portMUX_INITIALIZER_UNLOCKED;
+static m_slab_cache_t *g_slab_caches;
+
+static size_t m_slab_stride(const m_slab_cache_t *cache)
+{
+    size_t size = cache->object_size;
+    if (size < sizeof(void *)) {
+        size = sizeof(void *);
+    }
+    return M_SLAB_TAG_BYTES + M_SLAB_ROUND_UP(size, M_SLAB_ALIGNMENT);
+}
+
+static size_t m_slab_capacity(const m_slab_cache_t *cache)
+{
+    size_t stride = m_slab_stride(cache);
+    size_t count = 0;
+    if (M_SLAB_BYTES > M_SLAB_HEADER_BYTES) {
+        count = (M_SLAB_BYTES - M_SLAB_HEADER_BYTES) / stride;
+    }
+    if (count < M_SLAB_MIN_OBJECTS) {
+        count = M_SLAB_MIN_OBJECTS;
+    }
+    if (count > UINT16_MAX) {
+        count = UINT16_MAX;
+    }
+    return count;
+}
+
+static size_t m_slab_footprint(const m_slab_cache_t *cache)
+{
+    return M_SLAB_HEADER_BYTES + m_slab_capacity(cache) * m_slab_stride(cache);
+}
+
+static inline uintptr_t *m_slab_tag(void *obj)
+{
+    return (uintptr_t *)((uint8_t *)obj - M_SLAB_TAG_BYTES);
+}
+
+static void m_slab_list_push(m_slab_t **head, m_slab_t *slab)
+{
+    slab->prev = NULL;
+    slab->next = *head;
+    if (*head != NULL) {
+        (*head)->prev = slab;
+    }
+    *head = slab;
+}
+
+static void m_slab_list_remove(m_slab_t **head, m_slab_t *slab)
+{
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        *head = slab->next;
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+    slab->next = NULL;
+    slab->prev = NULL;
+}
+
+static void m_slab_register(m_slab_cache_t *cache)
+{
+    portENTER_CRITICAL(&g_slab_registry_lock);
+    if (!cache->registered) {
+        cache->next = g_slab_caches;
+        g_slab_caches = cache;
+        cache->registered = true;
+    }
+    portEXIT_CRITICAL(&g_slab_registry_lock);
+}
+
+/**
+ * @brief Allocate and carve a slab; runs outside the cache lock.
+ */
+static m_slab_t *m_slab_create(m_slab_cache_t *cache)
+{
+    m_slab_t *slab = pvPortMalloc(m_slab_footprint(cache));
+    if (slab == NULL) {
+        return NULL;
+    }
+
+    size_t stride = m_slab_stride(cache);
+    size_t capacity = m_slab_capacity(cache);
+    slab->cache = cache;
+    slab->next = NULL;
+    slab->prev = NULL;
+    slab->free_list = NULL;
+    slab->magic = M_SLAB_MAGIC;
+    slab->used = 0;
+    slab->capacity = (uint16_t)capacity;
+
+    uint8_t *cursor = (uint8_t *)slab + M_SLAB_HEADER_BYTES
+                      + (capacity - 1) * stride;
+    for (size_t i = 0; i < capacity; ++i) {
+        void *obj = cursor + M_SLAB_TAG_BYTES;
+        *m_slab_tag(obj) = (uintptr_t)slab | M_SLAB_TAG_FREE;
+        *(void **)obj = slab->free_list;
+        slab->free_list = obj;
+        cursor -= stride;
+    }
+    return slab;
+}
+
+static void m_slab_release_list(m_slab_t *slab)
+{
+    while (slab != NULL) {
+        m_slab_t *next = slab->next;
+        slab->magic = 0;
+        vPortFree(slab);
+        slab = next;
+    }
+}
+
+static void *m_slab_take_locked(m_slab_cache_t *cache)
+{
+    m_slab_t *slab = cache->partial;
+    if (slab == NULL) {
+        slab = cache->empty;
+        if (slab == NULL) {
+            return NULL;
+        }
+        m_slab_list_remove(&cache->empty, slab);
+        cache->empty_count--;
+        m_slab_list_push(&cache->partial, slab);
+    }
+
+    void *obj = slab->free_list;
+    slab->free_list = *(void **)obj;
+    slab->used++;
+    if (slab->used == slab->capacity) {
+        m_slab_list_remove(&cache->partial, slab);
+        m_slab_list_push(&cache->full, slab);
+    }
+    *m_slab_tag(obj) = (uintptr_t)slab;
+    cache->used_objects++;
+    return obj;
+}
+
+/**
+ * @brief Put a tagged-free object back on its slab.
+ *
+ * A slab that drains beyond the retained budget is unlinked and chained onto
+ * @p release so the caller can free it after dropping the lock.
+ */
+static void m_slab_put_locked(m_slab_cache_t *cache,
+                              m_slab_t *slab,
+                              void *obj,
+                              m_slab_t **release)
+{
+    if (slab->used == slab->capacity) {
+        m_slab_list_remove(&cache->full, slab);
+        m_slab_list_push(&cache->partial, slab);
+    }
+    *(void **)obj = slab->free_list;
+    slab->free_list = obj;
+    slab->used--;
+    cache->used_objects--;
+
+    if (slab->used > 0) {
+        return;
+    }
+
+    m_slab_list_remove(&cache->partial, slab);
+    if (cache->empty_count < M_SLAB_RETAIN_EMPTY) {
+        m_slab_list_push(&cache->empty, slab);
+        cache->empty_count++;
+        return;
+    }
+
+    cache->slab_count--;
+    cache->total_objects -= slab->capacity;
+    cache->release_count++;
+    slab->next = *release;
+    *release = slab;
+}
+
+static m_slab_t *m_slab_owner(m_slab_cache_t *cache, void *obj)
+{
+    uintptr_t tag = *m_slab_tag(obj);
+    m_slab_t *slab = (m_slab_t *)(tag & ~M_SLAB_TAG_FREE);
+    if (slab == NULL || slab->magic != M_SLAB_MAGIC || slab->cache != cache) {
+        ESP_LOGE(TAG, "cache %s: foreign or corrupted object %p", cache->name, obj);
+        m_arch_panic("slab object corrupted");
+        return NULL;
+    }
+    if (tag & M_SLAB_TAG_FREE) {
+        ESP_LOGE(TAG, "cache %s: double free of %p", cache->name, obj);
+        m_arch_panic("slab double free");
+        return NULL;
+    }
+    return slab;
+}
+
+#if M_SLAB_MAGAZINE_SIZE > 0
+/*
+ * Magazines are strictly per core. The fast paths mask interrupts on the
+ * local core, which also pins the task, so no lock is needed; the slow paths
+ * run inside the cache critical section, which masks them as well.
+ */
+static void *m_slab_magazine_pop(m_slab_cache_t *cache)
+{
+    void *obj = NULL;
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    m_slab_magazine_t *mag = &cache->magazines[xPortGetCoreID()];
+    if (mag->count > 0) {
+        obj = mag->objects[--mag->count];
+        mag->hits++;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+    return obj;
+}
+
+static bool m_slab_magazine_push(m_slab_cache_t *cache, void *obj)
+{
+    bool stored = false;
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    m_slab_magazine_t *mag = &cache->magazines[xPortGetCoreID()];
+    if (mag->count < M_SLAB_MAGAZINE_SIZE) {
+        mag->objects[mag->count++] = obj;
+        mag->stores++;
+        stored = true;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+    return stored;
+}
+
+static void m_slab_magazine_refill_locked(m_slab_cache_t *cache)
+{
+    m_slab_magazine_t *mag = &cache->magazines[xPortGetCoreID()];
+    while (mag->count < M_SLAB_MAGAZINE_SIZE / 2) {
+        void *obj = m_slab_take_locked(cache);
+        if (obj == NULL) {
+            break;
+        }
+        *m_slab_tag(obj) |= M_SLAB_TAG_FREE;
+        mag->objects[mag->count++] = obj;
+    }
+}
+
+static void m_slab_magazine_flush_locked(m_slab_cache_t *cache,
+                                         size_t keep,
+                                         m_slab_t **release)
+{
+    m_slab_magazine_t *mag = &cache->magazines[xPortGetCoreID()];
+    while (mag->count > keep) {
+        void *obj = mag->objects[--mag->count];
+        m_slab_t *slab = (m_slab_t *)(*m_slab_tag(obj) & ~M_SLAB_TAG_FREE);
+        m_slab_put_locked(cache, slab, obj, release);
+    }
+}
+#endif
+
+void m_slab_cache_init(m_slab_cache_t *cache,
+                       const char *name,
+                       size_t object_size)
+{
+    if (cache == NULL) {
+        return;
+    }
+    memset(cache, 0, sizeof(*cache));
+    cache->name = name;
+    cache->object_size = object_size;
+    cache->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+}
+
+void *m_slab_alloc(m_slab_cache_t *cache)
+{
+    if (cache == NULL || cache->object_size == 0) {
+        return NULL;
+    }
+
+#if M_SLAB_MAGAZINE_SIZE > 0
+    void *cached = m_slab_magazine_pop(cache);
+    if (cached != NULL) {
+        *m_slab_tag(cached) &= ~M_SLAB_TAG_FREE;
+        return cached;
+    }
+#endif
+
+    portENTER_CRITICAL(&cache->lock);
+    void *obj = m_slab_take_locked(cache);
+    if (obj != NULL) {
+        cache->alloc_count++;
+#if M_SLAB_MAGAZINE_SIZE > 0
+        m_slab_magazine_refill_locked(cache);
+#endif
+        portEXIT_CRITICAL(&cache->lock);
+        return obj;
+    }
+    portEXIT_CRITICAL(&cache->lock);
+
+    m_slab_t *slab = m_slab_create(cache);
+    if (slab == NULL) {
+        return NULL;
+    }
+    if (!cache->registered) {
+        m_slab_register(cache);
+    }
+
+    portENTER_CRITICAL(&cache->lock);
+    m_slab_list_push(&cache->partial, slab);
+    cache->slab_count++;
+    cache->total_objects += slab->capacity;
+    cache->grow_count++;
+    obj = m_slab_take_locked(cache);
+    cache->alloc_count++;
+    portEXIT_CRITICAL(&cache->lock);
+    return obj;
+}
+
+size_t m_slab_alloc_bulk(m_slab_cache_t *cache, void **objs, size_t count)
+{
+    if (cache == NULL || cache->object_size == 0 || objs == NULL) {
+        return 0;
+    }
+
+    size_t got = 0;
+#if M_SLAB_MAGAZINE_SIZE > 0
+    while (got < count) {
+        void *cached = m_slab_magazine_pop(cache);
+        if (cached == NULL) {
+            break;
+        }
+        *m_slab_tag(cached) &= ~M_SLAB_TAG_FREE;
+        objs[got++] = cached;
+    }
+#endif
+
+    while (got < count) {
+        portENTER_CRITICAL(&cache->lock);
+        while (got < count) {
+            void *obj = m_slab_take_locked(cache);
+            if (obj == NULL) {
+                break;
+            }
+            cache->alloc_count++;
+            objs[got++] = obj;
+        }
+        portEXIT_CRITICAL(&cache->lock);
+        if (got == count) {
+            break;
+        }
+
+        m_slab_t *slab = m_slab_create(cache);
+        if (slab == NULL) {
+            break;
+        }
+        if (!cache->registered) {
+            m_slab_register(cache);
+        }
+        portENTER_CRITICAL(&cache->lock);
+        m_slab_list_push(&cache->partial, slab);
+        cache->slab_count++;
+        cache->total_objects += slab->capacity;
+        cache->grow_count++;
+        portEXIT_CRITICAL(&cache->lock);
+    }
+    return got;
+}
+
+void *m_slab_zalloc(m_slab_cache_t *cache)
+{
+    void *obj = m_slab_alloc(cache);
+    if (obj != NULL) {
+        memset(obj, 0, cache->object_size);
+    }
+    return obj;
+}
+
+void m_slab_free(m_slab_cache_t *cache, void *obj)
+{
+    if (cache == NULL || obj == NULL) {
+        return;
+    }
+
+    m_slab_t *slab = m_slab_owner(cache, obj);
+    if (slab == NULL) {
+        return;
+    }
+    *m_slab_tag(obj) |= M_SLAB_TAG_FREE;
+
+#if M_SLAB_MAGAZINE_SIZE > 0
+    if (m_slab_magazine_push(cache, obj)) {
+        return;
+    }
+#endif
+
+    m_slab_t *release = NULL;
+    portENTER_CRITICAL(&cache->lock);
+    m_slab_put_locked(cache, slab, obj, &release);
+    cache->free_count++;
+#if M_SLAB_MAGAZINE_SIZE > 0
+    m_slab_magazine_flush_locked(cache, M_SLAB_MAGAZINE_SIZE / 2, &release);
+#endif
+    portEXIT_CRITICAL(&cache->lock);
+
+    m_slab_release_list(release);
+}
+
+size_t m_slab_cache_shrink(m_slab_cache_t *cache)
+{
+    if (cache == NULL) {
+        return 0;
+    }
+
+    m_slab_t *release = NULL;
+    size_t released = 0;
+    portENTER_CRITICAL(&cache->lock);
+#if M_SLAB_MAGAZINE_SIZE > 0
+    m_slab_magazine_flush_locked(cache, 0, &release);
+#endif
+    while (cache->empty != NULL) {
+        m_slab_t *slab = cache->empty;
+        m_slab_list_remove(&cache->empty, slab);
+        cache->empty_count--;
+        cache->slab_count--;
+        cache->total_objects -= slab->capacity;
+        cache->release_count++;
+        slab->next = release;
+        release = slab;
+    }
+    for (m_slab_t *slab = release; slab != NULL; slab = slab->next) {
+        released += m_slab_footprint(cache);
+    }
+    portEXIT_CRITICAL(&cache->lock);
+
+    m_slab_release_list(release);
+    return released;
+}
+
+void m_slab_cache_get_stats(m_slab_cache_t *cache, m_slab_cache_stats_t *out)
+{
+    if (cache == NULL || out == NULL) {
+        return;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->name = cache->name;
+    out->object_size = cache->object_size;
+    out->objects_per_slab = m_slab_capacity(cache);
+
+    portENTER_CRITICAL(&cache->lock);
+    out->slab_count = cache->slab_count;
+    out->empty_slabs = cache->empty_count;
+    out->total_objects = cache->total_objects;
+    out->active_objects = cache->used_objects;
+    out->alloc_count = cache->alloc_count;
+    out->free_count = cache->free_count;
+    out->grow_count = cache->grow_count;
+    out->release_count = cache->release_count;
+#if M_SLAB_MAGAZINE_SIZE > 0
+    for (size_t i = 0; i < portNUM_PROCESSORS; ++i) {
+        const m_slab_magazine_t *mag = &cache->magazines[i];
+        out->magazine_objects += mag->count;
+        out->magazine_hits += mag->hits;
+        out->alloc_count += mag->hits;
+        out->free_count += mag->stores;
+    }
+#endif
+    portEXIT_CRITICAL(&cache->lock);
+
+    out->active_objects -= out->magazine_objects;
+    out->footprint_bytes = out->slab_count * m_slab_footprint(cache);
+}
+
+void m_slab_cache_foreach(m_slab_cache_iter_fn cb, void *user_data)
+{
+    if (cb == NULL) {
+        return;
+    }
+
+    /* Registered caches are never unlinked, so the list can be walked
+     * without holding the registry lock once the head is read. */
+    portENTER_CRITICAL(&g_slab_registry_lock);
+    m_slab_cache_t *cache = g_slab_caches;
+    portEXIT_CRITICAL(&g_slab_registry_lock);
+
+    while (cache != NULL) {
+        m_slab_cache_stats_t stats;
+        m_slab_cache_get_stats(cache, &stats);
+        if (!cb(&stats, user_data)) {
+            break;
+        }
+        cache = cache->next;
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef MAGNOLIA_MEMORY_M_SLAB_H
+#define MAGNOLIA_MEMORY_M_SLAB_H
+
+#include "sdkconfig.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/portmacro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_MAGNOLIA_SLAB_MAGAZINE_SIZE
+#define CONFIG_MAGNOLIA_SLAB_MAGAZINE_SIZE 0
+#endif
+
+/* Objects cached per core in front of the slab lists; 0 disables magazines. */
+#define M_SLAB_MAGAZINE_SIZE CONFIG_MAGNOLIA_SLAB_MAGAZINE_SIZE
+
+typedef struct m_slab m_slab_t;
+
+/**
+ * @brief Per-core stack of free objects served without taking the cache lock.
+ */
+typedef struct {
+    size_t count;
+    size_t hits;
+    size_t stores;
+    void *objects[M_SLAB_MAGAZINE_SIZE > 0 ? M_SLAB_MAGAZINE_SIZE : 1];
+} m_slab_magazine_t;
+
+/**
+ * @brief Object cache handing out fixed-size kernel objects from slabs.
+ *
+ * Caches are normally defined statically with M_SLAB_CACHE_INITIALIZER so
+ * they are usable before any init code runs. The fields are private to
+ * m_slab.c; use m_slab_cache_get_stats() to inspect a cache.
+ */
+typedef struct m_slab_cache {
+    const char *name;
+    size_t object_size;
+    m_slab_t *partial;
+    m_slab_t *full;
+    m_slab_t *empty;
+    size_t empty_count;
+    size_t slab_count;
+    size_t total_objects;
+    size_t used_objects;
+    size_t alloc_count;
+    size_t free_count;
+    size_t grow_count;
+    size_t release_count;
+    struct m_slab_cache *next;
+    bool registered;
+    portMUX_TYPE lock;
+#if M_SLAB_MAGAZINE_SIZE > 0
+    m_slab_magazine_t magazines[portNUM_PROCESSORS];
+#endif
+} m_slab_cache_t;
+
+#define M_SLAB_CACHE_INITIALIZER(cache_name, type)                             \
+    {                                                                          \
+        .name = (cache_name),                                                  \
+        .object_size = sizeof(type),                                           \
+        .lock = portMUX_INITIALIZER_UNLOCKED,                                  \
+    }
+
+/**
+ * @brief Diagnostics snapshot of a single object cache.
+ */
+typedef struct {
+    const char *name;
+    size_t object_size;
+    size_t objects_per_slab;
+    size_t slab_count;
+    size_t empty_slabs;
+    size_t total_objects;
+    size_t active_objects;
+    size_t magazine_objects;
+    size_t magazine_hits;
+    size_t alloc_count;
+    size_t free_count;
+    size_t grow_count;
+    size_t release_count;
+    size_t footprint_bytes;
+} m_slab_cache_stats_t;
+
+typedef bool (*m_slab_cache_iter_fn)(const m_slab_cache_stats_t *stats,
+                                     void *user_data);
+
+/**
+ * @brief Initialize a cache at runtime (equivalent to the static initializer).
+ *
+ * Once a cache has allocated it is linked into the diagnostics registry and
+ * must stay alive for the lifetime of the system.
+ */
+void m_slab_cache_init(m_slab_cache_t *cache,
+                       const char *name,
+                       size_t object_size);
+
+/**
+ * @brief Allocate one object; the contents are uninitialized.
+ */
+void *m_slab_alloc(m_slab_cache_t *cache);
+
+/**
+ * @brief Allocate up to @p count uninitialized objects into @p objs.
+ *
+ * Drains the local magazine first and takes the rest under a single cache
+ * lock acquisition, growing the cache as needed.
+ *
+ * @return Number of objects allocated; less than @p count only when the
+ *         system heap is exhausted.
+ */
+size_t m_slab_alloc_bulk(m_slab_cache_t *cache, void **objs, size_t count);
+
+/**
+ * @brief Allocate one zero-filled object.
+ */
+void *m_slab_zalloc(m_slab_cache_t *cache);
+
+/**
+ * @brief Return an object to the cache it was allocated from.
+ *
+ * Passing a pointer that does not belong to @p cache, or freeing an object
+ * twice, is treated as kernel heap corruption.
+ */
+void m_slab_free(m_slab_cache_t *cache, void *obj);
+
+/**
+ * @brief Flush the calling core's magazine and release every empty slab.
+ *
+ * @return Number of bytes returned to the system heap.
+ */
+size_t m_slab_cache_shrink(m_slab_cache_t *cache);
+
+void m_slab_cache_get_stats(m_slab_cache_t *cache, m_slab_cache_stats_t *out);
+
+/**
+ * @brief Visit every cache that has allocated at least one slab.
+ */
+void m_slab_cache_foreach(m_slab_cache_iter_fn cb, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAGNOLIA_MEMORY_M_SLAB_H */
@@ -15,12 +15,26 @@
 #include "kernel/arch/m_arch.h"
 #include "kernel/core/job/m_job.h"
 #include "kernel/core/memory/m_alloc.h"
+#include "kernel/core/memory/m_slab.h"
+#include "kernel/core/timer/m_timer.h"
 
 #define REGION_ALLOC_BLOCK_SIZE                                              \
     ((CONFIG_MAGNOLIA_ALLOC_REGION_SIZE / 8) > 0                              \
          ? (CONFIG_MAGNOLIA_ALLOC_REGION_SIZE / 8)                            \
          : 64)
 #define REGION_ALLOCATIONS_LIMIT (CONFIG_MAGNOLIA_ALLOC_MAX_REGIONS_PER_JOB * 16)
+#define LARGE_ALLOC_BYTES (16 * 1024)
+#define RECLAIM_ALLOCATIONS 24
+#define ALLOC_BENCH_RESIDENT 64
+#define ALLOC_BENCH_BATCH 32
+#define ALLOC_BENCH_ROUNDS 64
+#define REALLOC_BENCH_LINES 32
+#define REALLOC_BENCH_STEPS 48
+#define SLAB_TEST_OBJECTS 96
+#define OWNERSHIP_BENCH_OBJECTS 256
+#define SLAB_BENCH_ROUNDS 256
+#define PROFILE_TEST_OBJECTS 32
+#define PROFILE_TEST_BYTES 40
 
 static const char *TAG = "alloc_tests";
 
@@ -159,7 +173,8 @@ static m_job_result_descriptor_t job_dropin_sequence(m_job_id_t job, void *arg)
     if (stats.used_bytes != 0) {
         return m_job_result_error("leaked bytes after frees", 0);
     }
-    if (stats.peak_bytes == 0 || stats.region_count == 0) {
+    if (stats.peak_bytes == 0
+        || (stats.region_count == 0 && stats.reclaimed_bytes == 0)) {
         return m_job_result_error("invalid peak/region stats", 0);
     }
     return m_job_result_success(NULL, 0);
@@ -269,6 +284,137 @@ static bool run_test_region_limits(void)
     return ok;
 }
 
+static m_job_result_descriptor_t job_large_alloc(m_job_id_t job, void *arg)
+{
+    (void)arg;
+    uint8_t *buffer = malloc(LARGE_ALLOC_BYTES);
+    if (buffer == NULL) {
+        return m_job_result_error("large malloc failed", 0);
+    }
+    for (size_t i = 0; i < LARGE_ALLOC_BYTES; ++i) {
+        buffer[i] = (uint8_t)(i * 7);
+    }
+
+    magnolia_alloc_job_stats_t stats = {0};
+    m_alloc_get_job_stats(job->ctx, &stats);
+    if (stats.large_count != 1 || stats.used_bytes < LARGE_ALLOC_BYTES
+        || stats.capacity_bytes < stats.used_bytes) {
+        free(buffer);
+        return m_job_result_error("large allocation not accounted", 0);
+    }
+
+    uint8_t *grown = realloc(buffer, LARGE_ALLOC_BYTES * 2);
+    if (grown == NULL) {
+        free(buffer);
+        return m_job_result_error("large realloc failed", 0);
+    }
+    for (size_t i = 0; i < LARGE_ALLOC_BYTES; ++i) {
+        if (grown[i] != (uint8_t)(i * 7)) {
+            free(grown);
+            return m_job_result_error("large realloc corrupted", 0);
+        }
+    }
+    free(grown);
+
+    m_alloc_get_job_stats(job->ctx, &stats);
+    if (stats.large_count != 0 || stats.large_bytes != 0 || stats.used_bytes != 0) {
+        return m_job_result_error("large allocation leaked", 0);
+    }
+    return m_job_result_success(NULL, 0);
+}
+
+static bool run_test_large_alloc(void)
+{
+    m_job_queue_t *queue = alloc_test_queue(1);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_handle_t *job = NULL;
+    bool ok = (m_job_queue_submit_with_handle(queue,
+                                              job_large_alloc,
+                                              NULL,
+                                              &job)
+               == M_JOB_OK);
+    if (ok) {
+        ok &= await_job_result(job, M_JOB_RESULT_SUCCESS);
+    } else if (job != NULL) {
+        await_job_result(job, M_JOB_RESULT_SUCCESS);
+        ok = false;
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static m_job_result_descriptor_t job_region_reclaim(m_job_id_t job, void *arg)
+{
+    (void)arg;
+    void *buffers[RECLAIM_ALLOCATIONS] = {0};
+    size_t allocated = 0;
+    for (; allocated < RECLAIM_ALLOCATIONS; ++allocated) {
+        buffers[allocated] = malloc(REGION_ALLOC_BLOCK_SIZE);
+        if (buffers[allocated] == NULL) {
+            break;
+        }
+    }
+
+    magnolia_alloc_job_stats_t stats = {0};
+    m_alloc_get_job_stats(job->ctx, &stats);
+    size_t grown_regions = stats.region_count;
+
+    for (size_t i = 0; i < allocated; ++i) {
+        free(buffers[i]);
+    }
+
+    m_alloc_get_job_stats(job->ctx, &stats);
+    if (stats.used_bytes != 0) {
+        return m_job_result_error("leaked bytes after frees", 0);
+    }
+    if (stats.region_count > CONFIG_MAGNOLIA_ALLOC_RETAIN_EMPTY_REGIONS) {
+        return m_job_result_error("drained regions not reclaimed", 0);
+    }
+    if (grown_regions > CONFIG_MAGNOLIA_ALLOC_RETAIN_EMPTY_REGIONS
+        && stats.reclaimed_bytes == 0) {
+        return m_job_result_error("reclaimed bytes not reported", 0);
+    }
+
+    m_alloc_trim(job->ctx);
+    m_alloc_get_job_stats(job->ctx, &stats);
+    if (stats.region_count != 0 || stats.capacity_bytes != 0) {
+        return m_job_result_error("trim left regions behind", 0);
+    }
+
+    void *ptr = malloc(32);
+    if (ptr == NULL) {
+        return m_job_result_error("alloc after trim failed", 0);
+    }
+    free(ptr);
+    return m_job_result_success(NULL, 0);
+}
+
+static bool run_test_region_reclaim(void)
+{
+    m_job_queue_t *queue = alloc_test_queue(1);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_handle_t *job = NULL;
+    bool ok = (m_job_queue_submit_with_handle(queue,
+                                              job_region_reclaim,
+                                              NULL,
+                                              &job)
+               == M_JOB_OK);
+    if (ok) {
+        ok &= await_job_result(job, M_JOB_RESULT_SUCCESS);
+    } else if (job != NULL) {
+        await_job_result(job, M_JOB_RESULT_SUCCESS);
+        ok = false;
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
 static m_job_result_descriptor_t job_double_free(m_job_id_t job, void *arg)
 {
     (void)arg;
@@ -581,12 +727,492 @@ static bool run_test_cross_job_free_cancel(void)
     return ok;
 }
 
+static size_t alloc_bench_size(size_t index)
+{
+    return 16 + ((index * 37) % 112);
+}
+
+/*
+ * Keep a resident population alive, punch holes into it to reach the requested
+ * fragmentation level and time batched alloc/free cycles on top of it.
+ */
+static bool alloc_bench_level(job_ctx_t *ctx, unsigned fragmentation_pct)
+{
+    void *resident[ALLOC_BENCH_RESIDENT] = {0};
+    void *batch[ALLOC_BENCH_BATCH] = {0};
+    bool ok = true;
+
+    for (size_t i = 0; i < ALLOC_BENCH_RESIDENT; ++i) {
+        resident[i] = m_job_alloc(ctx, alloc_bench_size(i) * 2);
+        if (resident[i] == NULL) {
+            ok = false;
+            break;
+        }
+    }
+    for (size_t i = 0; ok && i < ALLOC_BENCH_RESIDENT; ++i) {
+        if ((i % 4) < (fragmentation_pct / 25)) {
+            m_job_free(ctx, resident[i]);
+            resident[i] = NULL;
+        }
+    }
+
+    uint64_t alloc_us = 0;
+    uint64_t free_us = 0;
+    size_t ops = 0;
+    for (size_t round = 0; ok && round < ALLOC_BENCH_ROUNDS; ++round) {
+        m_timer_time_t start = m_timer_get_monotonic();
+        for (size_t i = 0; i < ALLOC_BENCH_BATCH; ++i) {
+            batch[i] = m_job_alloc(ctx, alloc_bench_size(round + i));
+        }
+        m_timer_time_t mid = m_timer_get_monotonic();
+        for (size_t i = 0; i < ALLOC_BENCH_BATCH; ++i) {
+            if (batch[i] == NULL) {
+                ok = false;
+                continue;
+            }
+            m_job_free(ctx, batch[i]);
+            batch[i] = NULL;
+        }
+        m_timer_time_t end = m_timer_get_monotonic();
+        alloc_us += mid - start;
+        free_us += end - mid;
+        ops += ALLOC_BENCH_BATCH;
+    }
+
+    for (size_t i = 0; i < ALLOC_BENCH_RESIDENT; ++i) {
+        if (resident[i] != NULL) {
+            m_job_free(ctx, resident[i]);
+        }
+    }
+
+    if (ok && ops > 0) {
+        ESP_LOGI(TAG,
+                 "alloc bench frag=%u%%: alloc %llu ns/op free %llu ns/op (%u ops)",
+                 fragmentation_pct,
+                 (unsigned long long)((alloc_us * 1000ULL) / ops),
+                 (unsigned long long)((free_us * 1000ULL) / ops),
+                 (unsigned)ops);
+    }
+    return ok;
+}
+
+static m_job_result_descriptor_t job_alloc_benchmark(m_job_id_t job, void *arg)
+{
+    (void)arg;
+    static const unsigned levels[] = {0, 25, 50, 75};
+    for (size_t i = 0; i < (sizeof(levels) / sizeof(levels[0])); ++i) {
+        if (!alloc_bench_level(job->ctx, levels[i])) {
+            return m_job_result_error("benchmark allocation failed", 0);
+        }
+    }
+#if CONFIG_MAGNOLIA_ALLOC_TRACE_LOCK_HOLD
+    magnolia_alloc_job_stats_t stats = {0};
+    m_alloc_get_job_stats(job->ctx, &stats);
+    ESP_LOGI(TAG,
+             "alloc bench heap lock: %u holds, max %u cycles, avg %u cycles",
+             (unsigned)stats.lock_hold_count,
+             (unsigned)stats.lock_hold_max_cycles,
+             stats.lock_hold_count
+                 ? (unsigned)(stats.lock_hold_total_cycles / stats.lock_hold_count)
+                 : 0U);
+#endif
+    return m_job_result_success(NULL, 0);
+}
+
+/*
+ * Mimic line-accumulating applets: a few buffers grow by a line at a time and
+ * are periodically shrunk back, interleaved with short-lived scratch blocks.
+ */
+static m_job_result_descriptor_t job_realloc_benchmark(m_job_id_t job, void *arg)
+{
+    (void)arg;
+    uint64_t elapsed_us = 0;
+    size_t ops = 0;
+    size_t in_place = 0;
+
+    for (size_t line = 0; line < REALLOC_BENCH_LINES; ++line) {
+        size_t size = 16;
+        uint8_t *buffer = m_job_alloc(job->ctx, size);
+        if (buffer == NULL) {
+            return m_job_result_error("benchmark allocation failed", 0);
+        }
+        buffer[0] = (uint8_t)line;
+
+        for (size_t step = 0; step < REALLOC_BENCH_STEPS; ++step) {
+            void *scratch = NULL;
+            if ((step % 8) == 0) {
+                scratch = m_job_alloc(job->ctx, 24);
+            }
+            size_t next_size = ((step % 16) == 15) ? size / 2 : size + 16 + (step % 3) * 16;
+
+            m_timer_time_t start = m_timer_get_monotonic();
+            uint8_t *resized = m_job_realloc(job->ctx, buffer, next_size);
+            elapsed_us += m_timer_get_monotonic() - start;
+            ++ops;
+
+            if (scratch != NULL) {
+                m_job_free(job->ctx, scratch);
+            }
+            if (resized == NULL) {
+                m_job_free(job->ctx, buffer);
+                return m_job_result_error("benchmark realloc failed", 0);
+            }
+            if (resized[0] != (uint8_t)line) {
+                m_job_free(job->ctx, resized);
+                return m_job_result_error("benchmark realloc corrupted", 0);
+            }
+            if (resized == buffer) {
+                ++in_place;
+            }
+            buffer = resized;
+            size = next_size;
+        }
+        m_job_free(job->ctx, buffer);
+    }
+
+    ESP_LOGI(TAG,
+             "realloc bench: %llu ns/op, %u/%u resized in place",
+             (unsigned long long)((elapsed_us * 1000ULL) / ops),
+             (unsigned)in_place,
+             (unsigned)ops);
+    return m_job_result_success(NULL, 0);
+}
+
+static bool run_test_realloc_benchmark(void)
+{
+    m_job_queue_t *queue = alloc_test_queue(1);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_handle_t *job = NULL;
+    bool ok = (m_job_queue_submit_with_handle(queue,
+                                              job_realloc_benchmark,
+                                              NULL,
+                                              &job)
+               == M_JOB_OK);
+    if (ok) {
+        ok &= await_job_result(job, M_JOB_RESULT_SUCCESS);
+    } else if (job != NULL) {
+        await_job_result(job, M_JOB_RESULT_SUCCESS);
+        ok = false;
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+static bool run_test_alloc_benchmark(void)
+{
+    m_job_queue_t *queue = alloc_test_queue(1);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_handle_t *job = NULL;
+    bool ok = (m_job_queue_submit_with_handle(queue,
+                                              job_alloc_benchmark,
+                                              NULL,
+                                              &job)
+               == M_JOB_OK);
+    if (ok) {
+        ok &= await_job_result(job, M_JOB_RESULT_SUCCESS);
+    } else if (job != NULL) {
+        await_job_result(job, M_JOB_RESULT_SUCCESS);
+        ok = false;
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+
+#if CONFIG_MAGNOLIA_ALLOC_WRAP_LIBC
+/*
+ * Free a few hundred small libc allocations spread over several regions plus
+ * a large object; every free goes through the wrapper ownership lookup.
+ */
+static m_job_result_descriptor_t job_ownership_check(m_job_id_t job, void *arg)
+{
+    (void)arg;
+    static void *objects[OWNERSHIP_BENCH_OBJECTS];
+    size_t count = 0;
+    for (; count < OWNERSHIP_BENCH_OBJECTS; ++count) {
+        objects[count] = malloc(24 + (count % 5) * 16);
+        if (objects[count] == NULL) {
+            break;
+        }
+    }
+    void *large = malloc(LARGE_ALLOC_BYTES);
+    if (count == 0 || large == NULL) {
+        for (size_t i = 0; i < count; ++i) {
+            free(objects[i]);
+        }
+        free(large);
+        return m_job_result_error("ownership allocation failed", 0);
+    }
+
+    m_timer_time_t start = m_timer_get_monotonic();
+    for (size_t i = 0; i < count; ++i) {
+        free(objects[i]);
+    }
+    free(large);
+    uint64_t elapsed_us = m_timer_get_monotonic() - start;
+
+    magnolia_alloc_job_stats_t stats = {0};
+    m_alloc_get_job_stats(job->ctx, &stats);
+    if (stats.used_bytes != 0 || stats.ownership_checks < count + 1) {
+        return m_job_result_error("ownership stats mismatch", 0);
+    }
+    ESP_LOGI(TAG,
+             "ownership check: %u frees, %llu ns/free, %u.%02u probes/check",
+             (unsigned)(count + 1),
+             (unsigned long long)((elapsed_us * 1000ULL) / (count + 1)),
+             (unsigned)(stats.ownership_probes / stats.ownership_checks),
+             (unsigned)(((stats.ownership_probes % stats.ownership_checks) * 100U)
+                        / stats.ownership_checks));
+    return m_job_result_success(NULL, 0);
+}
+
+static bool run_test_ownership_check(void)
+{
+    m_job_queue_t *queue = alloc_test_queue(1);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_handle_t *job = NULL;
+    bool ok = (m_job_queue_submit_with_handle(queue,
+                                              job_ownership_check,
+                                              NULL,
+                                              &job)
+               == M_JOB_OK);
+    if (ok) {
+        ok &= await_job_result(job, M_JOB_RESULT_SUCCESS);
+    } else if (job != NULL) {
+        await_job_result(job, M_JOB_RESULT_SUCCESS);
+        ok = false;
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+#endif
+
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+static size_t profile_live_sampled(const magnolia_alloc_profile_t *profile,
+                                   size_t *live_bytes)
+{
+    size_t live = 0;
+    *live_bytes = 0;
+    for (size_t i = 0; i < profile->site_count; ++i) {
+        live += profile->sites[i].live_objects;
+        *live_bytes += profile->sites[i].live_bytes;
+    }
+    return live;
+}
+
+static m_job_result_descriptor_t job_heap_profile(m_job_id_t job, void *arg)
+{
+    (void)arg;
+    magnolia_alloc_profile_t *profile = m_job_alloc(job->ctx, sizeof(*profile));
+    if (profile == NULL || !m_alloc_profile_get_job(job->ctx, profile)) {
+        m_job_free(job->ctx, profile);
+        return m_job_result_error("profile unavailable", 0);
+    }
+    size_t base_live = profile->live_objects;
+    size_t base_small = profile->histogram[2];
+    size_t base_bytes = 0;
+    size_t base_sampled = profile_live_sampled(profile, &base_bytes);
+
+    void *objects[PROFILE_TEST_OBJECTS];
+    for (size_t i = 0; i < PROFILE_TEST_OBJECTS; ++i) {
+        objects[i] = m_job_alloc(job->ctx, PROFILE_TEST_BYTES);
+        if (objects[i] == NULL) {
+            for (size_t j = 0; j < i; ++j) {
+                m_job_free(job->ctx, objects[j]);
+            }
+            m_job_free(job->ctx, profile);
+            return m_job_result_error("profile allocation failed", 0);
+        }
+    }
+
+    /* 40-byte requests land in the <=64 bucket. */
+    size_t live_bytes = 0;
+    bool ok = m_alloc_profile_get_job(job->ctx, profile);
+    if (ok) {
+        size_t sampled = profile_live_sampled(profile, &live_bytes) - base_sampled;
+        ok = profile->live_objects == base_live + PROFILE_TEST_OBJECTS
+             && profile->histogram[2] == base_small + PROFILE_TEST_OBJECTS
+             && sampled >= PROFILE_TEST_OBJECTS / profile->sample_rate
+             && live_bytes - base_bytes >= sampled * PROFILE_TEST_BYTES;
+    }
+
+    char *report = NULL;
+    if (ok) {
+        size_t length = m_alloc_profile_format(NULL, 0) + 64;
+        report = m_job_alloc(job->ctx, length);
+        ok = report != NULL && m_alloc_profile_format(report, length) > 0;
+    }
+    if (ok) {
+        ESP_LOGI(TAG, "heap profile:\n%s", report);
+    }
+    m_job_free(job->ctx, report);
+
+    for (size_t i = 0; i < PROFILE_TEST_OBJECTS; ++i) {
+        m_job_free(job->ctx, objects[i]);
+    }
+    if (ok) {
+        ok = m_alloc_profile_get_job(job->ctx, profile)
+             && profile->live_objects == base_live
+             && profile_live_sampled(profile, &live_bytes) == base_sampled
+             && live_bytes == base_bytes;
+    }
+    m_job_free(job->ctx, profile);
+    return ok ? m_job_result_success(NULL, 0)
+              : m_job_result_error("heap profile mismatch", 0);
+}
+
+static bool run_test_heap_profile(void)
+{
+    m_job_queue_t *queue = alloc_test_queue(1);
+    if (queue == NULL) {
+        return false;
+    }
+
+    m_job_handle_t *job = NULL;
+    bool ok = (m_job_queue_submit_with_handle(queue,
+                                              job_heap_profile,
+                                              NULL,
+                                              &job)
+               == M_JOB_OK);
+    if (ok) {
+        ok &= await_job_result(job, M_JOB_RESULT_SUCCESS);
+    } else if (job != NULL) {
+        await_job_result(job, M_JOB_RESULT_SUCCESS);
+        ok = false;
+    }
+    m_job_queue_destroy(queue);
+    return ok;
+}
+#endif
+
+typedef struct {
+    uint32_t words[24];
+} slab_test_object_t;
+
+static m_slab_cache_t g_slab_test_cache =
+        M_SLAB_CACHE_INITIALIZER("slab_test", slab_test_object_t);
+
+static bool run_test_slab_cache(void)
+{
+    slab_test_object_t *objects[SLAB_TEST_OBJECTS] = {0};
+    bool ok = true;
+
+    for (size_t i = 0; i < SLAB_TEST_OBJECTS; ++i) {
+        objects[i] = m_slab_zalloc(&g_slab_test_cache);
+        if (objects[i] == NULL || objects[i]->words[0] != 0) {
+            ok = false;
+            break;
+        }
+        objects[i]->words[0] = (uint32_t)i;
+        objects[i]->words[23] = (uint32_t)~i;
+    }
+
+    m_slab_cache_stats_t stats = {0};
+    m_slab_cache_get_stats(&g_slab_test_cache, &stats);
+    if (ok && stats.active_objects != SLAB_TEST_OBJECTS) {
+        ok = false;
+    }
+
+    for (size_t i = 0; i < SLAB_TEST_OBJECTS; ++i) {
+        if (objects[i] == NULL) {
+            continue;
+        }
+        if (objects[i]->words[0] != (uint32_t)i
+            || objects[i]->words[23] != (uint32_t)~i) {
+            ok = false;
+        }
+        m_slab_free(&g_slab_test_cache, objects[i]);
+    }
+
+    /* Objects parked in another core's magazine keep their slab alive, so
+     * only require that shrinking gave memory back. */
+    size_t slabs_before = stats.slab_count;
+    m_slab_cache_shrink(&g_slab_test_cache);
+    m_slab_cache_get_stats(&g_slab_test_cache, &stats);
+    if (stats.active_objects != 0 || stats.slab_count >= slabs_before) {
+        ok = false;
+    }
+    return ok;
+}
+
+static bool slab_log_cache(const m_slab_cache_stats_t *stats, void *user_data)
+{
+    (void)user_data;
+    ESP_LOGI(TAG,
+             "slab %s: size=%u active=%u/%u slabs=%u mag=%u hits=%u",
+             stats->name,
+             (unsigned)stats->object_size,
+             (unsigned)stats->active_objects,
+             (unsigned)stats->total_objects,
+             (unsigned)stats->slab_count,
+             (unsigned)stats->magazine_objects,
+             (unsigned)stats->magazine_hits);
+    return true;
+}
+
+/*
+ * Compare the object cache against the system heap for the alloc/free pattern
+ * of job submission: a short burst of objects that die in the same order.
+ */
+static bool run_test_slab_benchmark(void)
+{
+    slab_test_object_t *objects[8] = {0};
+    uint64_t slab_us = 0;
+    uint64_t heap_us = 0;
+    size_t ops = 0;
+
+    for (size_t round = 0; round < SLAB_BENCH_ROUNDS; ++round) {
+        m_timer_time_t start = m_timer_get_monotonic();
+        for (size_t i = 0; i < 8; ++i) {
+            objects[i] = m_slab_alloc(&g_slab_test_cache);
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            if (objects[i] == NULL) {
+                return false;
+            }
+            m_slab_free(&g_slab_test_cache, objects[i]);
+        }
+        m_timer_time_t mid = m_timer_get_monotonic();
+        for (size_t i = 0; i < 8; ++i) {
+            objects[i] = pvPortMalloc(sizeof(slab_test_object_t));
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            if (objects[i] == NULL) {
+                return false;
+            }
+            vPortFree(objects[i]);
+        }
+        m_timer_time_t end = m_timer_get_monotonic();
+        slab_us += mid - start;
+        heap_us += end - mid;
+        ops += 8;
+    }
+
+    ESP_LOGI(TAG,
+             "slab bench: slab %llu ns/pair heap %llu ns/pair (%u pairs)",
+             (unsigned long long)((slab_us * 1000ULL) / ops),
+             (unsigned long long)((heap_us * 1000ULL) / ops),
+             (unsigned)ops);
+    m_slab_cache_foreach(slab_log_cache, NULL);
+    return true;
+}
+
 void m_alloc_selftests_run(void)
 {
     bool overall = true;
     overall &= test_report("m_arch malloc basics", run_test_arch_malloc_basic());
     overall &= test_report("drop-in malloc/calloc/realloc", run_test_dropin_malloc_sequence());
     overall &= test_report("region limit enforcement", run_test_region_limits());
+    overall &= test_report("large allocation path", run_test_large_alloc());
+    overall &= test_report("region reclamation and trim", run_test_region_reclaim());
     overall &= test_report("double free detection", run_test_double_free_cancel());
     overall &= test_report("realloc after free detection",
                            run_test_realloc_after_free_cancel());
@@ -595,6 +1221,19 @@ void m_alloc_selftests_run(void)
                            run_test_parallel_job_isolation());
     overall &= test_report("cross job free rejection",
                            run_test_cross_job_free_cancel());
+    overall &= test_report("alloc/free microbenchmark",
+                           run_test_alloc_benchmark());
+    overall &= test_report("realloc microbenchmark",
+                           run_test_realloc_benchmark());
+#if CONFIG_MAGNOLIA_ALLOC_WRAP_LIBC
+    overall &= test_report("constant-time ownership check",
+                           run_test_ownership_check());
+#endif
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    overall &= test_report("heap profiler attribution", run_test_heap_profile());
+#endif
+    overall &= test_report("slab object cache", run_test_slab_cache());
+    overall &= test_report("slab microbenchmark", run_test_slab_benchmark());
     ESP_LOGI(TAG, "allocator self-tests %s",
              overall ? "PASSED" : "FAILED");
 }
@@ -0,0 +1,92 @@
+/**
+ * @file kernel/core/sched/m_sched_accounting.c
+ * @brief Per-task CPU and wait-time accounting.
+ * @details Implements the FreeRTOS trace hooks declared in m_sched_trace.h.
+ *          The hooks run inside the kernel with the scheduler lock held, so
+ *          they only touch task-local storage and plain counters.
+ */
+
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#include "kernel/core/sched/m_sched_core_internal.h"
+#include "kernel/core/sched/m_sched_trace.h"
+
+static int64_t g_slice_start_us[portNUM_PROCESSORS];
+static uint32_t g_wake_latency_hist[M_SCHED_LATENCY_BUCKETS];
+
+/**
+ * @brief Histogram bucket for a ready-to-running latency.
+ */
+static inline size_t m_sched_latency_bucket(uint64_t latency_us)
+{
+    size_t bucket = 0;
+    uint64_t bound = 16;
+    while (bucket + 1 < M_SCHED_LATENCY_BUCKETS && latency_us >= bound) {
+        bound <<= 2;
+        bucket++;
+    }
+    return bucket;
+}
+
+void IRAM_ATTR _m_sched_trace_switched_out(void)
+{
+    m_sched_task_metadata_t *meta =
+            _m_sched_metadata_of(xTaskGetCurrentTaskHandle());
+    if (meta == NULL) {
+        return;
+    }
+
+    int64_t start = g_slice_start_us[xPortGetCoreID()];
+    int64_t now = esp_timer_get_time();
+    if (start != 0 && now > start) {
+        meta->accounting.cpu_time_us += (uint64_t)(now - start);
+    }
+    meta->accounting.context_switches++;
+}
+
+void IRAM_ATTR _m_sched_trace_switched_in(void)
+{
+    int64_t now = esp_timer_get_time();
+    g_slice_start_us[xPortGetCoreID()] = now;
+
+    m_sched_task_metadata_t *meta =
+            _m_sched_metadata_of(xTaskGetCurrentTaskHandle());
+    if (meta == NULL || meta->ready_since_us == 0) {
+        return;
+    }
+
+    uint64_t latency = (now > meta->ready_since_us)
+                               ? (uint64_t)(now - meta->ready_since_us)
+                               : 0;
+    size_t bucket = m_sched_latency_bucket(latency);
+    meta->accounting.wake_latency_hist[bucket]++;
+    g_wake_latency_hist[bucket]++;
+    meta->ready_since_us = 0;
+}
+
+void IRAM_ATTR _m_sched_trace_ready(void *task)
+{
+    m_sched_task_metadata_t *meta = _m_sched_metadata_of((TaskHandle_t)task);
+    if (meta != NULL) {
+        meta->ready_since_us = esp_timer_get_time();
+    }
+}
+
+void _m_sched_account_wait(m_sched_task_metadata_t *meta,
+                           m_sched_wait_reason_t reason,
+                           uint64_t elapsed_us)
+{
+    if (meta == NULL || reason >= M_SCHED_WAIT_REASON_COUNT) {
+        return;
+    }
+    meta->accounting.wait_time_us[reason] += elapsed_us;
+}
+
+void _m_sched_wake_latency_copy(uint32_t out[M_SCHED_LATENCY_BUCKETS])
+{
+    /* Counters only grow; a torn copy is off by at most a few wakeups. */
+    for (size_t i = 0; i < M_SCHED_LATENCY_BUCKETS; ++i) {
+        out[i] = g_wake_latency_hist[i];
+    }
+}
@@ -12,9 +12,22 @@
 #include "kernel/core/sched/m_sched_core_internal.h"
 #include "kernel/core/sched/m_sched_worker.h"
 
+#if (configNUM_THREAD_LOCAL_STORAGE_POINTERS < 2)
+#error "Scheduler metadata lookup requires two thread-local storage pointers"
+#endif
+
+/*
+ * Ids are handed out sequentially, so id modulo the bucket count spreads
+ * live tasks evenly and every chain stays a handful of entries long.
+ */
+#define M_SCHED_REGISTRY_BUCKETS 32u
+
+_Static_assert((M_SCHED_REGISTRY_BUCKETS & (M_SCHED_REGISTRY_BUCKETS - 1u)) == 0,
+               "M_SCHED_REGISTRY_BUCKETS must be a power of two");
+
 static StaticSemaphore_t g_sched_registry_lock_storage;
 static SemaphoreHandle_t g_sched_registry_lock;
-static m_sched_task_metadata_t *g_task_registry_head;
+static m_sched_task_metadata_t *g_task_registry[M_SCHED_REGISTRY_BUCKETS];
 static m_sched_task_id_t g_next_task_id = 1;
 
 /**
@@ -40,24 +53,29 @@ void _m_sched_registry_unlock(void)
     }
 }
 
+/**
+ * @brief Head of the registry chain that holds @p id.
+ */
+static inline m_sched_task_metadata_t **m_sched_registry_bucket(
+        m_sched_task_id_t id)
+{
+    return &g_task_registry[id & (M_SCHED_REGISTRY_BUCKETS - 1u)];
+}
+
 m_sched_task_metadata_t *_m_sched_metadata_find_locked_by_id(
         m_sched_task_id_t id)
 {
-    m_sched_task_metadata_t *current = g_task_registry_head;
+    m_sched_task_metadata_t *current = *m_sched_registry_bucket(id);
     while (current != NULL && current->id != id) {
         current = current->next;
     }
     return current;
 }
 
-m_sched_task_metadata_t *_m_sched_metadata_find_locked_by_handle(
-        TaskHandle_t handle)
+m_sched_task_metadata_t *_m_sched_metadata_current(void)
 {
-    m_sched_task_metadata_t *current = g_task_registry_head;
-    while (current != NULL && current->handle != handle) {
-        current = current->next;
-    }
-    return current;
+    return (m_sched_task_metadata_t *)pvTaskGetThreadLocalStoragePointer(
+            NULL, M_SCHED_TLS_META_INDEX);
 }
 
 bool _m_sched_registry_iterate(_m_sched_registry_iter_cb callback,
@@ -67,49 +85,45 @@ bool _m_sched_registry_iterate(_m_sched_registry_iter_cb callback,
         return true;
     }
 
-    bool completed = true;
-    _m_sched_registry_lock();
-    m_sched_task_metadata_t *current = g_task_registry_head;
-    while (current != NULL) {
-        if (!callback(current, user_data)) {
-            completed = false;
-            break;
+    /* The lock is dropped between buckets so a long walk never holds off
+     * task creation for more than one chain. */
+    for (size_t bucket = 0; bucket < M_SCHED_REGISTRY_BUCKETS; ++bucket) {
+        _m_sched_registry_lock();
+        m_sched_task_metadata_t *current = g_task_registry[bucket];
+        while (current != NULL) {
+            if (!callback(current, user_data)) {
+                _m_sched_registry_unlock();
+                return false;
+            }
+            current = current->next;
         }
-        current = current->next;
+        _m_sched_registry_unlock();
     }
-    _m_sched_registry_unlock();
-    return completed;
+    return true;
 }
 
 /**
- * @brief Finalize metadata when a task leaves the registry.
+ * @brief Drop a task from the registry and release its metadata.
+ *
+ * Both the exiting task and m_sched_task_destroy() may get here for the same
+ * id; only the caller that still finds it in the registry frees it.
  */
-static void m_sched_metadata_finalize(m_sched_task_metadata_t *meta)
+static void m_sched_metadata_finalize(m_sched_task_id_t id)
 {
-    if (meta == NULL) {
-        return;
+    _m_sched_registry_lock();
+    m_sched_task_metadata_t **link = m_sched_registry_bucket(id);
+    while (*link != NULL && (*link)->id != id) {
+        link = &(*link)->next;
     }
 
-    _m_sched_registry_lock();
-    if (meta->finalized) {
+    m_sched_task_metadata_t *meta = *link;
+    if (meta == NULL) {
         _m_sched_registry_unlock();
         return;
     }
 
+    *link = meta->next;
     meta->finalized = true;
-
-    if (g_task_registry_head == meta) {
-        g_task_registry_head = meta->next;
-    } else {
-        m_sched_task_metadata_t *prev = g_task_registry_head;
-        while (prev != NULL && prev->next != meta) {
-            prev = prev->next;
-        }
-        if (prev != NULL) {
-            prev->next = meta->next;
-        }
-    }
-
     _m_sched_registry_unlock();
     vPortFree(meta);
 }
@@ -129,8 +143,9 @@ static bool m_sched_metadata_assign_id(m_sched_task_metadata_t *meta)
     if (g_next_task_id == M_SCHED_TASK_ID_INVALID) {
         g_next_task_id = 1;
     }
-    meta->next = g_task_registry_head;
-    g_task_registry_head = meta;
+    m_sched_task_metadata_t **bucket = m_sched_registry_bucket(meta->id);
+    meta->next = *bucket;
+    *bucket = meta;
     _m_sched_registry_unlock();
     return true;
 }
@@ -155,14 +170,16 @@ static void m_sched_task_wrapper(void *arg)
 
     m_sched_task_metadata_t *meta = entry->meta;
     meta->handle = xTaskGetCurrentTaskHandle();
-    meta->state = M_SCHED_STATE_RUNNING;
+    vTaskSetThreadLocalStoragePointer(NULL, M_SCHED_TLS_META_INDEX, meta);
+    _m_sched_metadata_set_state(meta, M_SCHED_STATE_RUNNING);
     _m_sched_worker_notify_start(meta);
 
     entry->entry(entry->arg);
 
     _m_sched_worker_notify_stop(meta);
-    meta->state = M_SCHED_STATE_TERMINATED;
-    m_sched_metadata_finalize(meta);
+    _m_sched_metadata_set_state(meta, M_SCHED_STATE_TERMINATED);
+    vTaskSetThreadLocalStoragePointer(NULL, M_SCHED_TLS_META_INDEX, NULL);
+    m_sched_metadata_finalize(meta->id);
     vPortFree(entry);
     vTaskDelete(NULL);
 }
@@ -209,8 +226,8 @@ m_sched_error_t m_sched_task_create(const m_sched_task_options_t *options,
     meta->creation_flags = options->creation_flags;
     meta->cpu_affinity = options->cpu_affinity;
     meta->user_data = options->user_data;
-    meta->state = M_SCHED_STATE_READY;
-    meta->wait_reason = M_SCHED_WAIT_REASON_NONE;
+    atomic_init(&meta->state, M_SCHED_STATE_READY);
+    atomic_init(&meta->wait_reason, M_SCHED_WAIT_REASON_NONE);
     meta->finalized = false;
 
     m_sched_internal_task_entry_t *entry =
@@ -232,15 +249,17 @@ m_sched_error_t m_sched_task_create(const m_sched_task_options_t *options,
     BaseType_t created = pdFAIL;
     TaskHandle_t created_handle = NULL;
 
-#if CONFIG_FREERTOS_SMP
-    bool use_affinity = (options->cpu_affinity >= 0);
+    /* Both the IDF dual-core kernel and upstream SMP honour core pinning. */
+#if CONFIG_FREERTOS_SMP || !CONFIG_FREERTOS_UNICORE
+    bool use_affinity = (options->cpu_affinity >= 0
+                         && options->cpu_affinity < portNUM_PROCESSORS);
 #else
     (void)options;
     bool use_affinity = false;
 #endif
 
     if (use_affinity) {
-#if CONFIG_FREERTOS_SMP
+#if CONFIG_FREERTOS_SMP || !CONFIG_FREERTOS_UNICORE
         created = xTaskCreatePinnedToCore(m_sched_task_wrapper,
                                           meta->name,
                                           stack_depth,
@@ -259,7 +278,7 @@ m_sched_error_t m_sched_task_create(const m_sched_task_options_t *options,
     }
 
     if (created != pdPASS) {
-        m_sched_metadata_finalize(meta);
+        m_sched_metadata_finalize(meta->id);
         vPortFree(entry);
         return M_SCHED_ERR_NO_MEMORY;
     }
@@ -285,15 +304,24 @@ m_sched_error_t m_sched_task_destroy(m_sched_task_id_t id)
     }
 
     handle = meta->handle;
-    meta->state = M_SCHED_STATE_TERMINATED;
-    meta->wait_reason = M_SCHED_WAIT_REASON_NONE;
+    _m_sched_metadata_set_state(meta, M_SCHED_STATE_TERMINATED);
+    _m_sched_metadata_set_wait_reason(meta, M_SCHED_WAIT_REASON_NONE);
     _m_sched_registry_unlock();
 
     if (handle != NULL) {
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+        /* A task parked in a high-resolution wait has its alarm linked into
+         * the timer wheel; take it out before the metadata goes away. */
+        if (handle != xTaskGetCurrentTaskHandle()) {
+            m_timer_queue_cancel_sync(&meta->wait_alarm.entry);
+        }
+#endif
+        /* Trace hooks may still see the task switch out once. */
+        vTaskSetThreadLocalStoragePointer(handle, M_SCHED_TLS_META_INDEX, NULL);
         vTaskDelete(handle);
     }
 
-    m_sched_metadata_finalize(meta);
+    m_sched_metadata_finalize(id);
     return M_SCHED_OK;
 }
 
@@ -313,8 +341,8 @@ m_sched_error_t m_sched_task_suspend(m_sched_task_id_t id)
         return M_SCHED_ERR_NOT_FOUND;
     }
     handle = meta->handle;
-    meta->state = M_SCHED_STATE_SUSPENDED;
-    meta->wait_reason = M_SCHED_WAIT_REASON_NONE;
+    _m_sched_metadata_set_state(meta, M_SCHED_STATE_SUSPENDED);
+    _m_sched_metadata_set_wait_reason(meta, M_SCHED_WAIT_REASON_NONE);
     _m_sched_registry_unlock();
 
     vTaskSuspend(handle);
@@ -337,8 +365,8 @@ m_sched_error_t m_sched_task_resume(m_sched_task_id_t id)
         return M_SCHED_ERR_NOT_FOUND;
     }
     handle = meta->handle;
-    meta->state = M_SCHED_STATE_READY;
-    meta->wait_reason = M_SCHED_WAIT_REASON_NONE;
+    _m_sched_metadata_set_state(meta, M_SCHED_STATE_READY);
+    _m_sched_metadata_set_wait_reason(meta, M_SCHED_WAIT_REASON_NONE);
     _m_sched_registry_unlock();
 
     vTaskResume(handle);
@@ -347,13 +375,9 @@ m_sched_error_t m_sched_task_resume(m_sched_task_id_t id)
 
 void m_sched_task_yield(void)
 {
-    TaskHandle_t self = xTaskGetCurrentTaskHandle();
-    _m_sched_registry_lock();
-    m_sched_task_metadata_t *meta =
-            _m_sched_metadata_find_locked_by_handle(self);
+    m_sched_task_metadata_t *meta = _m_sched_metadata_current();
     if (meta != NULL) {
-        meta->state = M_SCHED_STATE_READY;
+        _m_sched_metadata_set_state(meta, M_SCHED_STATE_READY);
     }
-    _m_sched_registry_unlock();
     taskYIELD();
 }
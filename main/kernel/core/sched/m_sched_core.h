@@ -9,19 +9,27 @@
 #ifndef MAGNOLIA_SCHED_M_SCHED_CORE_H
 #define MAGNOLIA_SCHED_M_SCHED_CORE_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "kernel/core/timer/m_timer_queue.h"
 
 #define M_SCHED_TASK_TAG_MAX_LEN 32
 #define M_SCHED_CPU_AFFINITY_ANY (-1)
 #define M_SCHED_TASK_ID_INVALID 0
 #define M_SCHED_TASK_FLAG_NONE 0u
 #define M_SCHED_TASK_FLAG_WORKER (1u << 0)
+#define M_SCHED_LATENCY_BUCKETS 8
+
+#ifndef CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+#define CONFIG_MAGNOLIA_SCHED_ACCOUNTING 0
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,6 +75,7 @@ typedef enum {
     M_SCHED_WAIT_REASON_JOB,
     M_SCHED_WAIT_REASON_SHM_READ,
     M_SCHED_WAIT_REASON_SHM_WRITE,
+    M_SCHED_WAIT_REASON_COUNT,
 } m_sched_wait_reason_t;
 
 /**
@@ -81,23 +90,61 @@ typedef enum {
     M_SCHED_WAIT_RESULT_ABORTED,
 } m_sched_wait_result_t;
 
+/**
+ * @brief CPU and blocking time charged to a task.
+ *
+ * Bucket @c i of @c wake_latency_hist counts wakeups that waited less than
+ * 16 << (2 * i) microseconds in the ready state before running; the last
+ * bucket also takes everything longer.
+ */
+typedef struct {
+    uint64_t cpu_time_us;
+    uint32_t context_switches;
+    uint64_t wait_time_us[M_SCHED_WAIT_REASON_COUNT];
+    uint32_t wake_latency_hist[M_SCHED_LATENCY_BUCKETS];
+} m_sched_task_accounting_t;
+
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+/**
+ * @brief One-shot alarm a high-resolution wait arms on the timer queue.
+ *
+ * Kept in the task's metadata so m_sched_task_destroy() can cancel it; a
+ * task killed mid-wait must not leave its entry linked into the wheel.
+ */
+typedef struct {
+    m_timer_queue_entry_t entry;
+    TaskHandle_t task;
+    atomic_bool done;
+} m_sched_wait_alarm_t;
+#endif
+
 typedef struct m_sched_task_metadata m_sched_task_metadata_t;
 
 /**
  * @brief Per-task metadata that is shared inside the scheduler registry.
+ *
+ * state and wait_reason are written by the task's own waits without the
+ * registry lock; read them with atomic_load_explicit().
  */
 struct m_sched_task_metadata {
     m_sched_task_id_t id;
     TaskHandle_t handle;
-    m_sched_task_state_t state;
-    m_sched_wait_reason_t wait_reason;
+    _Atomic m_sched_task_state_t state;
+    _Atomic m_sched_wait_reason_t wait_reason;
     uint32_t creation_flags;
     int cpu_affinity;
     char name[configMAX_TASK_NAME_LEN];
     char tag[M_SCHED_TASK_TAG_MAX_LEN];
     void *user_data;
     bool finalized;
-    m_sched_task_metadata_t *next;
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+    m_sched_wait_alarm_t wait_alarm;
+#endif
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+    m_sched_task_accounting_t accounting;
+    int64_t ready_since_us;
+#endif
+    m_sched_task_metadata_t *next; /* Registry bucket chain. */
 };
 
 /**
@@ -14,9 +14,14 @@
 extern "C" {
 #endif
 
+/* Slot 0 holds the job context (see jctx.c). */
+#define M_SCHED_TLS_META_INDEX 1
+
 /**
  * @brief Callback invoked for each task metadata entry under the registry lock.
  *
+ * The entry is only valid until the callback returns; copy what is needed.
+ *
  * @param meta Task metadata currently being visited.
  * @param user_data User-supplied pointer passed through.
  * @return true to continue iteration, false to stop early.
@@ -41,13 +46,71 @@ m_sched_task_metadata_t *_m_sched_metadata_find_locked_by_id(
         m_sched_task_id_t id);
 
 /**
- * @brief Find metadata by handle while the registry lock is held.
+ * @brief Metadata of the calling task, or NULL for tasks not created through
+ *        m_sched_task_create().
+ *
+ * Read from a thread-local storage slot; no lock is taken.
  */
-m_sched_task_metadata_t *_m_sched_metadata_find_locked_by_handle(
-        TaskHandle_t handle);
+m_sched_task_metadata_t *_m_sched_metadata_current(void);
+
+/**
+ * @brief Publish a task state without the registry lock.
+ */
+static inline void _m_sched_metadata_set_state(m_sched_task_metadata_t *meta,
+                                               m_sched_task_state_t state)
+{
+    atomic_store_explicit(&meta->state, state, memory_order_relaxed);
+}
 
 /**
- * @brief Iterate through the registry while holding the lock.
+ * @brief Publish a wait reason without the registry lock.
+ */
+static inline void _m_sched_metadata_set_wait_reason(
+        m_sched_task_metadata_t *meta, m_sched_wait_reason_t reason)
+{
+    atomic_store_explicit(&meta->wait_reason, reason, memory_order_relaxed);
+}
+
+/**
+ * @brief Metadata attached to @p task, or NULL for foreign tasks.
+ *
+ * Only reads the task's thread-local storage, so it is safe from the
+ * FreeRTOS trace hooks.
+ */
+static inline m_sched_task_metadata_t *_m_sched_metadata_of(TaskHandle_t task)
+{
+    return (m_sched_task_metadata_t *)pvTaskGetThreadLocalStoragePointer(
+            task, M_SCHED_TLS_META_INDEX);
+}
+
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+/**
+ * @brief Charge @p elapsed_us of blocking on @p reason to @p meta.
+ */
+void _m_sched_account_wait(m_sched_task_metadata_t *meta,
+                           m_sched_wait_reason_t reason,
+                           uint64_t elapsed_us);
+
+/**
+ * @brief Copy the system-wide wake-to-run latency histogram.
+ */
+void _m_sched_wake_latency_copy(uint32_t out[M_SCHED_LATENCY_BUCKETS]);
+#else
+static inline void _m_sched_account_wait(m_sched_task_metadata_t *meta,
+                                         m_sched_wait_reason_t reason,
+                                         uint64_t elapsed_us)
+{
+    (void)meta;
+    (void)reason;
+    (void)elapsed_us;
+}
+#endif
+
+/**
+ * @brief Iterate through the registry one bucket at a time.
+ *
+ * The lock is held while a bucket is visited and released between buckets,
+ * so tasks created or finalized during the walk may or may not be seen.
  *
  * @param callback Visitor invoked for each metadata entry.
  * @param user_data Data forwarded to every callback invocation.
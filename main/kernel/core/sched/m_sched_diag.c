@@ -19,6 +19,27 @@ typedef struct {
     size_t count;
 } m_sched_diag_snapshot_ctx_t;
 
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+/**
+ * @brief Wait reason with the largest accumulated blocking time.
+ */
+static m_sched_wait_reason_t m_sched_diag_top_wait_reason(
+        const m_sched_task_accounting_t *accounting)
+{
+    m_sched_wait_reason_t top = M_SCHED_WAIT_REASON_NONE;
+    uint64_t top_us = 0;
+    for (int reason = M_SCHED_WAIT_REASON_NONE + 1;
+         reason < M_SCHED_WAIT_REASON_COUNT;
+         ++reason) {
+        if (accounting->wait_time_us[reason] > top_us) {
+            top_us = accounting->wait_time_us[reason];
+            top = (m_sched_wait_reason_t)reason;
+        }
+    }
+    return top;
+}
+#endif
+
 /**
  * @brief Callback used by @c m_sched_task_snapshot to copy registry entries.
  */
@@ -38,10 +59,20 @@ static bool m_sched_diag_snapshot_cb(m_sched_task_metadata_t *meta,
     entry->id = meta->id;
     strncpy(entry->name, meta->name, configMAX_TASK_NAME_LEN);
     entry->name[configMAX_TASK_NAME_LEN - 1] = '\0';
-    entry->state = meta->state;
-    entry->wait_reason = meta->wait_reason;
+    entry->state = atomic_load_explicit(&meta->state, memory_order_relaxed);
+    entry->wait_reason = atomic_load_explicit(&meta->wait_reason,
+                                              memory_order_relaxed);
     strncpy(entry->tag, meta->tag, M_SCHED_TASK_TAG_MAX_LEN);
     entry->tag[M_SCHED_TASK_TAG_MAX_LEN - 1] = '\0';
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+    entry->cpu_time_us = meta->accounting.cpu_time_us;
+    entry->context_switches = meta->accounting.context_switches;
+    entry->top_wait_reason = m_sched_diag_top_wait_reason(&meta->accounting);
+#else
+    entry->cpu_time_us = 0;
+    entry->context_switches = 0;
+    entry->top_wait_reason = M_SCHED_WAIT_REASON_NONE;
+#endif
     ctx->count++;
     return ctx->count < ctx->capacity;
 }
@@ -103,3 +134,48 @@ bool m_sched_task_id_is_valid(m_sched_task_id_t id)
     _m_sched_registry_unlock();
     return found;
 }
+
+/**
+ * @brief Copy the accounting record of the task with the provided id.
+ */
+bool m_sched_task_accounting_get(m_sched_task_id_t id,
+                                 m_sched_task_accounting_t *out)
+{
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+    if (id == M_SCHED_TASK_ID_INVALID || out == NULL) {
+        return false;
+    }
+
+    _m_sched_registry_lock();
+    m_sched_task_metadata_t *meta = _m_sched_metadata_find_locked_by_id(id);
+    if (meta == NULL) {
+        _m_sched_registry_unlock();
+        return false;
+    }
+
+    *out = meta->accounting;
+    _m_sched_registry_unlock();
+    return true;
+#else
+    (void)id;
+    (void)out;
+    return false;
+#endif
+}
+
+/**
+ * @brief Copy the system-wide wake-to-run latency histogram.
+ */
+bool m_sched_wake_latency_histogram(uint32_t out[M_SCHED_LATENCY_BUCKETS])
+{
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+    if (out == NULL) {
+        return false;
+    }
+    _m_sched_wake_latency_copy(out);
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+}
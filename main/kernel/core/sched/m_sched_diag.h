@@ -16,6 +16,10 @@ extern "C" {
 
 /**
  * @brief Simplified metadata entry returned by diagnostics.
+ *
+ * The accounting fields stay zero unless CONFIG_MAGNOLIA_SCHED_ACCOUNTING is
+ * enabled. @c top_wait_reason is the reason the task has spent the most time
+ * blocked on, or M_SCHED_WAIT_REASON_NONE if it never blocked.
  */
 typedef struct {
     m_sched_task_id_t id;
@@ -23,11 +27,18 @@ typedef struct {
     m_sched_task_state_t state;
     m_sched_wait_reason_t wait_reason;
     char tag[M_SCHED_TASK_TAG_MAX_LEN];
+    uint64_t cpu_time_us;
+    uint32_t context_switches;
+    m_sched_wait_reason_t top_wait_reason;
 } m_sched_task_diag_entry_t;
 
 /**
  * @brief Copy up to @p capacity task metadata entries.
  *
+ * Entries are copied out bucket by bucket, so a snapshot never blocks task
+ * creation for longer than one registry bucket takes to copy. It is not an
+ * atomic view of the whole registry.
+ *
  * @param buffer Output buffer to populate.
  * @param capacity Maximum number of entries to fill.
  * @return Number of entries written.
@@ -53,6 +64,29 @@ bool m_sched_task_metadata_get(m_sched_task_id_t id,
  */
 bool m_sched_task_id_is_valid(m_sched_task_id_t id);
 
+/**
+ * @brief Copy the CPU and wait-time accounting of a single task.
+ *
+ * Counters are updated without the registry lock, so the copy may be a few
+ * microseconds stale.
+ *
+ * @param id Task identifier to look up.
+ * @param out Output buffer for the accounting record.
+ * @return true if the task was found and accounting is enabled.
+ */
+bool m_sched_task_accounting_get(m_sched_task_id_t id,
+                                 m_sched_task_accounting_t *out);
+
+/**
+ * @brief Copy the system-wide wake-to-run latency histogram.
+ *
+ * Uses the same buckets as m_sched_task_accounting_t::wake_latency_hist.
+ *
+ * @param out Output histogram.
+ * @return true if accounting is enabled.
+ */
+bool m_sched_wake_latency_histogram(uint32_t out[M_SCHED_LATENCY_BUCKETS]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,18 @@ m_sched_wait_result_t m_sched_sleep_ms(uint32_t milliseconds)
     return m_sched_wait_block(&context, &deadline);
 }
 
+/**
+ * @brief Sleep for the requested number of microseconds.
+ */
+m_sched_wait_result_t m_sched_sleep_us(uint64_t microseconds)
+{
+    m_sched_wait_context_t context = {0};
+    m_sched_wait_context_prepare_with_reason(&context,
+                                            M_SCHED_WAIT_REASON_DELAY);
+    m_timer_deadline_t deadline = m_timer_deadline_from_relative(microseconds);
+    return m_sched_wait_block(&context, &deadline);
+}
+
 /**
  * @brief Sleep until a monotonic deadline expires.
  */
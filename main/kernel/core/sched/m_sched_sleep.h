@@ -23,6 +23,17 @@ extern "C" {
  */
 m_sched_wait_result_t m_sched_sleep_ms(uint32_t milliseconds);
 
+/**
+ * @brief Sleep for the given number of microseconds.
+ *
+ * Short delays are served below tick granularity when
+ * CONFIG_MAGNOLIA_SCHED_WAIT_HIRES is enabled.
+ *
+ * @param microseconds Delay duration.
+ * @return Result of the underlying wait.
+ */
+m_sched_wait_result_t m_sched_sleep_us(uint64_t microseconds);
+
 /**
  * @brief Sleep until the provided Magnolia monotonic deadline.
  *
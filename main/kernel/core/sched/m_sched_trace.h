@@ -0,0 +1,45 @@
+/**
+ * @file kernel/core/sched/m_sched_trace.h
+ * @brief FreeRTOS trace hooks for scheduler accounting.
+ * @details Force-included into every C translation unit by the top-level
+ *          CMakeLists.txt so the trace macros are defined before FreeRTOS.h
+ *          supplies its empty defaults. Keep it free of FreeRTOS includes.
+ */
+
+#ifndef MAGNOLIA_SCHED_M_SCHED_TRACE_H
+#define MAGNOLIA_SCHED_M_SCHED_TRACE_H
+
+#include "sdkconfig.h"
+
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING && !defined(__ASSEMBLER__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Charge the outgoing task's time slice; runs inside the kernel.
+ */
+void _m_sched_trace_switched_out(void);
+
+/**
+ * @brief Start the incoming task's time slice; runs inside the kernel.
+ */
+void _m_sched_trace_switched_in(void);
+
+/**
+ * @brief Stamp the moment @p task became ready; runs inside the kernel.
+ */
+void _m_sched_trace_ready(void *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define traceTASK_SWITCHED_OUT() _m_sched_trace_switched_out()
+#define traceTASK_SWITCHED_IN() _m_sched_trace_switched_in()
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB) _m_sched_trace_ready(pxTCB)
+
+#endif /* CONFIG_MAGNOLIA_SCHED_ACCOUNTING */
+
+#endif /* MAGNOLIA_SCHED_M_SCHED_TRACE_H */
@@ -11,45 +11,288 @@
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 
+#include "kernel/core/timer/m_timer_diag.h"
+#include "kernel/core/timer/m_timer_queue.h"
+#include "kernel/core/timer/m_timer_service.h"
+
+#if CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY
+#define M_SCHED_WAIT_NOTIFY_INDEX CONFIG_MAGNOLIA_SCHED_WAIT_NOTIFY_INDEX
+#if (M_SCHED_WAIT_NOTIFY_INDEX >= configTASK_NOTIFICATION_ARRAY_ENTRIES)
+#error "MAGNOLIA_SCHED_WAIT_NOTIFY_INDEX needs a larger FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES"
+#endif
+#endif
+
+#ifndef CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+#define CONFIG_MAGNOLIA_SCHED_WAIT_HIRES 0
+#endif
+
+/**
+ * @brief Result reported when a wait ends without a wakeup.
+ */
+static m_sched_wait_result_t m_sched_wait_expired_result(
+        const m_sched_wait_context_t *ctx)
+{
+    return (ctx->reason == M_SCHED_WAIT_REASON_DELAY)
+                   ? M_SCHED_WAIT_RESULT_OK
+                   : M_SCHED_WAIT_RESULT_TIMEOUT;
+}
+
 /**
- * @brief Update a task's scheduler state under the registry lock.
+ * @brief Prepare a generic wait context for the current task.
  */
-static void m_sched_wait_update_state(m_sched_task_metadata_t *meta,
-                                      m_sched_task_state_t state)
+void m_sched_wait_context_prepare(m_sched_wait_context_t *ctx)
 {
-    if (meta == NULL) {
+    m_sched_wait_context_prepare_with_reason(ctx,
+                                             M_SCHED_WAIT_REASON_EVENT);
+}
+
+#if CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY
+
+/**
+ * @brief Prepare a wait context and record the blocking reason.
+ */
+void m_sched_wait_context_prepare_with_reason(
+        m_sched_wait_context_t *ctx, m_sched_wait_reason_t reason)
+{
+    if (ctx == NULL) {
         return;
     }
 
-    _m_sched_registry_lock();
-    meta->state = state;
-    _m_sched_registry_unlock();
+    ctx->initialized = true;
+    ctx->task = xTaskGetCurrentTaskHandle();
+    ctx->reason = reason;
+    ctx->result = M_SCHED_WAIT_RESULT_OK;
+    ctx->owner = _m_sched_metadata_current();
+    atomic_store_explicit(&ctx->state, M_SCHED_WAIT_CTX_ARMED,
+                          memory_order_release);
 }
 
 /**
- * @brief Update a task's wait reason under the registry lock.
+ * @brief Whether a waker has finished publishing its result.
  */
-static void m_sched_wait_update_wait_reason(
-        m_sched_task_metadata_t *meta, m_sched_wait_reason_t reason)
+static inline bool m_sched_wait_done(m_sched_wait_context_t *ctx)
 {
-    if (meta == NULL) {
-        return;
+    return atomic_load_explicit(&ctx->state, memory_order_acquire)
+           == M_SCHED_WAIT_CTX_DONE;
+}
+
+/**
+ * @brief Park on the reserved notification index until woken or a tick
+ *        timeout elapses.
+ *
+ * A context that was prepared but never blocked on can still be woken later
+ * and leave a stray notification behind. The waiter therefore only trusts
+ * its own state and goes back to sleep on a stray one.
+ */
+static void m_sched_wait_park_ticks(m_sched_wait_context_t *ctx,
+                                    const m_timer_deadline_t *deadline)
+{
+    for (;;) {
+        TickType_t ticks = m_timer_deadline_to_ticks(deadline);
+        uint32_t taken = ulTaskNotifyTakeIndexed(M_SCHED_WAIT_NOTIFY_INDEX,
+                                                 pdTRUE,
+                                                 ticks);
+        if (m_sched_wait_done(ctx) || taken == 0) {
+            return;
+        }
     }
+}
+
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+
+/**
+ * @brief Timer queue callback for a high-resolution wait.
+ */
+static void m_sched_wait_alarm_fire(m_timer_queue_entry_t *entry,
+                                    void *context)
+{
+    (void)entry;
+    m_sched_wait_alarm_t *alarm = context;
 
-    _m_sched_registry_lock();
-    meta->wait_reason = reason;
-    _m_sched_registry_unlock();
+    /* The waiter may unwind its stack as soon as done is set. */
+    TaskHandle_t task = alarm->task;
+    atomic_store_explicit(&alarm->done, true, memory_order_release);
+    xTaskNotifyGiveIndexed(task, M_SCHED_WAIT_NOTIFY_INDEX);
 }
 
 /**
- * @brief Prepare a generic wait context for the current task.
+ * @brief Busy-poll the context state until the deadline passes.
+ *
+ * Used for deadlines shorter than a context switch round trip through the
+ * timer service.
  */
-void m_sched_wait_context_prepare(m_sched_wait_context_t *ctx)
+static void m_sched_wait_spin(m_sched_wait_context_t *ctx,
+                              const m_timer_deadline_t *deadline)
 {
-    m_sched_wait_context_prepare_with_reason(ctx,
-                                             M_SCHED_WAIT_REASON_EVENT);
+    while (!m_sched_wait_done(ctx)
+           && m_timer_get_monotonic() < deadline->target) {
+    }
 }
 
+/**
+ * @brief Park on a notification delivered by a timer queue alarm.
+ *
+ * The alarm honours the deadline's slack, so it may share a dispatch with
+ * other entries. The tick timeout is only a fallback one tick past the end
+ * of the slack window in case the timer service stalls.
+ */
+static void m_sched_wait_park_hires(m_sched_wait_context_t *ctx,
+                                    const m_timer_deadline_t *deadline)
+{
+    /* Tasks outside the registry cannot be destroyed through it, so their
+     * alarm may live on the stack. The waiter does not return while the
+     * queue may still call into it. */
+    m_sched_wait_alarm_t local;
+    m_sched_wait_alarm_t *alarm =
+            (ctx->owner != NULL) ? &ctx->owner->wait_alarm : &local;
+    alarm->task = ctx->task;
+    atomic_init(&alarm->done, false);
+    m_timer_queue_arm(&alarm->entry,
+                      *deadline,
+                      deadline->slack_us,
+                      m_sched_wait_alarm_fire,
+                      alarm);
+
+    m_timer_deadline_t latest = *deadline;
+    latest.target += deadline->slack_us;
+    for (;;) {
+        TickType_t ticks = m_timer_deadline_to_ticks(&latest) + 1;
+        uint32_t taken = ulTaskNotifyTakeIndexed(M_SCHED_WAIT_NOTIFY_INDEX,
+                                                 pdTRUE,
+                                                 ticks);
+        if (m_sched_wait_done(ctx)
+            || atomic_load_explicit(&alarm->done, memory_order_acquire)
+            || taken == 0) {
+            break;
+        }
+    }
+
+    if (!m_timer_queue_cancel(&alarm->entry)) {
+        /* Already handed to the service; its notification follows done. */
+        while (!atomic_load_explicit(&alarm->done, memory_order_acquire)) {
+            ulTaskNotifyTakeIndexed(M_SCHED_WAIT_NOTIFY_INDEX, pdTRUE, 1);
+        }
+    }
+}
+
+#endif /* CONFIG_MAGNOLIA_SCHED_WAIT_HIRES */
+
+/**
+ * @brief Block until woken or the deadline expires.
+ *
+ * Finite deadlines close enough to be missed by a whole tick, and deadlines
+ * with slack that can be batched, are served by spinning or by a timer
+ * queue alarm; everything else sleeps in ticks.
+ */
+static m_sched_wait_result_t m_sched_wait_block_notify(
+        m_sched_wait_context_t *ctx, const m_timer_deadline_t *deadline)
+{
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+    if (deadline != NULL && !deadline->infinite) {
+        uint64_t remaining = m_timer_deadline_delta_us(deadline,
+                                                       m_timer_get_monotonic());
+        if (remaining <= CONFIG_MAGNOLIA_SCHED_WAIT_SPIN_US) {
+            m_sched_wait_spin(ctx, deadline);
+        } else if ((remaining < CONFIG_MAGNOLIA_SCHED_WAIT_HIRES_MAX_US
+                    || deadline->slack_us != 0)
+                   && m_timer_service_running()) {
+            m_sched_wait_park_hires(ctx, deadline);
+        } else {
+            m_sched_wait_park_ticks(ctx, deadline);
+        }
+    } else
+#endif
+    {
+        m_sched_wait_park_ticks(ctx, deadline);
+    }
+
+    /* Timed out, unless a waker claimed the context in the meantime. A
+     * waker still publishing its result notifies once it is DONE; one that
+     * already finished leaves its notification to a later wait. */
+    unsigned expected = M_SCHED_WAIT_CTX_ARMED;
+    if (!atomic_compare_exchange_strong_explicit(&ctx->state,
+                                                 &expected,
+                                                 M_SCHED_WAIT_CTX_DONE,
+                                                 memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        while (expected != M_SCHED_WAIT_CTX_DONE) {
+            ulTaskNotifyTakeIndexed(M_SCHED_WAIT_NOTIFY_INDEX,
+                                    pdTRUE,
+                                    portMAX_DELAY);
+            expected = atomic_load_explicit(&ctx->state, memory_order_acquire);
+        }
+        return ctx->result;
+    }
+    if (deadline != NULL && !deadline->infinite) {
+        m_timer_diag_record_wake(deadline->target, m_timer_get_monotonic());
+    }
+    ctx->result = m_sched_wait_expired_result(ctx);
+    return ctx->result;
+}
+
+/**
+ * @brief Block the current task on a wait context and optional deadline.
+ */
+m_sched_wait_result_t m_sched_wait_block(
+        m_sched_wait_context_t *ctx, const m_timer_deadline_t *deadline)
+{
+    if (ctx == NULL || !ctx->initialized) {
+        return M_SCHED_WAIT_RESULT_SHUTDOWN;
+    }
+
+    if (ctx->owner != NULL) {
+        _m_sched_metadata_set_wait_reason(ctx->owner, ctx->reason);
+        _m_sched_metadata_set_state(ctx->owner, M_SCHED_STATE_WAITING);
+    }
+
+    m_timer_time_t blocked_at =
+            CONFIG_MAGNOLIA_SCHED_ACCOUNTING ? m_timer_get_monotonic() : 0;
+    m_sched_wait_result_t result = m_sched_wait_block_notify(ctx, deadline);
+
+    if (ctx->owner != NULL) {
+        if (CONFIG_MAGNOLIA_SCHED_ACCOUNTING) {
+            _m_sched_account_wait(ctx->owner,
+                                  ctx->reason,
+                                  m_timer_get_monotonic() - blocked_at);
+        }
+        _m_sched_metadata_set_wait_reason(ctx->owner, M_SCHED_WAIT_REASON_NONE);
+        _m_sched_metadata_set_state(ctx->owner, M_SCHED_STATE_READY);
+    }
+    return result;
+}
+
+/**
+ * @brief Wake a task that is waiting on the provided context.
+ */
+void m_sched_wait_wake(m_sched_wait_context_t *ctx,
+                       m_sched_wait_result_t result)
+{
+    if (ctx == NULL || !ctx->initialized) {
+        return;
+    }
+
+    /* Only the waker that claims the context may publish a result; a losing
+     * one must not touch a waiter that timed out or re-armed. */
+    unsigned expected = M_SCHED_WAIT_CTX_ARMED;
+    if (!atomic_compare_exchange_strong_explicit(&ctx->state,
+                                                 &expected,
+                                                 M_SCHED_WAIT_CTX_CLAIMED,
+                                                 memory_order_acq_rel,
+                                                 memory_order_relaxed)) {
+        return;
+    }
+
+    /* The waiter may return as soon as the context is DONE, so read the
+     * task first. */
+    TaskHandle_t task = ctx->task;
+    ctx->result = result;
+    atomic_store_explicit(&ctx->state, M_SCHED_WAIT_CTX_DONE,
+                          memory_order_release);
+    xTaskNotifyGiveIndexed(task, M_SCHED_WAIT_NOTIFY_INDEX);
+}
+
+#else /* !CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY */
+
 /**
  * @brief Prepare a wait context and record the blocking reason.
  */
@@ -69,16 +312,7 @@ void m_sched_wait_context_prepare_with_reason(
     ctx->reason = reason;
     ctx->armed = true;
     ctx->result = M_SCHED_WAIT_RESULT_OK;
-    ctx->owner = NULL;
-
-    if (!ctx->initialized) {
-        return;
-    }
-
-    _m_sched_registry_lock();
-    ctx->owner =
-            _m_sched_metadata_find_locked_by_handle(ctx->task);
-    _m_sched_registry_unlock();
+    ctx->owner = ctx->initialized ? _m_sched_metadata_current() : NULL;
 }
 
 /**
@@ -92,31 +326,34 @@ m_sched_wait_result_t m_sched_wait_block(
     }
 
     if (ctx->owner != NULL) {
-        m_sched_wait_update_wait_reason(ctx->owner, ctx->reason);
-        m_sched_wait_update_state(ctx->owner, M_SCHED_STATE_WAITING);
+        _m_sched_metadata_set_wait_reason(ctx->owner, ctx->reason);
+        _m_sched_metadata_set_state(ctx->owner, M_SCHED_STATE_WAITING);
     }
 
-    m_timer_deadline_t infinite = {.infinite = true, .target = 0};
-    const m_timer_deadline_t *use_deadline =
-            deadline ? deadline : &infinite;
-
-    TickType_t ticks = m_timer_deadline_to_ticks(use_deadline);
+    m_timer_time_t blocked_at =
+            CONFIG_MAGNOLIA_SCHED_ACCOUNTING ? m_timer_get_monotonic() : 0;
+    TickType_t ticks = m_timer_deadline_to_ticks(deadline);
     BaseType_t taken = xSemaphoreTake(ctx->semaphore, ticks);
 
     ctx->armed = false;
     if (ctx->owner != NULL) {
-        m_sched_wait_update_wait_reason(ctx->owner,
-                                        M_SCHED_WAIT_REASON_NONE);
-        m_sched_wait_update_state(ctx->owner, M_SCHED_STATE_READY);
+        if (CONFIG_MAGNOLIA_SCHED_ACCOUNTING) {
+            _m_sched_account_wait(ctx->owner,
+                                  ctx->reason,
+                                  m_timer_get_monotonic() - blocked_at);
+        }
+        _m_sched_metadata_set_wait_reason(ctx->owner, M_SCHED_WAIT_REASON_NONE);
+        _m_sched_metadata_set_state(ctx->owner, M_SCHED_STATE_READY);
     }
 
     if (taken == pdTRUE) {
         return ctx->result;
     }
 
-    ctx->result = (ctx->reason == M_SCHED_WAIT_REASON_DELAY)
-                          ? M_SCHED_WAIT_RESULT_OK
-                          : M_SCHED_WAIT_RESULT_TIMEOUT;
+    if (deadline != NULL && !deadline->infinite) {
+        m_timer_diag_record_wake(deadline->target, m_timer_get_monotonic());
+    }
+    ctx->result = m_sched_wait_expired_result(ctx);
     return ctx->result;
 }
 
@@ -130,11 +367,13 @@ void m_sched_wait_wake(m_sched_wait_context_t *ctx,
         return;
     }
 
-    ctx->result = result;
     if (!ctx->armed) {
         return;
     }
 
     ctx->armed = false;
+    ctx->result = result;
     xSemaphoreGive(ctx->semaphore);
 }
+
+#endif /* CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY */
@@ -8,24 +8,52 @@
 #ifndef MAGNOLIA_SCHED_M_SCHED_WAIT_H
 #define MAGNOLIA_SCHED_M_SCHED_WAIT_H
 
+#include <stdatomic.h>
+
+#include "sdkconfig.h"
 #include "kernel/core/sched/m_sched_core.h"
 #include "kernel/core/timer/m_timer.h"
 
+#ifndef CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY
+#define CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY 0
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#if CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY
+/**
+ * @brief Claim states of a notification-backed wait context.
+ */
+enum {
+    M_SCHED_WAIT_CTX_DONE = 0,
+    M_SCHED_WAIT_CTX_ARMED,
+    M_SCHED_WAIT_CTX_CLAIMED,
+};
+#endif
+
 /**
  * @brief Context maintained while a Magnolia task is blocked.
+ *
+ * With CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY the waiter parks on its task's
+ * reserved notification index; whoever moves @c state off ARMED first, the
+ * waker or the timing-out waiter, decides the outcome. A waker claims the
+ * context, publishes its result, then marks it DONE; only then may the
+ * waiter read @c result.
  */
 typedef struct {
+#if CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY
+    atomic_uint state;
+#else
     SemaphoreHandle_t semaphore;
     StaticSemaphore_t storage;
+    bool armed;
+#endif
     TaskHandle_t task;
     m_sched_task_metadata_t *owner;
     m_sched_wait_reason_t reason;
     m_sched_wait_result_t result;
-    bool armed;
     bool initialized;
 } m_sched_wait_context_t;
 
@@ -2,6 +2,8 @@
 
 #ifdef CONFIG_MAGNOLIA_SCHED_SELFTESTS
 
+#include <string.h>
+
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -106,6 +108,88 @@ static bool run_test_sleep_timing(void)
     return (result == M_SCHED_WAIT_RESULT_OK) && ((after - before) >= 10000ULL);
 }
 
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+#define SCHED_HIRES_SLEEP_US 200ULL
+#define SCHED_HIRES_ROUNDS 20
+
+/*
+ * Sub-tick sleeps must neither return early nor round up to a whole tick.
+ */
+static bool run_test_hires_sleep(void)
+{
+    if (!m_timer_service_running()) {
+        return false;
+    }
+
+    /* Lateness is measured here: the diag counters are shared with every
+     * other timed wait in the system. */
+    bool ok = true;
+    uint64_t late_total = 0;
+    uint64_t late_max = 0;
+    for (size_t i = 0; i < SCHED_HIRES_ROUNDS && ok; ++i) {
+        m_timer_time_t before = m_timer_get_monotonic();
+        ok = (m_sched_sleep_us(SCHED_HIRES_SLEEP_US) == M_SCHED_WAIT_RESULT_OK);
+        m_timer_time_t elapsed = m_timer_get_monotonic() - before;
+        ok &= (elapsed >= SCHED_HIRES_SLEEP_US);
+        if (ok) {
+            uint64_t late = elapsed - SCHED_HIRES_SLEEP_US;
+            late_total += late;
+            if (late > late_max) {
+                late_max = late;
+            }
+        }
+    }
+
+    uint64_t late_avg = late_total / SCHED_HIRES_ROUNDS;
+    ESP_LOGI(TAG,
+             "hires sleep %llu us: late avg %llu us, max %llu us",
+             (unsigned long long)SCHED_HIRES_SLEEP_US,
+             (unsigned long long)late_avg,
+             (unsigned long long)late_max);
+    return ok && late_avg < m_timer_ticks_to_us(1);
+}
+
+static void sched_hires_sleeper(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        m_sched_sleep_us(15000);
+    }
+}
+
+/*
+ * A task killed while parked on a timer queue alarm must not leave the
+ * alarm linked into the wheel.
+ */
+static bool run_test_destroy_hires_sleeping(void)
+{
+    if (!m_timer_service_running()) {
+        return false;
+    }
+
+    size_t before = m_timer_queue_length();
+    m_sched_task_id_t id = M_SCHED_TASK_ID_INVALID;
+    m_sched_task_options_t opts = {
+        .name = "sched_hires",
+        .entry = sched_hires_sleeper,
+        .stack_depth = configMINIMAL_STACK_SIZE * 2,
+        .priority = (tskIDLE_PRIORITY + 1),
+        .cpu_affinity = M_SCHED_CPU_AFFINITY_ANY,
+    };
+    if (m_sched_task_create(&opts, &id) != M_SCHED_OK) {
+        return false;
+    }
+
+    m_sched_sleep_ms(5);
+    bool ok = (m_sched_task_destroy(id) == M_SCHED_OK);
+    ok &= (m_timer_queue_length() == before);
+
+    /* A stale alarm would fire into the dead task within this window. */
+    m_sched_sleep_ms(20);
+    return ok;
+}
+#endif
+
 static bool run_test_metadata_snapshot(void)
 {
     m_sched_task_id_t id = M_SCHED_TASK_ID_INVALID;
@@ -135,13 +219,289 @@ static bool run_test_metadata_snapshot(void)
     return ok;
 }
 
+static void sched_sleeping_worker(void *arg)
+{
+    (void)arg;
+    m_sched_sleep_ms(50);
+}
+
+static bool run_test_wait_state_tracking(void)
+{
+    m_sched_task_id_t id = M_SCHED_TASK_ID_INVALID;
+    m_sched_task_options_t opts = {
+        .name = "sched_state",
+        .entry = sched_sleeping_worker,
+        .argument = NULL,
+        .stack_depth = configMINIMAL_STACK_SIZE,
+        .priority = (tskIDLE_PRIORITY + 1),
+        .cpu_affinity = M_SCHED_CPU_AFFINITY_ANY,
+    };
+
+    if (m_sched_task_create(&opts, &id) != M_SCHED_OK) {
+        return false;
+    }
+
+    /* The worker publishes its own wait state through its TLS metadata. */
+    m_sched_sleep_ms(10);
+    m_sched_task_metadata_t snapshot = {0};
+    bool ok = m_sched_task_metadata_get(id, &snapshot);
+    ok &= (atomic_load(&snapshot.state) == M_SCHED_STATE_WAITING);
+    ok &= (atomic_load(&snapshot.wait_reason) == M_SCHED_WAIT_REASON_DELAY);
+    m_sched_sleep_ms(80);
+    ok &= !m_sched_task_id_is_valid(id);
+    return ok;
+}
+
+#define SCHED_REGISTRY_TASKS 6
+/* Bucket count of the registry index in m_sched_core.c. */
+#define SCHED_REGISTRY_BUCKETS 32u
+
+static bool sched_snapshot_contains(const m_sched_task_diag_entry_t *entries,
+                                    size_t count,
+                                    m_sched_task_id_t id)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool run_test_registry_index(void)
+{
+    static StaticSemaphore_t storage;
+    static m_sched_task_diag_entry_t entries[32];
+    SemaphoreHandle_t trigger = xSemaphoreCreateBinaryStatic(&storage);
+    if (trigger == NULL) {
+        return false;
+    }
+
+    m_sched_task_id_t ids[SCHED_REGISTRY_TASKS] = {0};
+    m_sched_task_options_t opts = {
+        .name = "sched_reg",
+        .entry = sched_blocking_worker,
+        .argument = trigger,
+        .stack_depth = configMINIMAL_STACK_SIZE,
+        .priority = (tskIDLE_PRIORITY + 1),
+        .cpu_affinity = M_SCHED_CPU_AFFINITY_ANY,
+    };
+
+    bool ok = true;
+    for (size_t i = 0; i < SCHED_REGISTRY_TASKS && ok; ++i) {
+        ok = (m_sched_task_create(&opts, &ids[i]) == M_SCHED_OK);
+    }
+
+    size_t count = m_sched_task_snapshot(entries, 32);
+    for (size_t i = 0; i < SCHED_REGISTRY_TASKS; ++i) {
+        if (ids[i] == M_SCHED_TASK_ID_INVALID) {
+            continue;
+        }
+        ok &= m_sched_task_id_is_valid(ids[i]);
+        ok &= sched_snapshot_contains(entries, count, ids[i]);
+    }
+
+    for (size_t i = 0; i < SCHED_REGISTRY_TASKS; ++i) {
+        if (ids[i] != M_SCHED_TASK_ID_INVALID) {
+            ok &= (m_sched_task_destroy(ids[i]) == M_SCHED_OK);
+            ok &= !m_sched_task_id_is_valid(ids[i]);
+        }
+    }
+
+    /* Sequential ids land in different buckets, so keep only tasks whose
+     * ids share the first one's bucket and drop the rest straight away. */
+    m_sched_task_id_t chain[3] = {0};
+    size_t chained = 0;
+    for (size_t attempt = 0;
+         attempt < 4 * SCHED_REGISTRY_BUCKETS && chained < 3 && ok;
+         ++attempt) {
+        m_sched_task_id_t id = M_SCHED_TASK_ID_INVALID;
+        ok = (m_sched_task_create(&opts, &id) == M_SCHED_OK);
+        if (!ok) {
+            break;
+        }
+        if (chained == 0
+            || (id % SCHED_REGISTRY_BUCKETS)
+                       == (chain[0] % SCHED_REGISTRY_BUCKETS)) {
+            chain[chained++] = id;
+        } else {
+            ok = (m_sched_task_destroy(id) == M_SCHED_OK);
+        }
+    }
+    ok &= (chained == 3);
+
+    /* Unlinking one entry must leave its neighbours reachable: first from
+     * the middle of the chain, then from its head. */
+    if (ok) {
+        ok &= (m_sched_task_destroy(chain[1]) == M_SCHED_OK);
+        ok &= !m_sched_task_id_is_valid(chain[1]);
+        ok &= m_sched_task_id_is_valid(chain[0]);
+        ok &= m_sched_task_id_is_valid(chain[2]);
+        chain[1] = M_SCHED_TASK_ID_INVALID;
+
+        ok &= (m_sched_task_destroy(chain[2]) == M_SCHED_OK);
+        ok &= m_sched_task_id_is_valid(chain[0]);
+        chain[2] = M_SCHED_TASK_ID_INVALID;
+    }
+    for (size_t i = 0; i < chained; ++i) {
+        if (chain[i] != M_SCHED_TASK_ID_INVALID) {
+            ok &= (m_sched_task_destroy(chain[i]) == M_SCHED_OK);
+        }
+    }
+    return ok;
+}
+
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+static void sched_busy_worker(void *arg)
+{
+    SemaphoreHandle_t done = arg;
+    m_timer_time_t until = m_timer_get_monotonic() + 5000ULL;
+    while (m_timer_get_monotonic() < until) {
+    }
+    m_sched_sleep_ms(10);
+    xSemaphoreGive(done);
+    m_sched_sleep_ms(50);
+}
+
+static bool run_test_accounting(void)
+{
+    static StaticSemaphore_t storage;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&storage);
+    if (done == NULL) {
+        return false;
+    }
+
+    m_sched_task_id_t id = M_SCHED_TASK_ID_INVALID;
+    m_sched_task_options_t opts = {
+        .name = "sched_acct",
+        .entry = sched_busy_worker,
+        .argument = done,
+        .stack_depth = configMINIMAL_STACK_SIZE * 2,
+        .priority = (tskIDLE_PRIORITY + 1),
+        .cpu_affinity = M_SCHED_CPU_AFFINITY_ANY,
+    };
+    if (m_sched_task_create(&opts, &id) != M_SCHED_OK) {
+        return false;
+    }
+    if (xSemaphoreTake(done, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        m_sched_task_destroy(id);
+        return false;
+    }
+
+    m_sched_task_accounting_t acct = {0};
+    bool ok = m_sched_task_accounting_get(id, &acct);
+    m_sched_task_destroy(id);
+
+    uint32_t wakeups = 0;
+    for (size_t i = 0; i < M_SCHED_LATENCY_BUCKETS; ++i) {
+        wakeups += acct.wake_latency_hist[i];
+    }
+    ok &= (acct.cpu_time_us >= 4000ULL);
+    ok &= (acct.context_switches > 0);
+    ok &= (acct.wait_time_us[M_SCHED_WAIT_REASON_DELAY] >= 5000ULL);
+    ok &= (wakeups > 0);
+    return ok;
+}
+#endif
+
+#define SCHED_PINGPONG_ROUNDS 1000
+
+typedef struct {
+    m_sched_wait_context_t ping;
+    m_sched_wait_context_t pong;
+    SemaphoreHandle_t ready;
+    volatile bool stop;
+} sched_pingpong_t;
+
+/*
+ * The responder re-arms its own context before answering, so every ping
+ * finds it armed and no wakeup is lost.
+ */
+static void sched_pingpong_responder(void *arg)
+{
+    sched_pingpong_t *pp = arg;
+    m_sched_wait_context_prepare(&pp->pong);
+    xSemaphoreGive(pp->ready);
+    for (;;) {
+        m_sched_wait_block(&pp->pong, NULL);
+        if (pp->stop) {
+            break;
+        }
+        m_sched_wait_context_prepare(&pp->pong);
+        m_sched_wait_wake(&pp->ping, M_SCHED_WAIT_RESULT_OK);
+    }
+    xSemaphoreGive(pp->ready);
+}
+
+static bool run_test_wait_pingpong(void)
+{
+    static StaticSemaphore_t storage;
+    static sched_pingpong_t pp;
+    memset(&pp, 0, sizeof(pp));
+    pp.ready = xSemaphoreCreateBinaryStatic(&storage);
+    if (pp.ready == NULL) {
+        return false;
+    }
+
+    m_sched_task_id_t id = M_SCHED_TASK_ID_INVALID;
+    m_sched_task_options_t opts = {
+        .name = "sched_pong",
+        .entry = sched_pingpong_responder,
+        .argument = &pp,
+        .stack_depth = configMINIMAL_STACK_SIZE * 2,
+        .priority = uxTaskPriorityGet(NULL),
+        .cpu_affinity = M_SCHED_CPU_AFFINITY_ANY,
+    };
+    if (m_sched_task_create(&opts, &id) != M_SCHED_OK) {
+        return false;
+    }
+    if (xSemaphoreTake(pp.ready, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        m_sched_task_destroy(id);
+        return false;
+    }
+
+    bool ok = true;
+    size_t rounds = 0;
+    m_timer_time_t start = m_timer_get_monotonic();
+    for (; rounds < SCHED_PINGPONG_ROUNDS && ok; ++rounds) {
+        m_timer_deadline_t deadline = m_timer_deadline_from_relative(1000000ULL);
+        m_sched_wait_context_prepare(&pp.ping);
+        m_sched_wait_wake(&pp.pong, M_SCHED_WAIT_RESULT_OK);
+        ok = (m_sched_wait_block(&pp.ping, &deadline) == M_SCHED_WAIT_RESULT_OK);
+    }
+    m_timer_time_t elapsed = m_timer_get_monotonic() - start;
+
+    pp.stop = true;
+    m_sched_wait_wake(&pp.pong, M_SCHED_WAIT_RESULT_OK);
+    ok &= (xSemaphoreTake(pp.ready, pdMS_TO_TICKS(1000)) == pdTRUE);
+
+    ESP_LOGI(TAG,
+             "wait ping-pong (%s): %u round trips, %llu us each",
+             CONFIG_MAGNOLIA_SCHED_WAIT_TASK_NOTIFY ? "notify" : "semaphore",
+             (unsigned)rounds,
+             (unsigned long long)(rounds ? elapsed / rounds : 0));
+    return ok;
+}
+
 void m_sched_selftests_run(void)
 {
     bool overall = true;
     overall &= test_report("task create/destroy", run_test_create_destroy());
     overall &= test_report("destroy while waiting", run_test_destroy_waiting());
     overall &= test_report("sleep timing", run_test_sleep_timing());
+#if CONFIG_MAGNOLIA_SCHED_WAIT_HIRES
+    overall &= test_report("hires sleep", run_test_hires_sleep());
+    overall &= test_report("destroy while hires sleeping",
+                           run_test_destroy_hires_sleeping());
+#endif
     overall &= test_report("metadata snapshot", run_test_metadata_snapshot());
+    overall &= test_report("wait state tracking",
+                           run_test_wait_state_tracking());
+    overall &= test_report("registry index", run_test_registry_index());
+#if CONFIG_MAGNOLIA_SCHED_ACCOUNTING
+    overall &= test_report("cpu accounting", run_test_accounting());
+#endif
+    overall &= test_report("wait ping-pong benchmark", run_test_wait_pingpong());
     ESP_LOGI(TAG, "scheduler self-tests %s",
              overall ? "PASSED" : "FAILED");
 }
@@ -1,8 +1,8 @@
 /**
  * @file kernel/core/timer/m_timer.h
  * @brief Magnolia timer public interface.
- * @details Aggregates the core, deadline, queue, and diagnostics headers so
- *          higher layers can include a single API surface.
+ * @details Aggregates the core, deadline, queue, service, and diagnostics
+ *          headers so higher layers can include a single API surface.
  */
 
 #ifndef MAGNOLIA_TIMER_M_TIMER_H
@@ -11,6 +11,7 @@
 #include "kernel/core/timer/m_timer_core.h"
 #include "kernel/core/timer/m_timer_deadline.h"
 #include "kernel/core/timer/m_timer_queue.h"
+#include "kernel/core/timer/m_timer_service.h"
 #include "kernel/core/timer/m_timer_diag.h"
 
 #endif /* MAGNOLIA_TIMER_M_TIMER_H */
@@ -27,10 +27,15 @@ typedef uint64_t m_timer_time_t;
 
 /**
  * @brief Deadline descriptor used across Magnolia.
+ *
+ * @p slack_us is how late the deadline may be honoured. Timer queue entries
+ * whose windows overlap are dispatched together, so giving periodic waits
+ * some slack lets them share one wakeup.
  */
 typedef struct {
     m_timer_time_t target;
     bool infinite;
+    uint32_t slack_us;
 } m_timer_deadline_t;
 
 /**
@@ -7,7 +7,20 @@
 
 #include "kernel/core/timer/m_timer_deadline.h"
 
+#include "sdkconfig.h"
+
+#ifndef CONFIG_MAGNOLIA_TIMER_DEFAULT_SLACK_US
+#define CONFIG_MAGNOLIA_TIMER_DEFAULT_SLACK_US 0
+#endif
+
 m_timer_deadline_t m_timer_deadline_from_relative(uint64_t delta_us)
+{
+    return m_timer_deadline_from_relative_slack(
+            delta_us, CONFIG_MAGNOLIA_TIMER_DEFAULT_SLACK_US);
+}
+
+m_timer_deadline_t m_timer_deadline_from_relative_slack(uint64_t delta_us,
+                                                        uint32_t slack_us)
 {
     if (delta_us == M_TIMER_TIMEOUT_FOREVER) {
         return (m_timer_deadline_t){.target = 0, .infinite = true};
@@ -16,6 +29,7 @@ m_timer_deadline_t m_timer_deadline_from_relative(uint64_t delta_us)
     return (m_timer_deadline_t){
         .target = m_timer_get_monotonic() + delta_us,
         .infinite = false,
+        .slack_us = slack_us,
     };
 }
 
@@ -26,6 +26,17 @@ extern "C" {
  */
 m_timer_deadline_t m_timer_deadline_from_relative(uint64_t delta_us);
 
+/**
+ * @brief Build a deadline relative to now that may fire up to
+ *        @p slack_us late.
+ *
+ * @param delta_us Relative delay in microseconds.
+ * @param slack_us Tolerated lateness in microseconds.
+ * @return Epoch deadline.
+ */
+m_timer_deadline_t m_timer_deadline_from_relative_slack(uint64_t delta_us,
+                                                        uint32_t slack_us);
+
 /**
  * @brief Convert a deadline to FreeRTOS ticks.
  *
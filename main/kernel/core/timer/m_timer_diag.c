@@ -4,9 +4,19 @@
  * @details Collects queue and deadline data for tracing and testing helpers.
  */
 
+#include "freertos/FreeRTOS.h"
+
 #include "kernel/core/timer/m_timer_diag.h"
 #include "kernel/core/timer/m_timer_queue.h"
 
+static portMUX_TYPE g_timer_diag_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t g_timer_wake_samples;
+static uint64_t g_timer_wake_last_us;
+static uint64_t g_timer_wake_max_us;
+static uint64_t g_timer_wake_total_us;
+static uint32_t g_timer_dispatch_batches;
+static uint32_t g_timer_wakeups_saved;
+
 /**
  * @brief Populate a diagnostics snapshot.
  */
@@ -25,4 +35,61 @@ void m_timer_diag_snapshot(m_timer_diag_report_t *report)
     } else {
         report->next_delta_us = 0;
     }
+
+    portENTER_CRITICAL(&g_timer_diag_lock);
+    report->wake_samples = g_timer_wake_samples;
+    report->wake_jitter_last_us = g_timer_wake_last_us;
+    report->wake_jitter_max_us = g_timer_wake_max_us;
+    report->wake_jitter_avg_us =
+            g_timer_wake_samples ? g_timer_wake_total_us / g_timer_wake_samples
+                                 : 0;
+    report->dispatch_batches = g_timer_dispatch_batches;
+    report->wakeups_saved = g_timer_wakeups_saved;
+    portEXIT_CRITICAL(&g_timer_diag_lock);
+}
+
+/**
+ * @brief Fold one timed wake into the jitter statistics.
+ */
+void m_timer_diag_record_wake(m_timer_time_t target, m_timer_time_t woke)
+{
+    uint64_t late = (woke > target) ? (uint64_t)(woke - target) : 0;
+
+    portENTER_CRITICAL(&g_timer_diag_lock);
+    if (g_timer_wake_samples == UINT32_MAX) {
+        /* Halve the history rather than let the average wrap. */
+        g_timer_wake_samples >>= 1;
+        g_timer_wake_total_us >>= 1;
+    }
+    g_timer_wake_samples++;
+    g_timer_wake_total_us += late;
+    g_timer_wake_last_us = late;
+    if (late > g_timer_wake_max_us) {
+        g_timer_wake_max_us = late;
+    }
+    portEXIT_CRITICAL(&g_timer_diag_lock);
+}
+
+/**
+ * @brief Count one dispatch batch and the wakeups it absorbed.
+ */
+void m_timer_diag_record_batch(size_t entries)
+{
+    portENTER_CRITICAL(&g_timer_diag_lock);
+    g_timer_dispatch_batches++;
+    g_timer_wakeups_saved += (uint32_t)(entries - 1);
+    portEXIT_CRITICAL(&g_timer_diag_lock);
+}
+
+/**
+ * @brief Reset the jitter statistics.
+ */
+void m_timer_diag_reset_wake(void)
+{
+    portENTER_CRITICAL(&g_timer_diag_lock);
+    g_timer_wake_samples = 0;
+    g_timer_wake_last_us = 0;
+    g_timer_wake_max_us = 0;
+    g_timer_wake_total_us = 0;
+    portEXIT_CRITICAL(&g_timer_diag_lock);
 }
@@ -1,8 +1,8 @@
 /**
  * @file kernel/core/timer/m_timer_diag.h
  * @brief Timer diagnostics helpers.
- * @details Reports current time, pending deadlines, and queue depth for tracing
- *          and debugging.
+ * @details Reports current time, pending deadlines, queue depth, dispatch
+ *          coalescing, and timed wait wake jitter for tracing and debugging.
  */
 
 #ifndef MAGNOLIA_TIMER_M_TIMER_DIAG_H
@@ -26,6 +26,12 @@ typedef struct {
     bool has_next;
     m_timer_deadline_t next_deadline;
     uint64_t next_delta_us;
+    uint32_t wake_samples;       /**< Timed waits that ran to their deadline. */
+    uint64_t wake_jitter_last_us; /**< Lateness of the most recent one. */
+    uint64_t wake_jitter_max_us;
+    uint64_t wake_jitter_avg_us;
+    uint32_t dispatch_batches;   /**< Queue dispatches that fired entries. */
+    uint32_t wakeups_saved;      /**< Entries that shared another's batch. */
 } m_timer_diag_report_t;
 
 /**
@@ -35,6 +41,28 @@ typedef struct {
  */
 void m_timer_diag_snapshot(m_timer_diag_report_t *report);
 
+/**
+ * @brief Record how late a timed wait woke relative to its deadline.
+ *
+ * @param target Deadline the waiter asked for.
+ * @param woke Monotonic time the waiter observed after waking.
+ */
+void m_timer_diag_record_wake(m_timer_time_t target, m_timer_time_t woke);
+
+/**
+ * @brief Record one queue dispatch that fired @p entries callbacks.
+ *
+ * Every entry past the first would otherwise have needed its own wakeup.
+ *
+ * @param entries Number of callbacks fired together.
+ */
+void m_timer_diag_record_batch(size_t entries);
+
+/**
+ * @brief Clear the wake jitter statistics.
+ */
+void m_timer_diag_reset_wake(void);
+
 #ifdef __cplusplus
 }
 #endif
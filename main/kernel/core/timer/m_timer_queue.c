@@ -1,25 +1,64 @@
 /**
  * @file kernel/core/timer/m_timer_queue.c
  * @brief Magnolia timer event queue implementation.
- * @details Maintains an ordered list of timeouts, supports cancellation,
- *          and dispatches callbacks from a deterministic loop.
+ * @details Keeps timeouts in a hierarchical timing wheel so scheduling and
+ *          cancellation are O(1), and dispatches callbacks from a
+ *          deterministic loop.
  */
 
 #include "kernel/core/timer/m_timer_queue.h"
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "kernel/core/memory/m_slab.h"
+#include "kernel/core/timer/m_timer_diag.h"
+#include "kernel/core/timer/m_timer_service.h"
+
+#ifndef CONFIG_MAGNOLIA_TIMER_WHEEL_RESOLUTION_US
+#define CONFIG_MAGNOLIA_TIMER_WHEEL_RESOLUTION_US 1000
+#endif
+
+/*
+ * Four levels of 64 slots. Level l slots are 64^l wheel ticks wide, so with
+ * the default 1 ms resolution the wheel spans about 4.6 hours. Later
+ * deadlines wait on the overflow list and infinite ones on their own list.
+ */
+#define M_TIMER_WHEEL_RESOLUTION_US \
+    ((uint64_t)CONFIG_MAGNOLIA_TIMER_WHEEL_RESOLUTION_US)
+#define M_TIMER_WHEEL_BITS 6u
+#define M_TIMER_WHEEL_SLOTS (1u << M_TIMER_WHEEL_BITS)
+#define M_TIMER_WHEEL_MASK (M_TIMER_WHEEL_SLOTS - 1u)
+#define M_TIMER_WHEEL_LEVELS 4u
+#define M_TIMER_WHEEL_OVERFLOW M_TIMER_WHEEL_LEVELS
+#define M_TIMER_WHEEL_INFINITE (M_TIMER_WHEEL_LEVELS + 1u)
+
+typedef uint64_t m_timer_wheel_tick_t;
 
 static StaticSemaphore_t g_timer_queue_lock_storage;
 static SemaphoreHandle_t g_timer_queue_lock;
-static m_timer_queue_entry_t *g_timer_queue_head;
 
-struct m_timer_queue_entry {
-    m_timer_deadline_t deadline;
-    m_timer_queue_callback_t callback;
-    void *context;
-    m_timer_queue_entry_t *next;
-};
+static m_timer_queue_entry_t
+        *g_timer_wheel[M_TIMER_WHEEL_LEVELS][M_TIMER_WHEEL_SLOTS];
+static m_timer_queue_entry_t *g_timer_overflow;
+static m_timer_queue_entry_t *g_timer_infinite;
+static size_t g_timer_level_count[M_TIMER_WHEEL_INFINITE + 1u];
+static size_t g_timer_queue_count;
+
+/* First wheel tick whose level 0 slot has not been fully dispatched. */
+static m_timer_wheel_tick_t g_timer_wheel_tick;
+
+/* process() calls between taking their ready list and returning from its
+ * last callback; m_timer_queue_cancel_sync() waits for them. */
+static size_t g_timer_queue_dispatching;
+
+/* Expiry the timer service is armed for, as last reported by
+ * m_timer_queue_next_expiry(). */
+static m_timer_time_t g_timer_armed_expiry = M_TIMER_TIMEOUT_FOREVER;
+
+static m_slab_cache_t g_timer_queue_entry_cache =
+        M_SLAB_CACHE_INITIALIZER("timer_entry", m_timer_queue_entry_t);
 
 /**
  * @brief Acquire the timer queue mutex.
@@ -47,66 +86,229 @@ static void m_timer_queue_unlock(void)
 }
 
 /**
- * @brief Compare two deadlines to maintain ordering.
+ * @brief Wheel tick a monotonic timestamp falls into.
+ */
+static inline m_timer_wheel_tick_t m_timer_wheel_tick_of(m_timer_time_t time)
+{
+    return (m_timer_wheel_tick_t)(time / M_TIMER_WHEEL_RESOLUTION_US);
+}
+
+/**
+ * @brief Push an entry onto the head of a slot list.
  */
-static int m_timer_deadline_compare(const m_timer_deadline_t *a,
-                                    const m_timer_deadline_t *b)
+static void m_timer_list_push(m_timer_queue_entry_t **head,
+                              m_timer_queue_entry_t *entry)
 {
-    if (a == NULL || a->infinite) {
-        return 1;
+    entry->next = *head;
+    if (entry->next != NULL) {
+        entry->next->pprev = &entry->next;
     }
-    if (b == NULL || b->infinite) {
-        return -1;
+    entry->pprev = head;
+    *head = entry;
+}
+
+/**
+ * @brief Unlink an entry from whatever list holds it.
+ */
+static void m_timer_list_unlink(m_timer_queue_entry_t *entry)
+{
+    *entry->pprev = entry->next;
+    if (entry->next != NULL) {
+        entry->next->pprev = entry->pprev;
     }
-    if (a->target < b->target) {
-        return -1;
+    entry->next = NULL;
+    entry->pprev = NULL;
+}
+
+/**
+ * @brief File an entry into the level that covers its deadline.
+ */
+static void m_timer_wheel_insert(m_timer_queue_entry_t *entry)
+{
+    m_timer_queue_entry_t **head = NULL;
+
+    if (entry->deadline.infinite) {
+        entry->level = M_TIMER_WHEEL_INFINITE;
+        head = &g_timer_infinite;
+    } else {
+        m_timer_wheel_tick_t expires =
+                m_timer_wheel_tick_of(entry->deadline.target);
+        if (expires < g_timer_wheel_tick) {
+            expires = g_timer_wheel_tick;
+        }
+
+        m_timer_wheel_tick_t delta = expires - g_timer_wheel_tick;
+        entry->level = M_TIMER_WHEEL_OVERFLOW;
+        head = &g_timer_overflow;
+        for (uint8_t level = 0; level < M_TIMER_WHEEL_LEVELS; ++level) {
+            unsigned shift = M_TIMER_WHEEL_BITS * (level + 1u);
+            if (delta < ((m_timer_wheel_tick_t)1 << shift)) {
+                size_t slot = (size_t)(expires >> (M_TIMER_WHEEL_BITS * level))
+                              & M_TIMER_WHEEL_MASK;
+                entry->level = level;
+                head = &g_timer_wheel[level][slot];
+                break;
+            }
+        }
     }
-    if (a->target > b->target) {
-        return 1;
+
+    g_timer_level_count[entry->level]++;
+    m_timer_list_push(head, entry);
+}
+
+/**
+ * @brief Detach an entry and keep the per-level counters in step.
+ */
+static void m_timer_wheel_remove(m_timer_queue_entry_t *entry)
+{
+    g_timer_level_count[entry->level]--;
+    m_timer_list_unlink(entry);
+}
+
+/**
+ * @brief Re-file every entry of a list against the current wheel tick.
+ */
+static void m_timer_wheel_refile(m_timer_queue_entry_t **head)
+{
+    m_timer_queue_entry_t *list = *head;
+    while (list != NULL) {
+        m_timer_queue_entry_t *entry = list;
+        list = entry->next;
+        m_timer_wheel_remove(entry);
+        m_timer_wheel_insert(entry);
     }
-    return 0;
 }
 
 /**
- * @brief Check whether a deadline has already passed.
+ * @brief Pull the slots that start at the current tick down one level.
+ *
+ * Called whenever the wheel tick crosses a multiple of 64. Level l cascades
+ * on multiples of 64^l; higher levels go first so their entries can fall
+ * through more than one level.
  */
-static bool m_timer_deadline_expired(const m_timer_deadline_t *deadline,
-                                     m_timer_time_t now)
+static void m_timer_wheel_cascade(void)
 {
-    if (deadline == NULL || deadline->infinite) {
-        return false;
+    unsigned top = 1;
+    while (top < M_TIMER_WHEEL_LEVELS
+           && ((g_timer_wheel_tick >> (M_TIMER_WHEEL_BITS * top))
+               & M_TIMER_WHEEL_MASK) == 0) {
+        top++;
+    }
+
+    if (top == M_TIMER_WHEEL_LEVELS) {
+        m_timer_wheel_refile(&g_timer_overflow);
+        top = M_TIMER_WHEEL_LEVELS - 1u;
+    }
+    for (unsigned level = top; level >= 1; --level) {
+        size_t slot = (size_t)(g_timer_wheel_tick
+                               >> (M_TIMER_WHEEL_BITS * level))
+                      & M_TIMER_WHEEL_MASK;
+        m_timer_wheel_refile(&g_timer_wheel[level][slot]);
     }
-    return deadline->target <= now;
 }
 
 /**
- * @brief Insert an entry into the queue while preserving sort order.
+ * @brief Move every entry of @p slot that has expired by @p now to @p tail.
  */
-static void m_timer_queue_insert_entry(m_timer_queue_entry_t *entry)
+static m_timer_queue_entry_t **m_timer_wheel_collect(
+        m_timer_queue_entry_t **slot,
+        m_timer_time_t now,
+        m_timer_queue_entry_t **tail)
 {
-    if (g_timer_queue_head == NULL
-        || m_timer_deadline_compare(&entry->deadline,
-                                    &g_timer_queue_head->deadline) < 0) {
-        entry->next = g_timer_queue_head;
-        g_timer_queue_head = entry;
-        return;
+    m_timer_queue_entry_t *entry = *slot;
+    while (entry != NULL) {
+        m_timer_queue_entry_t *next = entry->next;
+        if (entry->deadline.target <= now) {
+            m_timer_wheel_remove(entry);
+            g_timer_queue_count--;
+            *tail = entry;
+            tail = &entry->next;
+        }
+        entry = next;
+    }
+    return tail;
+}
+
+/**
+ * @brief Advance the wheel to @p now and detach everything that expired.
+ */
+static m_timer_queue_entry_t *m_timer_wheel_advance(m_timer_time_t now)
+{
+    m_timer_queue_entry_t *expired = NULL;
+    m_timer_queue_entry_t **tail = &expired;
+    m_timer_wheel_tick_t target = m_timer_wheel_tick_of(now);
+
+    while (g_timer_wheel_tick < target) {
+        if (g_timer_level_count[0] == 0) {
+            /* Nothing fires before the next cascade of the lowest populated
+             * level, so jump straight to it. */
+            m_timer_wheel_tick_t span_mask = M_TIMER_WHEEL_MASK;
+            unsigned level = 1;
+            while (level <= M_TIMER_WHEEL_OVERFLOW
+                   && g_timer_level_count[level] == 0) {
+                span_mask = (span_mask << M_TIMER_WHEEL_BITS)
+                            | M_TIMER_WHEEL_MASK;
+                level++;
+            }
+            m_timer_wheel_tick_t next = (g_timer_wheel_tick | span_mask) + 1u;
+            if (level > M_TIMER_WHEEL_OVERFLOW || next > target) {
+                g_timer_wheel_tick = target;
+                break;
+            }
+            g_timer_wheel_tick = next;
+            m_timer_wheel_cascade();
+            continue;
+        }
+
+        size_t slot = (size_t)(g_timer_wheel_tick & M_TIMER_WHEEL_MASK);
+        tail = m_timer_wheel_collect(&g_timer_wheel[0][slot], now, tail);
+        g_timer_wheel_tick++;
+        if ((g_timer_wheel_tick & M_TIMER_WHEEL_MASK) == 0) {
+            m_timer_wheel_cascade();
+        }
     }
 
-    m_timer_queue_entry_t *current = g_timer_queue_head;
-    while (current->next != NULL
-           && m_timer_deadline_compare(&entry->deadline,
-                                       &current->next->deadline) >= 0) {
-        current = current->next;
+    /* The current tick is only partly over; leave its later entries. */
+    size_t slot = (size_t)(g_timer_wheel_tick & M_TIMER_WHEEL_MASK);
+    m_timer_wheel_collect(&g_timer_wheel[0][slot], now, tail);
+    return expired;
+}
+
+/**
+ * @brief Earliest finite deadline in a list.
+ */
+static bool m_timer_list_earliest(const m_timer_queue_entry_t *entry,
+                                  m_timer_time_t *earliest)
+{
+    bool found = false;
+    for (; entry != NULL; entry = entry->next) {
+        if (!found || entry->deadline.target < *earliest) {
+            *earliest = entry->deadline.target;
+            found = true;
+        }
     }
+    return found;
+}
 
-    entry->next = current->next;
-    current->next = entry;
+/**
+ * @brief Latest time an entry may fire: its deadline plus its slack.
+ */
+static inline m_timer_time_t m_timer_entry_expiry(
+        const m_timer_queue_entry_t *entry)
+{
+    m_timer_time_t expiry = entry->deadline.target + entry->slack_us;
+    return (expiry < entry->deadline.target) ? M_TIMER_TIMEOUT_FOREVER
+                                             : expiry;
 }
 
 void m_timer_queue_init(void)
 {
-    g_timer_queue_head = NULL;
     m_timer_queue_lock();
+    /* Entries are filed relative to the wheel tick; never move it under
+     * them. */
+    if (g_timer_queue_count == 0) {
+        g_timer_wheel_tick = m_timer_wheel_tick_of(m_timer_get_monotonic());
+    }
     m_timer_queue_unlock();
 }
 
@@ -115,22 +317,76 @@ m_timer_queue_entry_t *m_timer_queue_schedule(
         m_timer_queue_callback_t callback,
         void *context)
 {
-    m_timer_queue_entry_t *entry = pvPortMalloc(sizeof(*entry));
-    if (entry == NULL) {
-        return NULL;
-    }
+    return m_timer_queue_schedule_slack(deadline,
+                                        deadline.slack_us,
+                                        callback,
+                                        context);
+}
 
+/**
+ * @brief Fill in and file an entry, waking the service if it is now first.
+ */
+static void m_timer_queue_insert(m_timer_queue_entry_t *entry,
+                                 m_timer_deadline_t deadline,
+                                 uint64_t slack_us,
+                                 m_timer_queue_callback_t callback,
+                                 void *context)
+{
     entry->deadline = deadline;
     entry->callback = callback;
     entry->context = context;
+    entry->slack_us = slack_us;
     entry->next = NULL;
+    entry->pprev = NULL;
 
+    bool kick = false;
     m_timer_queue_lock();
-    m_timer_queue_insert_entry(entry);
+    m_timer_wheel_insert(entry);
+    g_timer_queue_count++;
+    if (!deadline.infinite) {
+        m_timer_time_t expiry = m_timer_entry_expiry(entry);
+        if (expiry < g_timer_armed_expiry) {
+            g_timer_armed_expiry = expiry;
+            kick = true;
+        }
+    }
     m_timer_queue_unlock();
+
+    if (kick) {
+        _m_timer_service_kick();
+    }
+}
+
+m_timer_queue_entry_t *m_timer_queue_schedule_slack(
+        m_timer_deadline_t deadline,
+        uint64_t slack_us,
+        m_timer_queue_callback_t callback,
+        void *context)
+{
+    m_timer_queue_entry_t *entry = m_slab_alloc(&g_timer_queue_entry_cache);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    entry->caller_owned = false;
+    m_timer_queue_insert(entry, deadline, slack_us, callback, context);
     return entry;
 }
 
+void m_timer_queue_arm(m_timer_queue_entry_t *entry,
+                       m_timer_deadline_t deadline,
+                       uint64_t slack_us,
+                       m_timer_queue_callback_t callback,
+                       void *context)
+{
+    if (entry == NULL) {
+        return;
+    }
+
+    entry->caller_owned = true;
+    m_timer_queue_insert(entry, deadline, slack_us, callback, context);
+}
+
 bool m_timer_queue_cancel(m_timer_queue_entry_t *entry)
 {
     if (entry == NULL) {
@@ -139,69 +395,178 @@ bool m_timer_queue_cancel(m_timer_queue_entry_t *entry)
 
     bool removed = false;
     m_timer_queue_lock();
-    m_timer_queue_entry_t **link = &g_timer_queue_head;
-    while (*link != NULL) {
-        if (*link == entry) {
-            m_timer_queue_entry_t *target = *link;
-            *link = target->next;
-            removed = true;
-            break;
-        }
-        link = &(*link)->next;
+    if (entry->pprev != NULL) {
+        m_timer_wheel_remove(entry);
+        g_timer_queue_count--;
+        removed = true;
     }
     m_timer_queue_unlock();
 
-    if (removed) {
-        vPortFree(entry);
+    if (removed && !entry->caller_owned) {
+        m_slab_free(&g_timer_queue_entry_cache, entry);
     }
     return removed;
 }
 
-void m_timer_queue_process(m_timer_time_t now)
+bool m_timer_queue_cancel_sync(m_timer_queue_entry_t *entry)
 {
-    while (true) {
-        m_timer_queue_entry_t *ready = NULL;
+    if (m_timer_queue_cancel(entry)) {
+        return true;
+    }
+
+    /* The entry may sit on the ready list of a dispatch in progress. That
+     * window is a few callbacks long, so poll rather than add a wakeup to
+     * every dispatch. */
+    for (;;) {
         m_timer_queue_lock();
-        if (g_timer_queue_head != NULL
-            && m_timer_deadline_expired(&g_timer_queue_head->deadline, now)) {
-            ready = g_timer_queue_head;
-            g_timer_queue_head = ready->next;
-            ready->next = NULL;
-        }
+        size_t dispatching = g_timer_queue_dispatching;
         m_timer_queue_unlock();
+        if (dispatching == 0) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+}
 
-        if (ready == NULL) {
-            break;
+void m_timer_queue_process(m_timer_time_t now)
+{
+    m_timer_queue_lock();
+    m_timer_queue_entry_t *ready = m_timer_wheel_advance(now);
+    if (ready != NULL) {
+        g_timer_queue_dispatching++;
+    }
+    m_timer_queue_unlock();
+
+    size_t dispatched = 0;
+    while (ready != NULL) {
+        m_timer_queue_entry_t *entry = ready;
+        ready = entry->next;
+        entry->next = NULL;
+        dispatched++;
+
+        /* A caller-owned entry may be reused as soon as its callback
+         * starts; do not touch it afterwards. */
+        bool caller_owned = entry->caller_owned;
+        if (entry->callback) {
+            entry->callback(entry, entry->context);
         }
 
-        if (ready->callback) {
-            ready->callback(ready, ready->context);
+        if (!caller_owned) {
+            m_slab_free(&g_timer_queue_entry_cache, entry);
         }
+    }
 
-        vPortFree(ready);
+    if (dispatched > 0) {
+        m_timer_queue_lock();
+        g_timer_queue_dispatching--;
+        m_timer_queue_unlock();
+        m_timer_diag_record_batch(dispatched);
     }
 }
 
 size_t m_timer_queue_length(void)
 {
-    size_t count = 0;
     m_timer_queue_lock();
-    m_timer_queue_entry_t *current = g_timer_queue_head;
-    while (current != NULL) {
-        count++;
-        current = current->next;
-    }
+    size_t count = g_timer_queue_count;
     m_timer_queue_unlock();
     return count;
 }
 
 bool m_timer_queue_next_deadline(m_timer_deadline_t *out)
 {
+    m_timer_time_t earliest = 0;
+    bool found = false;
+
     m_timer_queue_lock();
-    bool has_next = (g_timer_queue_head != NULL);
+    /* Slots of a level are time ordered starting just past the current
+     * one, so only the first populated slot of each level can hold the
+     * minimum. Level 0 starts at the current slot itself. */
+    for (unsigned level = 0; level < M_TIMER_WHEEL_LEVELS; ++level) {
+        if (g_timer_level_count[level] == 0) {
+            continue;
+        }
+        size_t current = (size_t)(g_timer_wheel_tick
+                                  >> (M_TIMER_WHEEL_BITS * level))
+                         & M_TIMER_WHEEL_MASK;
+        size_t first = (level == 0) ? 0 : 1;
+        for (size_t i = first; i < first + M_TIMER_WHEEL_SLOTS; ++i) {
+            const m_timer_queue_entry_t *slot =
+                    g_timer_wheel[level][(current + i) & M_TIMER_WHEEL_MASK];
+            m_timer_time_t candidate = 0;
+            if (m_timer_list_earliest(slot, &candidate)) {
+                if (!found || candidate < earliest) {
+                    earliest = candidate;
+                    found = true;
+                }
+                break;
+            }
+        }
+    }
+
+    m_timer_time_t candidate = 0;
+    if (m_timer_list_earliest(g_timer_overflow, &candidate)
+        && (!found || candidate < earliest)) {
+        earliest = candidate;
+        found = true;
+    }
+
+    bool has_next = found || (g_timer_infinite != NULL);
+    m_timer_queue_unlock();
+
     if (has_next && out != NULL) {
-        *out = g_timer_queue_head->deadline;
+        out->infinite = !found;
+        out->target = found ? earliest : 0;
     }
+    return has_next;
+}
+
+bool m_timer_queue_next_expiry(m_timer_time_t *out)
+{
+    m_timer_time_t best = M_TIMER_TIMEOUT_FOREVER;
+
+    m_timer_queue_lock();
+    /* Walk each level in time order until the slots start later than the
+     * best expiry seen so far; slack can let a later deadline win. */
+    for (unsigned level = 0; level < M_TIMER_WHEEL_LEVELS; ++level) {
+        if (g_timer_level_count[level] == 0) {
+            continue;
+        }
+        unsigned shift = M_TIMER_WHEEL_BITS * level;
+        m_timer_wheel_tick_t base = g_timer_wheel_tick >> shift;
+        size_t first = (level == 0) ? 0 : 1;
+        for (size_t i = first; i < first + M_TIMER_WHEEL_SLOTS; ++i) {
+            m_timer_wheel_tick_t start = (base + i) << shift;
+            if (level > 0 || i > 0) {
+                if (start * M_TIMER_WHEEL_RESOLUTION_US >= best) {
+                    break;
+                }
+            }
+            const m_timer_queue_entry_t *entry =
+                    g_timer_wheel[level][(base + i) & M_TIMER_WHEEL_MASK];
+            for (; entry != NULL; entry = entry->next) {
+                m_timer_time_t expiry = m_timer_entry_expiry(entry);
+                if (expiry < best) {
+                    best = expiry;
+                }
+            }
+        }
+    }
+
+    for (const m_timer_queue_entry_t *entry = g_timer_overflow;
+         entry != NULL;
+         entry = entry->next) {
+        m_timer_time_t expiry = m_timer_entry_expiry(entry);
+        if (expiry < best) {
+            best = expiry;
+        }
+    }
+
+    g_timer_armed_expiry = best;
     m_timer_queue_unlock();
+
+    bool has_next = (best != M_TIMER_TIMEOUT_FOREVER);
+    if (has_next && out != NULL) {
+        *out = best;
+    }
     return has_next;
 }
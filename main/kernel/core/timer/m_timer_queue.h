@@ -1,7 +1,7 @@
 /**
  * @file kernel/core/timer/m_timer_queue.h
  * @brief Magnolia timer queue interface.
- * @details Maintains an ordered timer event list that can be used by future
+ * @details Maintains a timer wheel of timeouts that can be used by future
  *          subsystems without mixing with the core deadline logic.
  */
 
@@ -22,6 +22,23 @@ typedef struct m_timer_queue_entry m_timer_queue_entry_t;
 typedef void (*m_timer_queue_callback_t)(m_timer_queue_entry_t *entry,
                                          void *context);
 
+/**
+ * @brief Timer queue entry.
+ *
+ * Defined here only so callers can embed one for m_timer_queue_arm(); the
+ * fields are private to the queue.
+ */
+struct m_timer_queue_entry {
+    m_timer_deadline_t deadline;
+    m_timer_queue_callback_t callback;
+    void *context;
+    uint64_t slack_us;
+    m_timer_queue_entry_t *next;
+    m_timer_queue_entry_t **pprev;
+    uint8_t level;
+    bool caller_owned;
+};
+
 /**
  * @brief Initialize the internal queue state.
  */
@@ -30,6 +47,8 @@ void m_timer_queue_init(void);
 /**
  * @brief Schedule a deadline into the queue.
  *
+ * Honours the slack carried by @p deadline.
+ *
  * @param deadline Deadline descriptor.
  * @param callback Callback invoked when the deadline expires.
  * @param context Arbitrary user context.
@@ -40,16 +59,75 @@ m_timer_queue_entry_t *m_timer_queue_schedule(
         m_timer_queue_callback_t callback,
         void *context);
 
+/**
+ * @brief Schedule a deadline that may fire up to @p slack_us late.
+ *
+ * The timer service wakes once for the earliest deadline-plus-slack in the
+ * queue and fires every entry that is due by then, so entries with slack
+ * are batched with their neighbours instead of each arming the hardware.
+ *
+ * @param deadline Deadline descriptor.
+ * @param slack_us Tolerated lateness in microseconds.
+ * @param callback Callback invoked when the deadline expires.
+ * @param context Arbitrary user context.
+ * @return Entry handle that can be used for cancellation.
+ */
+m_timer_queue_entry_t *m_timer_queue_schedule_slack(
+        m_timer_deadline_t deadline,
+        uint64_t slack_us,
+        m_timer_queue_callback_t callback,
+        void *context);
+
+/**
+ * @brief Arm a caller-owned entry.
+ *
+ * Behaves like m_timer_queue_schedule_slack() but never allocates and never
+ * frees @p entry. If m_timer_queue_cancel() returns false the callback has
+ * run or is about to; the caller must not reuse the storage until the
+ * callback has signalled completion. The queue itself does not touch the
+ * entry once the callback has been entered.
+ *
+ * @param entry Storage for the entry.
+ * @param deadline Deadline descriptor.
+ * @param slack_us Tolerated lateness in microseconds.
+ * @param callback Callback invoked when the deadline expires.
+ * @param context Arbitrary user context.
+ */
+void m_timer_queue_arm(m_timer_queue_entry_t *entry,
+                       m_timer_deadline_t deadline,
+                       uint64_t slack_us,
+                       m_timer_queue_callback_t callback,
+                       void *context);
+
 /**
  * @brief Cancel a scheduled entry.
  *
+ * A queue-allocated handle is only valid until its callback has run or a
+ * cancel has succeeded; cancelling it afterwards is undefined. Caller-owned
+ * entries may be cancelled at any time while their storage is live.
+ *
  * @param entry Entry returned by @p m_timer_queue_schedule.
  * @return true if the entry was removed.
  */
 bool m_timer_queue_cancel(m_timer_queue_entry_t *entry);
 
+/**
+ * @brief Cancel a caller-owned entry and wait out a dispatch already
+ *        holding it.
+ *
+ * On return the callback is neither pending nor running, so the storage
+ * may be released. Must not be called from a timer queue callback.
+ *
+ * @param entry Caller-owned entry armed with m_timer_queue_arm().
+ * @return true if the entry was removed before it fired.
+ */
+bool m_timer_queue_cancel_sync(m_timer_queue_entry_t *entry);
+
 /**
  * @brief Dispatch all expirations up to @p now.
+ *
+ * Entries fire in deadline order across wheel slots; entries sharing a slot
+ * (CONFIG_MAGNOLIA_TIMER_WHEEL_RESOLUTION_US wide) fire in unspecified order.
  */
 void m_timer_queue_process(m_timer_time_t now);
 
@@ -66,6 +144,17 @@ size_t m_timer_queue_length(void);
  */
 bool m_timer_queue_next_deadline(m_timer_deadline_t *out);
 
+/**
+ * @brief Earliest time by which some entry must fire, counting slack.
+ *
+ * Meant for the timer service: the returned time is remembered as the armed
+ * expiry, and scheduling anything due before it wakes the service.
+ *
+ * @param out Expiry output location.
+ * @return true if a finite entry exists.
+ */
+bool m_timer_queue_next_expiry(m_timer_time_t *out);
+
 #ifdef __cplusplus
 }
 #endif
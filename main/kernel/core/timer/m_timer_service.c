@@ -0,0 +1,113 @@
+/**
+ * @file kernel/core/timer/m_timer_service.c
+ * @brief Magnolia timer service task implementation.
+ * @details A one-shot esp_timer wakes the service task at the next queue
+ *          expiry; the task dispatches every entry that is due as one batch
+ *          and re-arms the esp_timer for whatever is left.
+ */
+
+#include "kernel/core/timer/m_timer_service.h"
+#include "kernel/core/timer/m_timer_queue.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "timer_service";
+
+static StaticTask_t g_timer_service_tcb;
+static StackType_t g_timer_service_stack[CONFIG_MAGNOLIA_TIMER_SERVICE_STACK_DEPTH];
+static TaskHandle_t g_timer_service_task;
+static esp_timer_handle_t g_timer_service_alarm;
+
+/**
+ * @brief esp_timer callback; hands the expiry to the service task.
+ */
+static void m_timer_service_alarm(void *arg)
+{
+    (void)arg;
+    _m_timer_service_kick();
+}
+
+/**
+ * @brief Arm the esp_timer for the next expiry, or stop it if none.
+ */
+static void m_timer_service_rearm(void)
+{
+    m_timer_time_t expiry = 0;
+    esp_timer_stop(g_timer_service_alarm);
+    if (!m_timer_queue_next_expiry(&expiry)) {
+        return;
+    }
+
+    m_timer_time_t now = m_timer_get_monotonic();
+    uint64_t delay = (expiry > now) ? (expiry - now) : 0;
+    if (esp_timer_start_once(g_timer_service_alarm, delay) != ESP_OK) {
+        /* Never strand the queue; poll again on the next kick. */
+        xTaskNotifyGive(g_timer_service_task);
+    }
+}
+
+/**
+ * @brief Service loop: dispatch what is due, re-arm, sleep.
+ */
+static void m_timer_service_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        m_timer_queue_process(m_timer_get_monotonic());
+        m_timer_service_rearm();
+    }
+}
+
+bool m_timer_service_start(void)
+{
+    if (g_timer_service_task != NULL) {
+        return true;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = m_timer_service_alarm,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "m_timer",
+        .skip_unhandled_events = true,
+    };
+    if (esp_timer_create(&args, &g_timer_service_alarm) != ESP_OK) {
+        ESP_LOGE(TAG, "esp_timer_create failed");
+        return false;
+    }
+
+    g_timer_service_task = xTaskCreateStatic(
+            m_timer_service_task,
+            "m_timer",
+            CONFIG_MAGNOLIA_TIMER_SERVICE_STACK_DEPTH,
+            NULL,
+            CONFIG_MAGNOLIA_TIMER_SERVICE_PRIORITY,
+            g_timer_service_stack,
+            &g_timer_service_tcb);
+    if (g_timer_service_task == NULL) {
+        esp_timer_delete(g_timer_service_alarm);
+        g_timer_service_alarm = NULL;
+        return false;
+    }
+
+    /* Pick up anything scheduled before the service existed. */
+    xTaskNotifyGive(g_timer_service_task);
+    return true;
+}
+
+bool m_timer_service_running(void)
+{
+    return g_timer_service_task != NULL;
+}
+
+void _m_timer_service_kick(void)
+{
+    TaskHandle_t task = g_timer_service_task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
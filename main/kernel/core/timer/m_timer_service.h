@@ -0,0 +1,62 @@
+/**
+ * @file kernel/core/timer/m_timer_service.h
+ * @brief Magnolia timer service task.
+ * @details Drives m_timer_queue_process() from a dedicated task woken by a
+ *          one-shot high-resolution esp_timer armed to the next queue expiry.
+ */
+
+#ifndef MAGNOLIA_TIMER_M_TIMER_SERVICE_H
+#define MAGNOLIA_TIMER_M_TIMER_SERVICE_H
+
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+#ifndef CONFIG_MAGNOLIA_TIMER_SERVICE
+#define CONFIG_MAGNOLIA_TIMER_SERVICE 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_MAGNOLIA_TIMER_SERVICE
+/**
+ * @brief Create the esp_timer and the service task.
+ *
+ * @return true if the service is running.
+ */
+bool m_timer_service_start(void);
+
+/**
+ * @brief Check whether queue callbacks are dispatched by the service.
+ */
+bool m_timer_service_running(void);
+
+/**
+ * @brief Ask the service to dispatch and re-arm.
+ *
+ * Called by the queue when an entry becomes due before the armed expiry.
+ */
+void _m_timer_service_kick(void);
+#else
+static inline bool m_timer_service_start(void)
+{
+    return false;
+}
+
+static inline bool m_timer_service_running(void)
+{
+    return false;
+}
+
+static inline void _m_timer_service_kick(void)
+{
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAGNOLIA_TIMER_M_TIMER_SERVICE_H */
@@ -10,9 +10,11 @@
 
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 #include "kernel/core/timer/m_timer.h"
+#include "kernel/core/timer/m_timer_service.h"
 
 static const char *TAG = "timer_tests";
 
@@ -68,6 +70,28 @@ static bool run_test_deadline_ticks(void)
     return (ticks > 0);
 }
 
+/*
+ * Let the test's own entries expire in real time. The timer service fires
+ * them when it runs; otherwise the queue is processed here, never ahead of
+ * the real clock, so entries of other tasks are not fired early.
+ */
+static bool timer_test_wait(volatile size_t *count,
+                            size_t expected,
+                            m_timer_time_t timeout_us)
+{
+    m_timer_time_t limit = m_timer_get_monotonic() + timeout_us;
+    while (*count < expected) {
+        if (m_timer_get_monotonic() >= limit) {
+            return false;
+        }
+        vTaskDelay(1);
+        if (!m_timer_service_running()) {
+            m_timer_queue_process(m_timer_get_monotonic());
+        }
+    }
+    return true;
+}
+
 static bool run_test_queue_ordering(void)
 {
     timer_queue_test_ctx_t ctx = {0};
@@ -83,28 +107,157 @@ static bool run_test_queue_ordering(void)
                            timer_queue_callback,
                            &events[1]);
 
-    m_timer_queue_process(m_timer_get_monotonic());
-    m_timer_queue_process(m_timer_get_monotonic() + 2000ULL);
-
-    bool order_ok = (ctx.count == 2 && ctx.fired[0] == 1
-                     && ctx.fired[1] == 2);
-    bool empty = (m_timer_queue_length() == 0);
-    return order_ok && empty;
+    bool done = timer_test_wait(&ctx.count, 2, 100000ULL);
+    return done && ctx.fired[0] == 1 && ctx.fired[1] == 2;
 }
 
 static bool run_test_queue_cancel(void)
 {
     timer_queue_event_t event = {.ctx = NULL, .id = 3};
-    m_timer_queue_entry_t *entry =
-            m_timer_queue_schedule(m_timer_deadline_from_relative(5000000ULL),
-                                   timer_queue_callback,
-                                   &event);
-    if (entry == NULL) {
+    m_timer_queue_entry_t entry;
+    m_timer_queue_arm(&entry,
+                      m_timer_deadline_from_relative(5000000ULL),
+                      0,
+                      timer_queue_callback,
+                      &event);
+
+    bool cancelled = m_timer_queue_cancel(&entry);
+    return cancelled && !m_timer_queue_cancel(&entry);
+}
+
+#define TIMER_CHURN_ENTRIES 256
+#define TIMER_CHURN_ROUNDS 8
+#define TIMER_CHURN_LEAD_US 2000ULL
+#define TIMER_CHURN_SPREAD_US 20000ULL
+
+static void timer_churn_callback(m_timer_queue_entry_t *entry, void *context)
+{
+    (void)entry;
+    volatile size_t *fired = context;
+    (*fired)++;
+}
+
+/*
+ * Arm a spread of timeouts, cancel every other one and let the rest expire,
+ * the pattern IPC and job waits produce. Only the test's own entries are
+ * checked, and they expire in real time so other users of the queue are
+ * left alone. The reported time covers arming and cancelling only.
+ */
+static bool run_test_queue_churn(void)
+{
+    static m_timer_queue_entry_t entries[TIMER_CHURN_ENTRIES];
+    volatile size_t fired = 0;
+    size_t cancelled = 0;
+    size_t ops = 0;
+    m_timer_time_t elapsed = 0;
+    bool ok = true;
+
+    for (size_t round = 0; round < TIMER_CHURN_ROUNDS && ok; ++round) {
+        m_timer_time_t start = m_timer_get_monotonic();
+        for (size_t i = 0; i < TIMER_CHURN_ENTRIES; ++i) {
+            m_timer_deadline_t deadline = {
+                .target = start + TIMER_CHURN_LEAD_US
+                          + (i * 7919ULL) % TIMER_CHURN_SPREAD_US,
+                .infinite = false,
+            };
+            m_timer_queue_arm(&entries[i],
+                              deadline,
+                              0,
+                              timer_churn_callback,
+                              (void *)&fired);
+        }
+        for (size_t i = 1; i < TIMER_CHURN_ENTRIES; i += 2) {
+            if (m_timer_queue_cancel(&entries[i])) {
+                cancelled++;
+            }
+        }
+        elapsed += m_timer_get_monotonic() - start;
+        ops += TIMER_CHURN_ENTRIES + TIMER_CHURN_ENTRIES / 2;
+
+        /* Entries are reused next round, so every one must be done. */
+        ok = timer_test_wait(&fired,
+                             (round + 1) * TIMER_CHURN_ENTRIES - cancelled,
+                             TIMER_CHURN_LEAD_US + TIMER_CHURN_SPREAD_US
+                                     + 100000ULL);
+    }
+
+    if (!ok) {
+        for (size_t i = 0; i < TIMER_CHURN_ENTRIES; ++i) {
+            m_timer_queue_cancel(&entries[i]);
+        }
+        return false;
+    }
+
+    size_t expected = TIMER_CHURN_ROUNDS * TIMER_CHURN_ENTRIES;
+    ok &= (fired + cancelled == expected) && (fired >= expected / 2);
+    ESP_LOGI(TAG,
+             "timer churn: %u ops in %llu us",
+             (unsigned)ops,
+             (unsigned long long)elapsed);
+    return ok;
+}
+
+typedef struct {
+    SemaphoreHandle_t done;
+    m_timer_time_t fired_at[2];
+    size_t count;
+} timer_service_test_ctx_t;
+
+static void timer_service_callback(m_timer_queue_entry_t *entry,
+                                   void *context)
+{
+    (void)entry;
+    timer_service_test_ctx_t *ctx = context;
+    if (ctx->count < 2) {
+        ctx->fired_at[ctx->count] = m_timer_get_monotonic();
+    }
+    if (++ctx->count == 2) {
+        xSemaphoreGive(ctx->done);
+    }
+}
+
+/*
+ * The first entry tolerates enough slack to be batched with the second, so
+ * the service should fire both in one wakeup, after the second deadline.
+ */
+static bool run_test_service_dispatch(void)
+{
+    if (!m_timer_service_running()) {
+        return true;
+    }
+
+    static StaticSemaphore_t storage;
+    timer_service_test_ctx_t ctx = {
+        .done = xSemaphoreCreateBinaryStatic(&storage),
+    };
+    if (ctx.done == NULL) {
+        return false;
+    }
+
+    m_timer_diag_report_t before = {0};
+    m_timer_diag_snapshot(&before);
+
+    m_timer_time_t now = m_timer_get_monotonic();
+    m_timer_deadline_t first = {.target = now + 1500ULL,
+                                .infinite = false,
+                                .slack_us = 5000};
+    m_timer_deadline_t second = {.target = now + 3000ULL, .infinite = false};
+    m_timer_queue_schedule(first, timer_service_callback, &ctx);
+    m_timer_queue_schedule(second, timer_service_callback, &ctx);
+
+    if (xSemaphoreTake(ctx.done, pdMS_TO_TICKS(100)) != pdTRUE) {
         return false;
     }
 
-    bool cancelled = m_timer_queue_cancel(entry);
-    return cancelled && (m_timer_queue_length() == 0);
+    m_timer_diag_report_t after = {0};
+    m_timer_diag_snapshot(&after);
+    ESP_LOGI(TAG,
+             "service dispatch: late by %llu us, %u wakeups saved",
+             (unsigned long long)(ctx.fired_at[1] - second.target),
+             (unsigned)(after.wakeups_saved - before.wakeups_saved));
+    return (ctx.fired_at[0] >= second.target)
+           && (ctx.fired_at[1] >= second.target)
+           && (after.wakeups_saved > before.wakeups_saved);
 }
 
 void m_timer_selftests_run(void)
@@ -114,6 +267,8 @@ void m_timer_selftests_run(void)
     overall &= test_report("deadline tick conversion", run_test_deadline_ticks());
     overall &= test_report("queue ordering", run_test_queue_ordering());
     overall &= test_report("queue cancel", run_test_queue_cancel());
+    overall &= test_report("queue churn benchmark", run_test_queue_churn());
+    overall &= test_report("service dispatch", run_test_service_dispatch());
     ESP_LOGI(TAG, "timer self-tests %s",
              overall ? "PASSED" : "FAILED");
 }
@@ -6,9 +6,15 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/portmacro.h"
 
+#include "kernel/core/memory/m_slab.h"
 #include "kernel/core/vfs/core/m_vfs_object.h"
 #include "kernel/core/vfs/core/m_vfs_wait.h"
 
+static m_slab_cache_t g_vfs_node_cache =
+        M_SLAB_CACHE_INITIALIZER("vfs_node", m_vfs_node_t);
+static m_slab_cache_t g_vfs_file_cache =
+        M_SLAB_CACHE_INITIALIZER("vfs_file", m_vfs_file_t);
+
 #if CONFIG_MAGNOLIA_VFS_NODE_LIFETIME_CHECK
 static atomic_size_t g_vfs_node_live_count = ATOMIC_VAR_INIT(0);
 
@@ -103,7 +109,7 @@ m_vfs_node_t *m_vfs_node_create(m_vfs_mount_t *mount,
         return NULL;
     }
 
-    m_vfs_node_t *node = pvPortMalloc(sizeof(*node));
+    m_vfs_node_t *node = m_slab_alloc(&g_vfs_node_cache);
     if (node == NULL) {
         return NULL;
     }
@@ -158,9 +164,8 @@ _m_vfs_node_free(m_vfs_node_t *node)
             node->fs_type->ops != NULL &&
             node->fs_type->ops->node_destroy != NULL) {
         node->fs_type->ops->node_destroy(node);
-    } else {
-        vPortFree(node);
     }
+    m_slab_free(&g_vfs_node_cache, node);
 }
 
 void m_vfs_node_release(m_vfs_node_t *node)
@@ -196,7 +201,7 @@ m_vfs_file_t *m_vfs_file_create(m_vfs_node_t *node)
         return NULL;
     }
 
-    m_vfs_file_t *file = pvPortMalloc(sizeof(*file));
+    m_vfs_file_t *file = m_slab_alloc(&g_vfs_file_cache);
     if (file == NULL) {
         return NULL;
     }
@@ -241,9 +246,8 @@ _m_vfs_file_free(m_vfs_file_t *file)
             file->node->fs_type->ops != NULL &&
             file->node->fs_type->ops->file_destroy != NULL) {
         file->node->fs_type->ops->file_destroy(file);
-    } else {
-        vPortFree(file);
     }
+    m_slab_free(&g_vfs_file_cache, file);
 
     if (node != NULL) {
         m_vfs_node_release(node);
@@ -132,6 +132,7 @@ struct m_vfs_fs_ops {
                              m_vfs_stat_t *stat);
     m_vfs_error_t (*setattr)(struct m_vfs_node *node,
                              const m_vfs_stat_t *stat);
+    /* Release fs_private state; the VFS core frees the node/file itself. */
     void (*node_destroy)(struct m_vfs_node *node);
     void (*file_destroy)(struct m_vfs_file *file);
 };
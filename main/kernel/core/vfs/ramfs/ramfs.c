@@ -172,7 +172,6 @@ _ramfs_node_destroy(m_vfs_node_t *node)
 {
     ramfs_node_data_t *data = _ramfs_node_from_vnode(node);
     if (data == NULL) {
-        vPortFree(node);
         return;
     }
 
@@ -183,7 +182,6 @@ _ramfs_node_destroy(m_vfs_node_t *node)
     }
 
     _ramfs_free_node(data);
-    vPortFree(node);
 }
 
 static m_vfs_error_t
@@ -30,6 +30,10 @@
 #include "kernel/core/ipc/ipc_shm.h"
 #endif
 
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+#include "kernel/core/memory/m_alloc.h"
+#endif
+
 #if CONFIG_MAGNOLIA_IPC_ENABLED
 
 static const char *const DEVFS_SHM_TAG = "devfs_shm";
@@ -732,7 +736,6 @@ static void devfs_node_destroy(m_vfs_node_t *node)
 
     devfs_node_data_t *data = (devfs_node_data_t *)node->fs_private;
     if (data == NULL) {
-        vPortFree(node);
         return;
     }
 
@@ -780,7 +783,7 @@ static void devfs_node_destroy(m_vfs_node_t *node)
         vPortFree(device);
     }
     vPortFree(data);
-    vPortFree(node);
+    node->fs_private = NULL;
 
     devfs_maybe_free_mount(mount);
 }
@@ -1411,11 +1414,98 @@ static const devfs_ops_t s_devfs_random_ops = {
     .poll = devfs_default_poll,
 };
 
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+/*
+ * /dev/heapprof renders the allocator profile when opened and streams that
+ * snapshot to the reader. Only one reader at a time owns the snapshot.
+ */
+typedef struct {
+    char *report;
+    size_t length;
+    size_t offset;
+    bool open;
+} devfs_heapprof_t;
+
+static devfs_heapprof_t s_devfs_heapprof;
+static portMUX_TYPE s_devfs_heapprof_lock =
+        (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+static m_vfs_error_t devfs_heapprof_open(void *private_data)
+{
+    devfs_heapprof_t *prof = (devfs_heapprof_t *)private_data;
+    portENTER_CRITICAL(&s_devfs_heapprof_lock);
+    bool busy = prof->open;
+    prof->open = true;
+    portEXIT_CRITICAL(&s_devfs_heapprof_lock);
+    if (busy) {
+        return M_VFS_ERR_BUSY;
+    }
+
+    /* Size the buffer first; heaps may grow in between, so leave slack. */
+    size_t needed = m_alloc_profile_format(NULL, 0) + 256;
+    char *report = pvPortMalloc(needed);
+    if (report == NULL) {
+        prof->open = false;
+        return M_VFS_ERR_NO_MEMORY;
+    }
+    size_t length = m_alloc_profile_format(report, needed);
+    prof->report = report;
+    prof->length = (length < needed) ? length : needed - 1;
+    prof->offset = 0;
+    return M_VFS_ERR_OK;
+}
+
+static m_vfs_error_t devfs_heapprof_close(void *private_data)
+{
+    devfs_heapprof_t *prof = (devfs_heapprof_t *)private_data;
+    vPortFree(prof->report);
+    prof->report = NULL;
+    prof->length = 0;
+    prof->offset = 0;
+    prof->open = false;
+    return M_VFS_ERR_OK;
+}
+
+static m_vfs_error_t devfs_heapprof_read(void *private_data,
+                                         void *buffer,
+                                         size_t size,
+                                         size_t *read)
+{
+    devfs_heapprof_t *prof = (devfs_heapprof_t *)private_data;
+    if (buffer == NULL || read == NULL) {
+        return M_VFS_ERR_INVALID_PARAM;
+    }
+
+    size_t remaining = prof->length - prof->offset;
+    size_t count = (size < remaining) ? size : remaining;
+    memcpy(buffer, prof->report + prof->offset, count);
+    prof->offset += count;
+    *read = count;
+    return M_VFS_ERR_OK;
+}
+
+static uint32_t devfs_heapprof_poll(void *private_data)
+{
+    (void)private_data;
+    return DEVFS_EVENT_READABLE;
+}
+
+static const devfs_ops_t s_devfs_heapprof_ops = {
+    .open = devfs_heapprof_open,
+    .close = devfs_heapprof_close,
+    .read = devfs_heapprof_read,
+    .poll = devfs_heapprof_poll,
+};
+#endif
+
 void m_devfs_register_default_devices(void)
 {
     devfs_register("/dev/null", &s_devfs_null_ops, NULL);
     devfs_register("/dev/zero", &s_devfs_zero_ops, NULL);
     devfs_register("/dev/random", &s_devfs_random_ops, NULL);
+#if CONFIG_MAGNOLIA_ALLOC_PROFILE
+    devfs_register("/dev/heapprof", &s_devfs_heapprof_ops, &s_devfs_heapprof);
+#endif
 #if CONFIG_MAGNOLIA_IPC_ENABLED
     devfs_shm_register_devices();
 #if CONFIG_MAGNOLIA_DEVFS_PIPES
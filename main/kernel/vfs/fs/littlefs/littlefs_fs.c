@@ -15,6 +15,7 @@
 #include "esp_log.h"
 #include "esp_partition.h"
 
+#include "kernel/core/memory/m_slab.h"
 #include "kernel/core/vfs/core/m_vfs_errno.h"
 #include "kernel/core/vfs/core/m_vfs_object.h"
 #include "kernel/core/vfs/m_vfs_types.h"
@@ -53,6 +54,9 @@ typedef struct {
     } handle;
 } littlefs_file_data_t;
 
+static m_slab_cache_t s_littlefs_node_cache =
+        M_SLAB_CACHE_INITIALIZER("littlefs_node", littlefs_node_data_t);
+
 static const struct m_vfs_fs_ops s_littlefs_ops;
 static const m_vfs_fs_type_t s_littlefs_type = {
     .name = "littlefs",
@@ -146,7 +150,7 @@ littlefs_path_join(const char *parent,
 static littlefs_node_data_t *
 littlefs_node_data_create(const char *path, bool is_dir)
 {
-    littlefs_node_data_t *node = pvPortMalloc(sizeof(*node));
+    littlefs_node_data_t *node = m_slab_alloc(&s_littlefs_node_cache);
     if (node == NULL) {
         return NULL;
     }
@@ -167,7 +171,7 @@ littlefs_node_destroy(m_vfs_node_t *node)
     if (node == NULL || node->fs_private == NULL) {
         return;
     }
-    vPortFree(node->fs_private);
+    m_slab_free(&s_littlefs_node_cache, node->fs_private);
     node->fs_private = NULL;
 }
 